@@ -1,16 +1,29 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
-//layout(location = 0) in vec3 fragColor;
+layout(location = 0) in vec3 fragColor;
 //layout(location = 1) in vec3 fragPos;
 //layout(location = 2) in vec3 fragNormal;
-//layout(location = 3) in vec2 fragUV;
+layout(location = 3) in vec2 fragUV;
+layout(location = 4) flat in uint fragMaterial;
 
 layout(location = 0) out vec4 outColor;
 
-//layout(set = 2, binding = 0) uniform sampler2D texSampler;
+// Bindless table, matches GpuMaterial and BindlessTable in the engine
+struct Material {
+    vec4 baseColorFactor;
+    uint baseColorTexture;
+};
+layout(std430, set = 0, binding = 0) readonly buffer Materials {
+    Material materials[];
+};
+layout(set = 0, binding = 1) uniform sampler2D textures[];
 
 
 void main() {
+    Material material = materials[fragMaterial];
+    vec4 baseColor = material.baseColorFactor * texture(textures[nonuniformEXT(material.baseColorTexture)], fragUV);
+
     /*vec3 lightPos = vec3(1000.0, 1000.0, 1000.0);
     float ambientStrength = 0.1;
     vec3 lightColor = vec3(1.0, 1.0, 1.0);
@@ -21,8 +34,8 @@ void main() {
     vec3 diffuse = diff * lightColor;
 
     vec3 ambient = ambientStrength * lightColor;
-    outColor = vec4(texture(texSampler, fragUV).rgb * (ambient + diffuse), texture(texSampler, fragUV).a);
+    outColor = vec4(baseColor.rgb * (ambient + diffuse), baseColor.a);
     */
 
-    outColor = vec4(1.0, 1.0, 1.0, 1.0);
-}
\ No newline at end of file
+    outColor = vec4(fragColor, 1.0) * baseColor;
+}
@@ -1,28 +1,61 @@
 #include "application.h"
 
 #include "algorithm"
+#include "profiler.h"
+#include "chrono"
 
-Application::Application() : window(&this->eventBus), renderer(&this->window) {
+Application::Application(const std::string& worldPath) : window(&this->events), renderer(&this->window) {
+    if (!worldPath.empty()) this->renderer.GetStreamer().AddWorld(worldPath);
     this->layerStack.push_back(&this->window);
     this->layerStack.push_back(&this->renderer);
+    // Attached top down so the topmost layer hears about an event first
+    for (int64_t i = this->layerStack.size() - 1; i >= 0; i--) {
+        this->layerStack[i]->OnAttach(this->dispatcher);
+    }
 }
 
 void Application::Run() {
+    // A long stall (a breakpoint, a model load) would otherwise be caught up on in one burst of steps
+    const float maxFrameTime = 0.25f;
+    auto previousTime = std::chrono::steady_clock::now();
+    float accumulator = 0.0f;
+
     while (true) {
         if (this->window.ShouldClose()) return;
 
-        for (Layer* layer : this->layerStack) {
-            layer->OnTick();
+        // Input goes first so this frame's simulation steps see it
+        this->window.PollEvents();
+        {
+            PROFILE_SCOPE("Dispatch events");
+            // One batch per frame, events raised while dispatching are handled next frame
+            this->events.Drain([this](const Event& event) {
+                this->dispatcher.Dispatch(event);
+            });
+            if (uint64_t dropped = this->events.TakeDropped()) {
+                WARN("Event queue overflowed, dropped {} events", dropped);
+            }
         }
 
-        while (this->eventBus.size() != 0) {
-            for (int64_t i = this->layerStack.size() - 1; i >= 0; i--) {
-                this->layerStack[i]->OnEvent(this->eventBus[0]);
+        auto currentTime = std::chrono::steady_clock::now();
+        accumulator += std::min(std::chrono::duration<float>(currentTime - previousTime).count(), maxFrameTime);
+        previousTime = currentTime;
+        while (accumulator >= fixedTimestep) {
+            PROFILE_SCOPE("Fixed update");
+            for (Layer* layer : this->layerStack) {
+                layer->OnFixedUpdate(fixedTimestep);
             }
-            delete this->eventBus[0]; // Free the event off the heap
-            this->eventBus.erase(this->eventBus.begin()); // Remove the pointer from the bus
-        } 
+            accumulator -= fixedTimestep;
+        }
+
+        // The renderer only builds a frame packet here, recording and submitting it happens on its own thread
+        for (Layer* layer : this->layerStack) {
+            layer->OnTick(accumulator / fixedTimestep);
+        }
     }
 }
 
-Application::~Application() {}
\ No newline at end of file
+Application::~Application() {
+    for (Layer* layer : this->layerStack) {
+        layer->OnDetach(this->dispatcher);
+    }
+}
\ No newline at end of file
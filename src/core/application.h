@@ -8,12 +8,14 @@
 
 class Application {
 public:
-    Application();
+    // A world file's models are streamed in around the camera on top of the default scene
+    Application(const std::string& worldPath = "");
     ~Application();
     void Run();
 private:
+    EventQueue events;
+    EventDispatcher dispatcher;
     Window window;
     Renderer renderer;
     std::vector<Layer*> layerStack;
-    std::vector<Event*> eventBus;
 };
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "arena.h"
+
+LinearArena::LinearArena(size_t blockSize) : blockSize(blockSize) {}
+
+LinearArena::~LinearArena() {
+    this->FreeBlocks(0);
+}
+
+LinearArena::LinearArena(LinearArena&& other) noexcept : blockSize(other.blockSize), blocks(std::move(other.blocks)), current(other.current), offset(other.offset) {
+    other.blocks.clear();
+    other.current = 0;
+    other.offset = 0;
+}
+
+void* LinearArena::Allocate(size_t size, size_t alignment) {
+    if (!this->blocks.empty()) {
+        Block& block = this->blocks[this->current];
+        uintptr_t base = (uintptr_t)block.data;
+        size_t aligned = ((base + this->offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+        if (aligned + size <= block.size) {
+            this->offset = aligned + size;
+            return block.data + aligned;
+        }
+
+        // The next block is kept from before a rewind, anything after it is dropped if it's too small to use
+        uint32_t next = this->current + 1;
+        if (next < this->blocks.size() && size + alignment <= this->blocks[next].size) {
+            this->current = next;
+            this->offset = 0;
+            return this->Allocate(size, alignment);
+        }
+        this->FreeBlocks(next);
+    }
+
+    size_t previous = this->blocks.empty() ? 0 : this->blocks.back().size * 2;
+    size_t blockSize = std::max({ this->blockSize, previous, size + alignment });
+    this->blocks.push_back({ (char*)::operator new(blockSize), blockSize });
+    this->current = (uint32_t)(this->blocks.size() - 1);
+    this->offset = 0;
+    return this->Allocate(size, alignment);
+}
+
+void LinearArena::Rewind(Marker marker) {
+    this->current = marker.block;
+    this->offset = marker.offset;
+}
+
+void LinearArena::Reset() {
+    if (this->blocks.size() > 1) {
+        // Whatever the last cycle took fits in one block from now on
+        size_t total = 0;
+        for (const auto& block : this->blocks) total += block.size;
+        this->FreeBlocks(0);
+        this->blocks.push_back({ (char*)::operator new(total), total });
+    }
+    this->current = 0;
+    this->offset = 0;
+}
+
+size_t LinearArena::GetUsed() const {
+    size_t used = this->offset;
+    for (uint32_t i = 0; i < this->current; i++) used += this->blocks[i].size;
+    return used;
+}
+
+size_t LinearArena::GetCapacity() const {
+    size_t capacity = 0;
+    for (const auto& block : this->blocks) capacity += block.size;
+    return capacity;
+}
+
+void LinearArena::FreeBlocks(size_t first) {
+    for (size_t i = first; i < this->blocks.size(); i++) {
+        ::operator delete(this->blocks[i].data);
+    }
+    this->blocks.resize(std::min(first, this->blocks.size()));
+}
+
+LinearArena& GetScratchArena() {
+    thread_local LinearArena arena(256 * 1024);
+    return arena;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "core.h"
+#include "memory_resource"
+
+// Bump allocator for memory that all dies at once, usable directly or as the resource behind std::pmr containers.
+// Freeing single allocations does nothing. Reset folds the blocks the last cycle needed into one, so after the
+// first few cycles a steady workload never goes back to the heap. Not thread safe, each arena has one owner
+class LinearArena : public std::pmr::memory_resource {
+public:
+    // Position to rewind to, everything allocated before it stays valid
+    struct Marker {
+        uint32_t block = 0;
+        size_t offset = 0;
+    };
+
+    explicit LinearArena(size_t blockSize = 64 * 1024);
+    ~LinearArena();
+    LinearArena(LinearArena&& other) noexcept;
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    template<typename T>
+    T* Allocate(size_t count = 1) { return (T*)this->Allocate(sizeof(T) * count, alignof(T)); }
+
+    Marker GetMarker() const { return { this->current, this->offset }; }
+    // Frees everything allocated since marker was taken, the blocks stay for reuse
+    void Rewind(Marker marker);
+    // Frees everything, nothing allocated from the arena may be touched afterwards
+    void Reset();
+
+    // Bytes handed out since the last reset and bytes held
+    size_t GetUsed() const;
+    size_t GetCapacity() const;
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override { return this->Allocate(bytes, alignment); }
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+private:
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    void FreeBlocks(size_t first);
+
+    size_t blockSize;
+    std::vector<Block> blocks;
+    uint32_t current = 0;
+    size_t offset = 0;
+};
+
+// The calling thread's scratch arena, for temporaries that don't outlive the function using them. Take it through a
+// ScratchScope rather than directly so whatever the function allocated is rewound when it returns
+LinearArena& GetScratchArena();
+
+// Rewinds the thread's scratch arena to where it was when the scope opened. Scopes nest, but a container from an outer
+// scope mustn't grow while an inner one is open or the inner rewind frees its new storage
+class ScratchScope {
+public:
+    ScratchScope() : arena(GetScratchArena()), marker(arena.GetMarker()) {}
+    ~ScratchScope() { this->arena.Rewind(this->marker); }
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    LinearArena* Get() { return &this->arena; }
+private:
+    LinearArena& arena;
+    LinearArena::Marker marker;
+};
@@ -0,0 +1,135 @@
+#include "compression.h"
+#include "cstring"
+
+namespace {
+    constexpr size_t minMatch = 4;
+    // The format requires the last five bytes to be literals and the last match to start twelve bytes before the end
+    constexpr size_t lastLiterals = 5;
+    constexpr size_t matchSearchLimit = 12;
+    constexpr uint32_t hashBits = 14;
+    constexpr size_t maxOffset = 65535;
+
+    inline uint32_t Read32(const uint8_t* pointer) {
+        uint32_t value;
+        memcpy(&value, pointer, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t HashSequence(uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - hashBits);
+    }
+
+    // Lengths of 15 and up spill into extra bytes of 255 each plus a final remainder
+    inline bool WriteLength(size_t length, uint8_t*& output, const uint8_t* end) {
+        for (; length >= 255; length -= 255) {
+            if (output >= end) return false;
+            *output++ = 255;
+        }
+        if (output >= end) return false;
+        *output++ = (uint8_t)length;
+        return true;
+    }
+
+    inline bool ReadLength(size_t& length, const uint8_t*& input, const uint8_t* end) {
+        uint8_t byte;
+        do {
+            if (input >= end) return false;
+            byte = *input++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    bool WriteSequence(const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength, uint8_t*& output, const uint8_t* end) {
+        if (output >= end) return false;
+        uint8_t* token = output++;
+        *token = (uint8_t)(std::min<size_t>(literalCount, 15) << 4);
+        if (literalCount >= 15 && !WriteLength(literalCount - 15, output, end)) return false;
+        if ((size_t)(end - output) < literalCount) return false;
+        memcpy(output, literals, literalCount);
+        output += literalCount;
+        if (matchLength == 0) return true;
+
+        if (end - output < 2) return false;
+        *output++ = (uint8_t)(offset & 0xff);
+        *output++ = (uint8_t)(offset >> 8);
+        size_t matchCode = matchLength - minMatch;
+        *token |= (uint8_t)std::min<size_t>(matchCode, 15);
+        return matchCode < 15 || WriteLength(matchCode - 15, output, end);
+    }
+}
+
+size_t CompressBlock(const char* source, size_t size, char* destination, size_t capacity) {
+    const uint8_t* input = (const uint8_t*)source;
+    uint8_t* output = (uint8_t*)destination;
+    const uint8_t* outputEnd = output + capacity;
+
+    // Greedy single probe matching, positions of the last sequence seen per hash
+    std::array<uint32_t, 1 << hashBits> table{};
+    size_t anchor = 0;
+    size_t position = 0;
+    if (size > matchSearchLimit) {
+        size_t matchEnd = size - lastLiterals;
+        while (position + matchSearchLimit <= size) {
+            uint32_t sequence = Read32(input + position);
+            uint32_t& slot = table[HashSequence(sequence)];
+            size_t candidate = slot;
+            slot = (uint32_t)position;
+            if (candidate >= position || position - candidate > maxOffset || Read32(input + candidate) != sequence) {
+                // Steps further the longer nothing matched, so incompressible data goes through quickly
+                position += 1 + ((position - anchor) >> 6);
+                continue;
+            }
+
+            size_t length = minMatch;
+            while (position + length < matchEnd && input[candidate + length] == input[position + length]) length++;
+            if (!WriteSequence(input + anchor, position - anchor, position - candidate, length, output, outputEnd)) return 0;
+            position += length;
+            anchor = position;
+        }
+    }
+
+    if (!WriteSequence(input + anchor, size - anchor, 0, 0, output, outputEnd)) return 0;
+    return output - (uint8_t*)destination;
+}
+
+bool DecompressBlock(const char* source, size_t size, char* destination, size_t destinationSize) {
+    const uint8_t* input = (const uint8_t*)source;
+    const uint8_t* inputEnd = input + size;
+    uint8_t* output = (uint8_t*)destination;
+    uint8_t* outputEnd = output + destinationSize;
+
+    while (true) {
+        if (input >= inputEnd) return false;
+        uint8_t token = *input++;
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !ReadLength(literalCount, input, inputEnd)) return false;
+        if ((size_t)(inputEnd - input) < literalCount || (size_t)(outputEnd - output) < literalCount) return false;
+        memcpy(output, input, literalCount);
+        input += literalCount;
+        output += literalCount;
+        // Only the last sequence has no match
+        if (input == inputEnd) break;
+
+        if (inputEnd - input < 2) return false;
+        size_t offset = input[0] | ((size_t)input[1] << 8);
+        input += 2;
+        if (offset == 0 || offset > (size_t)(output - (uint8_t*)destination)) return false;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !ReadLength(matchLength, input, inputEnd)) return false;
+        matchLength += minMatch;
+        if ((size_t)(outputEnd - output) < matchLength) return false;
+
+        const uint8_t* match = output - offset;
+        if (offset >= matchLength) {
+            memcpy(output, match, matchLength);
+        } else {
+            // Overlapping, repeats the last offset bytes
+            for (size_t i = 0; i < matchLength; i++) output[i] = match[i];
+        }
+        output += matchLength;
+    }
+    return output == outputEnd;
+}
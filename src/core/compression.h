@@ -0,0 +1,17 @@
+#pragma once
+
+#include "core.h"
+
+// LZ4 block format, no frame or checksums around it. Fast enough to decode that reading compressed data from disk
+// beats reading it raw on anything slower than an NVMe drive
+
+// Worst case size of compressing size bytes, incompressible data grows slightly
+inline size_t GetCompressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+// Compresses source into destination, returns the compressed size or 0 when it doesn't fit in capacity
+size_t CompressBlock(const char* source, size_t size, char* destination, size_t capacity);
+// Decodes a whole block, false when it's corrupt or doesn't decode to exactly destinationSize bytes. Never reads or
+// writes outside the buffers, whatever the input
+bool DecompressBlock(const char* source, size_t size, char* destination, size_t destinationSize);
@@ -11,4 +11,5 @@
 #include "fstream"
 #include "unordered_map"
 #include "array"
-#include "algorithm"
\ No newline at end of file
+#include "algorithm"
+#include "functional"
\ No newline at end of file
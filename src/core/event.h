@@ -1,12 +1,55 @@
 #pragma once
 
-enum EventType {
-    WINDOW_CLOSE = 0,
-    KEY
-};
+#include "graphics/windowevents.h"
+#include "mpscqueue.h"
+#include "variant"
+#include "tuple"
 
-class Event {
+// Routes each event type straight to the handlers subscribed to that type. The variant's index picks the list, so there's
+// no virtual call or cast per event and layers that don't care about a type are never visited
+template<typename... Events>
+class TypedEventDispatcher {
 public:
-    virtual EventType GetType() = 0;
-    // virtual ~Event() = default;
-};
\ No newline at end of file
+    using Event = std::variant<Events...>;
+
+    // Registers object->handler for every event of type T, e.g. Subscribe<KeyEvent, &Window::OnKey>(this)
+    template<typename T, auto handler, typename Object>
+    void Subscribe(Object* object) {
+        static_assert((std::is_same_v<T, Events> || ...), "Event type isn't part of the dispatcher");
+        std::get<std::vector<Subscriber<T>>>(this->subscribers).push_back({ object, [](void* object, const T& event) {
+            (static_cast<Object*>(object)->*handler)(event);
+        }});
+    }
+
+    // Drops every subscription held by object, for layers detaching
+    void Unsubscribe(void* object) {
+        std::apply([object](auto&... lists) {
+            (std::erase_if(lists, [object](const auto& subscriber) { return subscriber.object == object; }), ...);
+        }, this->subscribers);
+    }
+
+    template<typename T>
+    void Dispatch(const T& event) const {
+        for (const Subscriber<T>& subscriber : std::get<std::vector<Subscriber<T>>>(this->subscribers)) {
+            subscriber.call(subscriber.object, event);
+        }
+    }
+
+    void Dispatch(const Event& event) const {
+        std::visit([this](const auto& payload) { this->Dispatch(payload); }, event);
+    }
+private:
+    template<typename T>
+    struct Subscriber {
+        void* object;
+        void (*call)(void* object, const T& event);
+    };
+
+    std::tuple<std::vector<Subscriber<Events>>...> subscribers;
+};
+
+using EventDispatcher = TypedEventDispatcher<WindowCloseEvent, KeyEvent>;
+using Event = EventDispatcher::Event;
+
+// Input bursts are a few dozen events, this leaves plenty of room for a long frame
+using EventQueue = MpscQueue<Event, 1024>;
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "core.h"
+
+// Non-owning reference to any callable, for callbacks that only have to live as long as the call they're passed to.
+// Two pointers, so unlike std::function it never allocates however much the callable captures
+template<typename Signature>
+class FunctionRef;
+
+template<typename Result, typename... Args>
+class FunctionRef<Result(Args...)> {
+public:
+    template<typename Callable>
+        requires (!std::is_same_v<std::remove_cvref_t<Callable>, FunctionRef> && std::is_invocable_r_v<Result, Callable&, Args...>)
+    FunctionRef(Callable&& callable) :
+        object((void*)std::addressof(callable)),
+        call([](void* object, Args... args) -> Result { return (*(std::remove_reference_t<Callable>*)object)(std::forward<Args>(args)...); }) {}
+
+    Result operator()(Args... args) const { return this->call(this->object, std::forward<Args>(args)...); }
+private:
+    void* object;
+    Result (*call)(void* object, Args... args);
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "core.h"
+#include "functional"
+
+template <class T> inline void HashCombine(size_t& seed, const T& value) {
+    seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+// Stable across runs and platforms, unlike std::hash, so it can be written to disk
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
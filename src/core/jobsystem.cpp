@@ -0,0 +1,262 @@
+#include "jobsystem.h"
+#include "profiler.h"
+#include "arena.h"
+
+namespace {
+    struct WorkerIdentity {
+        const JobSystem* system = nullptr;
+        uint32_t index = UINT32_MAX;
+    };
+    thread_local WorkerIdentity currentWorker;
+}
+
+bool WorkStealingDeque::Push(Job* job) {
+    int64_t b = this->bottom.load(std::memory_order_relaxed);
+    int64_t t = this->top.load(std::memory_order_acquire);
+    if (b - t >= capacity) return false;
+
+    this->jobs[b & (capacity - 1)].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    this->bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+Job* WorkStealingDeque::Pop() {
+    int64_t b = this->bottom.load(std::memory_order_relaxed) - 1;
+    this->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = this->top.load(std::memory_order_relaxed);
+    if (t > b) {
+        this->bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = this->jobs[b & (capacity - 1)].load(std::memory_order_relaxed);
+    if (t == b) {
+        // Last job, race the thieves for it
+        if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) job = nullptr;
+        this->bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* WorkStealingDeque::Steal() {
+    int64_t t = this->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = this->bottom.load(std::memory_order_acquire);
+    if (t >= b) return nullptr;
+
+    Job* job = this->jobs[t & (capacity - 1)].load(std::memory_order_relaxed);
+    if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+    return job;
+}
+
+JobSystem& JobSystem::Get() {
+    static JobSystem jobs(std::max(std::thread::hardware_concurrency(), 2u) - 1, 2);
+    return jobs;
+}
+
+JobSystem::JobSystem(uint32_t workerCount, uint32_t outsideThreads) : workerCount(workerCount), outsideThreads(std::max(outsideThreads, 1u)), mainThread(std::this_thread::get_id()) {
+    this->deques = std::make_unique<WorkStealingDeque[]>(this->GetThreadCount());
+    for (uint32_t i = 0; i < workerCount; i++) {
+        this->threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+    INFO("Started {} job workers", workerCount);
+}
+
+JobSystem::~JobSystem() {
+    this->WaitIdle();
+    this->stopping.store(true, std::memory_order_release);
+    this->Wake(this->workerCount);
+    for (auto& thread : this->threads) {
+        thread.join();
+    }
+}
+
+uint32_t JobSystem::GetThreadIndex() const {
+    if (currentWorker.system == this) return currentWorker.index;
+    if (std::this_thread::get_id() == this->mainThread) return this->workerCount;
+    return UINT32_MAX;
+}
+
+uint32_t JobSystem::AttachThread() {
+    uint32_t index = this->GetThreadIndex();
+    if (index != UINT32_MAX) return index;
+
+    uint32_t slot = this->attachedThreads.fetch_add(1, std::memory_order_relaxed);
+    if (slot >= this->outsideThreads) {
+        CRITICAL("Job system only has room for {} outside threads", this->outsideThreads);
+    }
+    currentWorker = { this, this->workerCount + slot };
+    return currentWorker.index;
+}
+
+void JobSystem::Run(std::function<void(uint32_t threadIndex)> job, JobCounter* counter, JobCounter* dependency) {
+    if (counter) counter->value.fetch_add(1, std::memory_order_relaxed);
+    if (dependency && !dependency->IsDone()) {
+        job = [this, dependency, job = std::move(job)](uint32_t threadIndex) {
+            this->Wait(*dependency);
+            job(threadIndex);
+        };
+    }
+    this->Enqueue(new Job{ std::move(job), counter });
+    this->Wake(1);
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+    uint32_t self = this->GetThreadIndex();
+    while (!counter.IsDone()) {
+        if (self != UINT32_MAX) {
+            if (Job* job = this->FindJob(self, false)) {
+                this->Execute(job, self);
+                continue;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void JobSystem::ParallelFor(uint32_t count, FunctionRef<void(uint32_t index, uint32_t threadIndex)> body, uint32_t minBatch) {
+    if (count == 0) return;
+    minBatch = std::max(minBatch, 1u);
+
+    // A few ranges per thread so stealing can even out uneven work without paying for a job per index
+    uint32_t batches = std::min((count + minBatch - 1) / minBatch, this->GetThreadCount() * 4);
+    uint32_t batchSize = (count + batches - 1) / batches;
+    batches = (count + batchSize - 1) / batchSize;
+
+    // The ranges capture two words and a pointer, small enough for std::function to keep inline, and the jobs
+    // themselves are scratch memory that outlives them since this only returns once they've all run
+    ScratchScope scratch;
+    std::pmr::vector<Job> jobs(scratch.Get());
+    jobs.reserve(batches - 1);
+    JobCounter counter;
+    counter.value.store(batches - 1, std::memory_order_relaxed);
+    for (uint32_t batch = 1; batch < batches; batch++) {
+        uint32_t begin = batch * batchSize;
+        uint32_t end = std::min(count, begin + batchSize);
+        this->Enqueue(&jobs.emplace_back(Job{ [&body, begin, end](uint32_t threadIndex) {
+            for (uint32_t i = begin; i < end; i++) body(i, threadIndex);
+        }, &counter, false }));
+    }
+    this->Wake(batches - 1);
+
+    // The caller takes the first range itself while idle threads steal the others off its deque
+    uint32_t self = this->GetThreadIndex();
+    if (self != UINT32_MAX) {
+        for (uint32_t i = 0; i < std::min(count, batchSize); i++) body(i, self);
+    } else {
+        this->Run([&body, batchSize, count](uint32_t threadIndex) {
+            for (uint32_t i = 0; i < std::min(count, batchSize); i++) body(i, threadIndex);
+        }, &counter);
+    }
+    this->Wait(counter);
+}
+
+void JobSystem::Submit(std::function<void(uint32_t threadIndex)> job) {
+    this->pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(this->backgroundMutex);
+        this->background.push_back(new Job{ std::move(job), nullptr });
+        this->backgroundCount.fetch_add(1, std::memory_order_release);
+    }
+    this->Wake(1);
+}
+
+void JobSystem::WaitIdle() {
+    uint32_t self = this->GetThreadIndex();
+    while (this->pending.load(std::memory_order_acquire) != 0) {
+        if (self != UINT32_MAX) {
+            if (Job* job = this->FindJob(self, true)) {
+                this->Execute(job, self);
+                continue;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void JobSystem::WorkerLoop(uint32_t threadIndex) {
+    currentWorker = { this, threadIndex };
+    PROFILE_THREAD("Worker " + std::to_string(threadIndex));
+
+    // Spin a little before sleeping, jobs tend to arrive in bursts a frame apart
+    const uint32_t spinsBeforeSleep = 64;
+    uint32_t idleSpins = 0;
+    while (true) {
+        uint32_t epoch = this->signal.load(std::memory_order_acquire);
+        if (Job* job = this->FindJob(threadIndex, true)) {
+            this->Execute(job, threadIndex);
+            idleSpins = 0;
+            continue;
+        }
+        if (this->stopping.load(std::memory_order_acquire)) return;
+
+        if (++idleSpins < spinsBeforeSleep) {
+            std::this_thread::yield();
+            continue;
+        }
+        // Returns straight away if anything was pushed since epoch was read
+        this->signal.wait(epoch, std::memory_order_acquire);
+        idleSpins = 0;
+    }
+}
+
+Job* JobSystem::FindJob(uint32_t threadIndex, bool background) {
+    if (Job* job = this->deques[threadIndex].Pop()) return job;
+
+    if (this->injectedCount.load(std::memory_order_acquire) != 0) {
+        std::lock_guard<std::mutex> lock(this->injectedMutex);
+        if (!this->injected.empty()) {
+            Job* job = this->injected.front();
+            this->injected.pop_front();
+            this->injectedCount.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    uint32_t threadCount = this->GetThreadCount();
+    for (uint32_t i = 1; i < threadCount; i++) {
+        if (Job* job = this->deques[(threadIndex + i) % threadCount].Steal()) return job;
+    }
+
+    if (background && this->backgroundCount.load(std::memory_order_acquire) != 0) {
+        std::lock_guard<std::mutex> lock(this->backgroundMutex);
+        if (!this->background.empty()) {
+            Job* job = this->background.front();
+            this->background.pop_front();
+            this->backgroundCount.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::Execute(Job* job, uint32_t threadIndex) {
+    job->function(threadIndex);
+    JobCounter* counter = job->counter;
+    if (job->owned) delete job;
+    // Waiters may free the counter as soon as it reaches zero, so this has to be the last touch
+    if (counter) counter->value.fetch_sub(1, std::memory_order_release);
+    this->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::Enqueue(Job* job) {
+    this->pending.fetch_add(1, std::memory_order_relaxed);
+    uint32_t self = this->GetThreadIndex();
+    if (self == UINT32_MAX) {
+        std::lock_guard<std::mutex> lock(this->injectedMutex);
+        this->injected.push_back(job);
+        this->injectedCount.fetch_add(1, std::memory_order_release);
+        return;
+    }
+    // A full deque means there's already far more queued than threads to run it
+    if (!this->deques[self].Push(job)) this->Execute(job, self);
+}
+
+void JobSystem::Wake(uint32_t count) {
+    if (count == 0) return;
+    this->signal.fetch_add(1, std::memory_order_release);
+    if (count == 1) this->signal.notify_one();
+    else this->signal.notify_all();
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "core.h"
+#include "functionref.h"
+#include "atomic"
+#include "functional"
+#include "thread"
+#include "mutex"
+#include "deque"
+
+// Outstanding job count, jobs started against a counter decrement it once they've run
+struct JobCounter {
+    std::atomic<uint32_t> value = 0;
+
+    bool IsDone() const { return this->value.load(std::memory_order_acquire) == 0; }
+};
+
+struct Job {
+    std::function<void(uint32_t threadIndex)> function;
+    JobCounter* counter;
+    // Deleted once run. ParallelFor's jobs live in the caller's scratch arena instead
+    bool owned = true;
+};
+
+// Chase-Lev deque: the owning thread pushes and pops at the bottom, any other thread steals from the top. Fixed size,
+// the owner runs the job itself when it's full
+class WorkStealingDeque {
+public:
+    static constexpr int64_t capacity = 4096;
+
+    bool Push(Job* job);
+    Job* Pop();
+    Job* Steal();
+private:
+    alignas(64) std::atomic<int64_t> top = 0;
+    alignas(64) std::atomic<int64_t> bottom = 0;
+    std::array<std::atomic<Job*>, capacity> jobs{};
+};
+
+// Work stealing scheduler: one deque per worker plus one per outside thread taking part (the creator, and any that
+// attach), which run jobs whenever they wait. Thread indices are stable, below GetThreadCount(), so callers can keep
+// per-thread state (e.g. command pools)
+class JobSystem {
+public:
+    // Shared instance, the thread that first calls this is its main thread and one more (the render thread) can attach
+    static JobSystem& Get();
+
+    JobSystem(uint32_t workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1, uint32_t outsideThreads = 1);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Workers plus the outside threads that can take part
+    inline uint32_t GetThreadCount() const { return this->workerCount + this->outsideThreads; }
+    inline uint32_t GetWorkerCount() const { return this->workerCount; }
+    // Index of the calling thread, UINT32_MAX for threads that don't belong to this system
+    uint32_t GetThreadIndex() const;
+    // Gives the calling thread its own deque so it helps instead of spinning when it waits, returns its index
+    uint32_t AttachThread();
+
+    // Queues job on the calling thread's deque for itself or an idle thread to pick up. counter is incremented now and
+    // decremented after the job has run, with a dependency the job first waits for that counter to reach zero
+    void Run(std::function<void(uint32_t threadIndex)> job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+    // Runs other jobs until counter reaches zero, so waiting from inside a job never deadlocks the pool
+    void Wait(JobCounter& counter);
+    // Runs body(index, threadIndex) for every index in [0, count), in ranges of at least minBatch indices, and waits by
+    // helping. Doesn't allocate when called from a thread that belongs to the system
+    void ParallelFor(uint32_t count, FunctionRef<void(uint32_t index, uint32_t threadIndex)> body, uint32_t minBatch = 1);
+    // Long running background work (e.g. pipeline compiles). Only idle threads take it, never one waiting on a counter,
+    // so a frame's parallel loops can't get stuck behind it
+    void Submit(std::function<void(uint32_t threadIndex)> job);
+    // Runs jobs until every one queued so far, background included, has finished
+    void WaitIdle();
+private:
+    void WorkerLoop(uint32_t threadIndex);
+    Job* FindJob(uint32_t threadIndex, bool background);
+    void Execute(Job* job, uint32_t threadIndex);
+    void Enqueue(Job* job);
+    void Wake(uint32_t count);
+
+    uint32_t workerCount;
+    uint32_t outsideThreads;
+    std::atomic<uint32_t> attachedThreads = 1;
+    std::thread::id mainThread;
+    std::vector<std::thread> threads;
+    std::unique_ptr<WorkStealingDeque[]> deques;
+
+    // Jobs queued from threads without a deque
+    std::mutex injectedMutex;
+    std::deque<Job*> injected;
+    std::atomic<uint32_t> injectedCount = 0;
+
+    std::mutex backgroundMutex;
+    std::deque<Job*> background;
+    std::atomic<uint32_t> backgroundCount = 0;
+
+    std::atomic<uint64_t> pending = 0;
+    // Bumped on every push, idle workers sleep on it until it moves
+    std::atomic<uint32_t> signal = 0;
+    std::atomic<bool> stopping = false;
+};
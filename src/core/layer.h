@@ -2,10 +2,16 @@
 
 #include "event.h"
 
+// Simulation runs in fixed steps of this many seconds whatever the frame rate
+inline constexpr float fixedTimestep = 1.0f / 60.0f;
+
 class Layer {
 public:
-    virtual void OnAttach() {};
-    virtual void OnDetach() {};
-    virtual void OnTick() {};
-    virtual void OnEvent(Event* event) {};
-};
\ No newline at end of file
+    // Layers subscribe to the event types they handle here
+    virtual void OnAttach(EventDispatcher& dispatcher) {};
+    virtual void OnDetach(EventDispatcher& dispatcher) { dispatcher.Unsubscribe(this); };
+    // Zero or more times per frame, always by fixedTimestep
+    virtual void OnFixedUpdate(float timestep) {};
+    // Once per frame after the fixed updates, interpolation is how far the frame sits between the last two steps
+    virtual void OnTick(float interpolation) {};
+};
@@ -0,0 +1,46 @@
+#include "log.h"
+
+#include "spdlog/async.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace {
+    // Shared by the async logger and the synchronous one left after shutdown, so the two never interleave a line
+    std::shared_ptr<spdlog::sinks::sink> consoleSink;
+}
+
+void InitLogging() {
+    // Each queued message carries its formatted text inline, so the queue is allocated once up front
+    const size_t queueSize = 8192;
+    spdlog::init_thread_pool(queueSize, 1);
+    consoleSink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+    auto logger = std::make_shared<spdlog::async_logger>("fenrir", consoleSink, spdlog::thread_pool(), spdlog::async_overflow_policy::overrun_oldest);
+    logger->set_level((spdlog::level::level_enum)FENRIR_LOG_LEVEL);
+    logger->flush_on(spdlog::level::warn);
+    spdlog::set_default_logger(logger);
+}
+
+void ShutdownLogging() {
+    if (!consoleSink) return;
+    // Releasing the thread pool joins its thread once the queue is written out, later messages are written directly
+    auto logger = std::make_shared<spdlog::logger>("fenrir", consoleSink);
+    logger->set_level((spdlog::level::level_enum)FENRIR_LOG_LEVEL);
+    spdlog::set_default_logger(logger);
+    spdlog::details::registry::instance().set_tp(nullptr);
+}
+
+bool LogRateLimit::Allow(uint32_t& suppressed) {
+    suppressed = 0;
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t start = this->windowStart.load(std::memory_order_relaxed);
+    if (start < 0 || now - start >= interval.count()) {
+        // Whoever moves the window on starts the new budget and reports what the last one dropped
+        if (this->windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+            this->count.store(1, std::memory_order_relaxed);
+            suppressed = this->dropped.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    if (this->count.fetch_add(1, std::memory_order_relaxed) < burst) return true;
+    this->dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
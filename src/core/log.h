@@ -1,7 +1,83 @@
+#pragma once
+
 #include "spdlog/spdlog.h"
+#include "atomic"
+#include "chrono"
 
+// Lowest level compiled in, one of spdlog's SPDLOG_LEVEL_* values. Anything below it expands to nothing, arguments
+// included, so it costs neither formatting nor a level check at runtime
+#ifndef FENRIR_LOG_LEVEL
+#define FENRIR_LOG_LEVEL SPDLOG_LEVEL_INFO
+#endif
 
+#if FENRIR_LOG_LEVEL <= SPDLOG_LEVEL_DEBUG
 #define DEBUG(...) spdlog::debug(__VA_ARGS__)
+#else
+#define DEBUG(...) (void)0
+#endif
+
+#if FENRIR_LOG_LEVEL <= SPDLOG_LEVEL_INFO
 #define INFO(...) spdlog::info(__VA_ARGS__)
+#else
+#define INFO(...) (void)0
+#endif
+
+#if FENRIR_LOG_LEVEL <= SPDLOG_LEVEL_WARN
 #define WARN(...) spdlog::warn(__VA_ARGS__)
-#define CRITICAL(...) {spdlog::critical(__VA_ARGS__); throw std::runtime_error("Exiting");}
\ No newline at end of file
+#else
+#define WARN(...) (void)0
+#endif
+
+// Always compiled in, the message goes into the exception as well for whoever catches it
+#define CRITICAL(...) { std::string criticalMessage = fmt::format(__VA_ARGS__); spdlog::critical(criticalMessage); throw std::runtime_error(criticalMessage); }
+
+// Swaps the default logger for one that formats on the calling thread and writes on a background thread through a
+// bounded queue, when it's full the oldest messages are dropped rather than stalling the caller
+void InitLogging();
+// Writes out everything still queued and goes back to logging synchronously
+void ShutdownLogging();
+
+// Keeps the async logger up for its lifetime, so every return path out of main drains the queue
+class LogSession {
+public:
+    LogSession() { InitLogging(); }
+    ~LogSession() { ShutdownLogging(); }
+    LogSession(const LogSession&) = delete;
+    LogSession& operator=(const LogSession&) = delete;
+};
+
+// Per call site budget for logs that can fire thousands of times, e.g. once per node while loading. Lets burst messages
+// through per interval and counts the rest, the first message of the next interval reports how many were dropped
+class LogRateLimit {
+public:
+    static constexpr uint32_t burst = 8;
+    static constexpr std::chrono::milliseconds interval{ 1000 };
+
+    // True when this message may be logged, suppressed is then the number dropped since the last one that was
+    bool Allow(uint32_t& suppressed);
+private:
+    std::atomic<int64_t> windowStart = -1;
+    std::atomic<uint32_t> count = 0;
+    std::atomic<uint32_t> dropped = 0;
+};
+
+#define LOG_RATE_LIMITED(level, ...) do { \
+        static LogRateLimit logRateLimit; \
+        uint32_t suppressed; \
+        if (logRateLimit.Allow(suppressed)) { \
+            if (suppressed != 0) level("{} similar messages suppressed", suppressed); \
+            level(__VA_ARGS__); \
+        } \
+    } while (0)
+
+#if FENRIR_LOG_LEVEL <= SPDLOG_LEVEL_DEBUG
+#define DEBUG_LIMITED(...) LOG_RATE_LIMITED(DEBUG, __VA_ARGS__)
+#else
+#define DEBUG_LIMITED(...) (void)0
+#endif
+
+#if FENRIR_LOG_LEVEL <= SPDLOG_LEVEL_INFO
+#define INFO_LIMITED(...) LOG_RATE_LIMITED(INFO, __VA_ARGS__)
+#else
+#define INFO_LIMITED(...) (void)0
+#endif
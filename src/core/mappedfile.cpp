@@ -0,0 +1,86 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include "windows.h"
+#else
+#include "fcntl.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "unistd.h"
+#endif
+
+MappedFile::~MappedFile() {
+    this->Close();
+}
+
+bool MappedFile::Open(const std::string& path) {
+    this->Close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    this->data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!this->data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    this->file = file;
+    this->mapping = mapping;
+    this->size = (uint64_t)size.QuadPart;
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) return false;
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size == 0) {
+        close(file);
+        return false;
+    }
+    void* data = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // The mapping keeps the file referenced on its own
+    close(file);
+    if (data == MAP_FAILED) return false;
+    this->data = (const char*)data;
+    this->size = (uint64_t)status.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::Close() {
+    if (!this->data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(this->data);
+    CloseHandle(this->mapping);
+    CloseHandle(this->file);
+    this->file = nullptr;
+    this->mapping = nullptr;
+#else
+    munmap((void*)this->data, this->size);
+#endif
+    this->data = nullptr;
+    this->size = 0;
+}
+
+void MappedFile::Prefetch(uint64_t offset, uint64_t size) const {
+    if (!this->data || offset >= this->size) return;
+    size = std::min(size, this->size - offset);
+#ifdef _WIN32
+    WIN32_MEMORY_RANGE_ENTRY range{ (void*)(this->data + offset), (SIZE_T)size };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    // madvise wants a page aligned start
+    uintptr_t pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)(this->data + offset) & ~(pageSize - 1);
+    madvise((void*)start, (uintptr_t)(this->data + offset + size) - start, MADV_WILLNEED);
+#endif
+}
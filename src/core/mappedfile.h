@@ -0,0 +1,29 @@
+#pragma once
+
+#include "core.h"
+
+// Read only mapping of a whole file. Pages are read in on first touch and shared with the OS file cache, so opening
+// one costs nothing however big the file is
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // False if the file can't be opened or mapped, the mapping stays valid until Close or destruction
+    bool Open(const std::string& path);
+    void Close();
+    // Asks the OS to start reading a range in ahead of use, so one large read replaces a page fault per 4 KB
+    void Prefetch(uint64_t offset, uint64_t size) const;
+
+    inline const char* GetData() const { return this->data; }
+    inline uint64_t GetSize() const { return this->size; }
+private:
+    const char* data = nullptr;
+    uint64_t size = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
@@ -0,0 +1,89 @@
+#include "memory.h"
+#include "atomic"
+#include "new"
+#include "cstdlib"
+#include "cstddef"
+#ifdef _MSC_VER
+#include "malloc.h"
+#endif
+
+namespace {
+    std::atomic<uint64_t> allocations = 0;
+    std::atomic<uint64_t> allocatedBytes = 0;
+}
+
+HeapCounters GetHeapCounters() {
+    return { allocations.load(std::memory_order_relaxed), allocatedBytes.load(std::memory_order_relaxed) };
+}
+
+#ifdef FENRIR_ALLOCATION_TRACKING
+// Replaces the global operators for the whole program. Every other form forwards to these two, counting stays two
+// relaxed increments so it's cheap enough to leave on
+static void* CountedAllocate(size_t size, size_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    size = std::max<size_t>(size, 1);
+#ifdef _MSC_VER
+    // MSVC has no aligned_alloc and its aligned blocks need their own free, so every block goes through the aligned pair
+    return _aligned_malloc(size, std::max(alignment, alignof(std::max_align_t)));
+#else
+    if (alignment <= alignof(std::max_align_t)) return std::malloc(size);
+    return std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+}
+
+static void CountedFree(void* pointer) {
+#ifdef _MSC_VER
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+void* operator new(size_t size) {
+    if (void* pointer = CountedAllocate(size, alignof(std::max_align_t))) return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    if (void* pointer = CountedAllocate(size, (size_t)alignment)) return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return ::operator new(size, alignment);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return CountedAllocate(size, alignof(std::max_align_t));
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return CountedAllocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return CountedAllocate(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return CountedAllocate(size, (size_t)alignment);
+}
+
+void operator delete(void* pointer) noexcept { CountedFree(pointer); }
+void operator delete[](void* pointer) noexcept { CountedFree(pointer); }
+void operator delete(void* pointer, size_t) noexcept { CountedFree(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { CountedFree(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { CountedFree(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { CountedFree(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { CountedFree(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { CountedFree(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { CountedFree(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { CountedFree(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { CountedFree(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { CountedFree(pointer); }
+#endif
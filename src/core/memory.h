@@ -0,0 +1,19 @@
+#pragma once
+
+#include "core.h"
+
+// Every operator new in the process is counted when built with FENRIR_ALLOCATION_TRACKING, so frames can prove they
+// stay off the general heap. Without it these always return zero
+struct HeapCounters {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+HeapCounters GetHeapCounters();
+constexpr bool IsHeapTrackingEnabled() {
+#ifdef FENRIR_ALLOCATION_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "core.h"
+#include "atomic"
+
+// Bounded multi producer single consumer ring, records are stored by value in place so pushing never allocates. Each
+// slot carries a sequence number: producers claim a position with a CAS on the tail and publish by bumping the slot's
+// sequence, the consumer only reads slots whose sequence says they've been published
+template<typename T, uint32_t capacity>
+class MpscQueue {
+    static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0, "MpscQueue capacity has to be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "MpscQueue records are copied in and out of the slots");
+public:
+    MpscQueue() {
+        for (uint32_t i = 0; i < capacity; i++) {
+            this->slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Safe from any thread, returns false and drops the record when the consumer has fallen a full ring behind
+    bool Push(const T& value) {
+        uint64_t position = this->tail.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = this->slots[position & mask];
+            uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            int64_t difference = (int64_t)sequence - (int64_t)position;
+            if (difference == 0) {
+                if (this->tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.value = value;
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                this->dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                position = this->tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer thread only
+    bool Pop(T& value) {
+        Slot& slot = this->slots[this->head & mask];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != this->head + 1) return false;
+
+        value = slot.value;
+        slot.sequence.store(this->head + capacity, std::memory_order_release);
+        this->head++;
+        return true;
+    }
+
+    // Consumer thread only, calls handler for at most the records published when it started so anything pushed while
+    // the batch runs waits for the next one. Returns how many records were handled
+    template<typename Handler>
+    uint32_t Drain(Handler&& handler) {
+        uint64_t end = this->tail.load(std::memory_order_acquire);
+        uint32_t count = 0;
+        T value;
+        while (this->head < end && this->Pop(value)) {
+            handler(value);
+            count++;
+        }
+        return count;
+    }
+
+    // Records lost to a full ring since the last call
+    uint64_t TakeDropped() { return this->dropped.exchange(0, std::memory_order_relaxed); }
+    static constexpr uint32_t GetCapacity() { return capacity; }
+private:
+    static constexpr uint64_t mask = capacity - 1;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sequence;
+        T value;
+    };
+
+    std::array<Slot, capacity> slots;
+    alignas(64) std::atomic<uint64_t> tail = 0;
+    alignas(64) uint64_t head = 0;
+    std::atomic<uint64_t> dropped = 0;
+};
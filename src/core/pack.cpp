@@ -0,0 +1,235 @@
+#include "pack.h"
+#include "filesystem"
+#include "cstring"
+#include "atomic"
+
+#include "compression.h"
+#include "hash.h"
+#include "arena.h"
+#include "jobsystem.h"
+#include "profiler.h"
+
+// Ranges covering fewer blocks than this decode on the calling thread, handing them out costs more than it saves
+static constexpr uint32_t parallelBlockThreshold = 4;
+
+std::string NormalizePackPath(const std::string& path) {
+    return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+static void WritePadding(std::ofstream& output, uint64_t& offset, uint64_t alignment) {
+    static const char zeros[16]{};
+    uint64_t padding = (alignment - offset % alignment) % alignment;
+    output.write(zeros, padding);
+    offset += padding;
+}
+
+void WritePack(const std::string& path, const std::vector<std::string>& files) {
+    PROFILE_FUNCTION();
+    std::string temporary = path + ".tmp";
+    std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        CRITICAL("Couldn't open {} for writing", temporary);
+    }
+
+    PackHeader header;
+    output.write((const char*)&header, sizeof(header));
+    uint64_t offset = sizeof(header);
+
+    std::vector<PackEntry> entries;
+    std::vector<PackBlock> blocks;
+    std::string names;
+    uint64_t totalSize = 0;
+    for (const auto& file : files) {
+        std::ifstream input(file, std::ios::binary | std::ios::ate);
+        if (!input.is_open()) {
+            CRITICAL("Couldn't open file {}", file);
+        }
+        std::vector<char> data((size_t)input.tellg());
+        input.seekg(0);
+        input.read(data.data(), data.size());
+
+        std::string name = NormalizePackPath(file);
+        PackEntry entry;
+        entry.pathHash = HashBytes(name.data(), name.size());
+        entry.size = data.size();
+        entry.nameOffset = (uint32_t)names.size();
+        entry.nameLength = (uint32_t)name.size();
+        entry.firstBlock = (uint32_t)blocks.size();
+        entry.blockCount = (uint32_t)((data.size() + packBlockSize - 1) / packBlockSize);
+        names += name;
+        totalSize += data.size();
+
+        std::vector<std::vector<char>> compressed(entry.blockCount);
+        JobSystem::Get().ParallelFor(entry.blockCount, [&](uint32_t i, uint32_t) {
+            size_t begin = (size_t)i * packBlockSize;
+            size_t length = std::min<size_t>(packBlockSize, data.size() - begin);
+            compressed[i].resize(GetCompressBound(length));
+            // Only kept when it's smaller, already compressed formats (PNG, JPEG) are stored as they are
+            size_t compressedSize = CompressBlock(data.data() + begin, length, compressed[i].data(), length - 1);
+            if (compressedSize == 0) compressed[i].assign(data.begin() + begin, data.begin() + begin + length);
+            else compressed[i].resize(compressedSize);
+        });
+        for (const auto& block : compressed) {
+            blocks.push_back({ offset, (uint32_t)block.size() });
+            output.write(block.data(), block.size());
+            offset += block.size();
+        }
+        entries.push_back(entry);
+    }
+
+    header.fileCount = (uint32_t)entries.size();
+    header.blockCount = (uint32_t)blocks.size();
+    header.tableCapacity = 2;
+    while (header.tableCapacity < entries.size() * 2) header.tableCapacity *= 2;
+    std::vector<uint32_t> table(header.tableCapacity, UINT32_MAX);
+    uint32_t mask = header.tableCapacity - 1;
+    for (uint32_t i = 0; i < entries.size(); i++) {
+        uint32_t slot = (uint32_t)(entries[i].pathHash & mask);
+        for (; table[slot] != UINT32_MAX; slot = (slot + 1) & mask) {
+            const PackEntry& other = entries[table[slot]];
+            if (other.pathHash == entries[i].pathHash && names.compare(other.nameOffset, other.nameLength, names, entries[i].nameOffset, entries[i].nameLength) == 0) {
+                CRITICAL("{} is in the pack twice", names.substr(entries[i].nameOffset, entries[i].nameLength));
+            }
+        }
+        table[slot] = i;
+    }
+
+    WritePadding(output, offset, 8);
+    header.entriesOffset = offset;
+    output.write((const char*)entries.data(), entries.size() * sizeof(PackEntry));
+    offset += entries.size() * sizeof(PackEntry);
+    header.blocksOffset = offset;
+    output.write((const char*)blocks.data(), blocks.size() * sizeof(PackBlock));
+    offset += blocks.size() * sizeof(PackBlock);
+    header.tableOffset = offset;
+    output.write((const char*)table.data(), table.size() * sizeof(uint32_t));
+    offset += table.size() * sizeof(uint32_t);
+    header.namesOffset = offset;
+    header.namesSize = names.size();
+    output.write(names.data(), names.size());
+
+    output.seekp(0);
+    output.write((const char*)&header, sizeof(header));
+    output.close();
+    if (!output) {
+        CRITICAL("Couldn't write {}", temporary);
+    }
+    std::filesystem::rename(temporary, path);
+    INFO("Packed {} files, {:.1f} MB compressed to {:.1f} MB", entries.size(), totalSize / 1e6, header.entriesOffset / 1e6);
+}
+
+bool PackFile::Open(const std::string& path) {
+    this->path = path;
+    if (!this->file.Open(path)) return false;
+
+    const char* data = this->file.GetData();
+    uint64_t size = this->file.GetSize();
+    auto fits = [size](uint64_t offset, uint64_t length) { return offset <= size && length <= size - offset; };
+    if (size < sizeof(PackHeader)) {
+        WARN("{} is too small to be a pack", path);
+        return false;
+    }
+    memcpy(&this->header, data, sizeof(PackHeader));
+    if (this->header.magic != packMagic || this->header.version != packVersion || this->header.blockSize == 0) {
+        WARN("{} isn't a pack this build can read", path);
+        return false;
+    }
+    // Each table is 8 byte aligned by the writer and the mapping is page aligned, so they're read in place
+    if (!fits(this->header.entriesOffset, (uint64_t)this->header.fileCount * sizeof(PackEntry)) ||
+        !fits(this->header.blocksOffset, (uint64_t)this->header.blockCount * sizeof(PackBlock)) ||
+        !fits(this->header.tableOffset, (uint64_t)this->header.tableCapacity * sizeof(uint32_t)) ||
+        !fits(this->header.namesOffset, this->header.namesSize) ||
+        (this->header.tableCapacity & (this->header.tableCapacity - 1)) != 0 || this->header.entriesOffset % 8 != 0) {
+        WARN("{} has a damaged table of contents", path);
+        return false;
+    }
+    this->entries = (const PackEntry*)(data + this->header.entriesOffset);
+    this->blocks = (const PackBlock*)(data + this->header.blocksOffset);
+    this->table = (const uint32_t*)(data + this->header.tableOffset);
+    this->names = data + this->header.namesOffset;
+
+    // Checked once here so reads can trust the tables
+    for (uint32_t i = 0; i < this->header.fileCount; i++) {
+        const PackEntry& entry = this->entries[i];
+        bool valid = (uint64_t)entry.nameOffset + entry.nameLength <= this->header.namesSize &&
+            (uint64_t)entry.firstBlock + entry.blockCount <= this->header.blockCount &&
+            entry.blockCount == (entry.size + this->header.blockSize - 1) / this->header.blockSize;
+        for (uint32_t block = 0; valid && block < entry.blockCount; block++) {
+            valid = fits(this->blocks[entry.firstBlock + block].offset, this->blocks[entry.firstBlock + block].compressedSize);
+        }
+        if (!valid) {
+            WARN("{} has a damaged table of contents entry {}", path, i);
+            this->entries = nullptr;
+            return false;
+        }
+    }
+    return true;
+}
+
+const PackEntry* PackFile::Find(const std::string& normalizedPath) const {
+    if (!this->entries || this->header.tableCapacity == 0) return nullptr;
+    uint64_t hash = HashBytes(normalizedPath.data(), normalizedPath.size());
+    uint32_t mask = this->header.tableCapacity - 1;
+    uint32_t slot = (uint32_t)(hash & mask);
+    for (uint32_t probe = 0; probe < this->header.tableCapacity; probe++, slot = (slot + 1) & mask) {
+        uint32_t index = this->table[slot];
+        if (index == UINT32_MAX) return nullptr;
+        if (index >= this->header.fileCount) continue;
+        const PackEntry& entry = this->entries[index];
+        if (entry.pathHash == hash && entry.nameLength == normalizedPath.size() && memcmp(this->names + entry.nameOffset, normalizedPath.data(), entry.nameLength) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+bool PackFile::Read(const PackEntry& entry, uint64_t offset, uint64_t size, char* destination) const {
+    if (offset > entry.size || size > entry.size - offset) return false;
+    if (size == 0) return true;
+
+    uint32_t first = (uint32_t)(offset / this->header.blockSize);
+    uint32_t last = (uint32_t)((offset + size - 1) / this->header.blockSize);
+    const PackBlock& firstBlock = this->blocks[entry.firstBlock + first];
+    const PackBlock& lastBlock = this->blocks[entry.firstBlock + last];
+    this->file.Prefetch(firstBlock.offset, lastBlock.offset + lastBlock.compressedSize - firstBlock.offset);
+
+    uint32_t count = last - first + 1;
+    if (count < parallelBlockThreshold) {
+        for (uint32_t i = first; i <= last; i++) {
+            if (!this->ReadBlock(entry, i, offset, size, destination)) return false;
+        }
+        return true;
+    }
+
+    std::atomic<bool> valid = true;
+    JobSystem::Get().ParallelFor(count, [&](uint32_t i, uint32_t) {
+        if (!this->ReadBlock(entry, first + i, offset, size, destination)) valid.store(false, std::memory_order_relaxed);
+    }, 2);
+    return valid.load();
+}
+
+// Decodes the part of one block that falls inside the range [offset, offset + size) of the file
+bool PackFile::ReadBlock(const PackEntry& entry, uint32_t block, uint64_t offset, uint64_t size, char* destination) const {
+    uint64_t blockStart = (uint64_t)block * this->header.blockSize;
+    uint64_t blockLength = std::min<uint64_t>(this->header.blockSize, entry.size - blockStart);
+    uint64_t begin = std::max(offset, blockStart);
+    uint64_t end = std::min(offset + size, blockStart + blockLength);
+    char* target = destination + (begin - offset);
+
+    const PackBlock& packed = this->blocks[entry.firstBlock + block];
+    const char* source = this->file.GetData() + packed.offset;
+    if (packed.compressedSize == blockLength) {
+        memcpy(target, source + (begin - blockStart), end - begin);
+        return true;
+    }
+    if (begin == blockStart && end == blockStart + blockLength) {
+        return DecompressBlock(source, packed.compressedSize, target, blockLength);
+    }
+
+    // Only part of it is wanted, the whole block still has to be decoded
+    ScratchScope scratch;
+    char* decoded = (char*)scratch.Get()->Allocate(blockLength);
+    if (!DecompressBlock(source, packed.compressedSize, decoded, blockLength)) return false;
+    memcpy(target, decoded + (begin - blockStart), end - begin);
+    return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "core.h"
+#include "mappedfile.h"
+
+// Single file archive of many assets. Each file is split into fixed size blocks compressed on their own, so any range
+// can be read by decoding only the blocks it covers and a large file's blocks decode in parallel. The table of
+// contents is a hash table of path hashes written at the end, looked up in place straight from the mapping
+constexpr uint32_t packMagic = 0x4b415046; // "FPAK"
+constexpr uint32_t packVersion = 1;
+constexpr uint32_t packBlockSize = 64 * 1024;
+
+struct PackHeader {
+    uint32_t magic = packMagic;
+    uint32_t version = packVersion;
+    uint32_t blockSize = packBlockSize;
+    uint32_t fileCount = 0;
+    uint32_t blockCount = 0;
+    // Power of two, at least twice the file count so probes stay short
+    uint32_t tableCapacity = 0;
+    uint64_t entriesOffset = 0;
+    uint64_t blocksOffset = 0;
+    uint64_t tableOffset = 0;
+    uint64_t namesOffset = 0;
+    uint64_t namesSize = 0;
+};
+
+struct PackEntry {
+    uint64_t pathHash = 0;
+    uint64_t size = 0;
+    // Into the names, kept to tell apart paths whose hashes collide
+    uint32_t nameOffset = 0;
+    uint32_t nameLength = 0;
+    uint32_t firstBlock = 0;
+    uint32_t blockCount = 0;
+};
+
+struct PackBlock {
+    uint64_t offset = 0;
+    // Stored as is when compressing didn't make it any smaller, then this is its uncompressed size
+    uint32_t compressedSize = 0;
+    uint32_t padding = 0;
+};
+
+// Packed paths are relative to the working directory with forward slashes and no . or .. left in them
+std::string NormalizePackPath(const std::string& path);
+
+// Packs files from disk under their normalised paths, each file's blocks are compressed in parallel
+void WritePack(const std::string& path, const std::vector<std::string>& files);
+
+class PackFile {
+public:
+    // False if the file is missing or isn't a pack of this version
+    bool Open(const std::string& path);
+
+    const PackEntry* Find(const std::string& normalizedPath) const;
+    // Decodes size bytes starting at offset into destination, false if the range is past the end or a block is corrupt
+    bool Read(const PackEntry& entry, uint64_t offset, uint64_t size, char* destination) const;
+
+    inline uint32_t GetFileCount() const { return this->header.fileCount; }
+    inline const std::string& GetPath() const { return this->path; }
+private:
+    bool ReadBlock(const PackEntry& entry, uint32_t block, uint64_t offset, uint64_t size, char* destination) const;
+
+    std::string path;
+    MappedFile file;
+    PackHeader header;
+    const PackEntry* entries = nullptr;
+    const PackBlock* blocks = nullptr;
+    const uint32_t* table = nullptr;
+    const char* names = nullptr;
+};
@@ -0,0 +1,131 @@
+#include "profiler.h"
+
+#include "nlohmann/json.hpp"
+
+Profiler& Profiler::Get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+ProfileThreadBuffer& Profiler::GetThreadBuffer() {
+    // Registered once per thread, after that recording never takes the lock
+    thread_local ProfileThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->threads.push_back(std::make_unique<ProfileThreadBuffer>());
+        buffer = this->threads.back().get();
+        buffer->name = this->threads.size() == 1 ? "Main" : "Thread " + std::to_string(this->threads.size() - 1);
+    }
+    return *buffer;
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+    ProfileThreadBuffer& buffer = this->GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(this->mutex);
+    buffer.name = name;
+}
+
+uint64_t Profiler::BeginZone() {
+    this->GetThreadBuffer().depth++;
+    return Now();
+}
+
+void Profiler::EndZone(const char* name, uint64_t start) {
+    uint64_t end = Now();
+    ProfileThreadBuffer& buffer = this->GetThreadBuffer();
+    buffer.depth--;
+
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % ProfileThreadBuffer::capacity] = { name, start, end, buffer.depth };
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::MarkFrame() {
+    uint64_t now = Now();
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->frames.push_back(now);
+    if (this->frames.size() > maxFrames) {
+        this->frames.erase(this->frames.begin(), this->frames.begin() + (this->frames.size() - maxFrames));
+    }
+}
+
+void Profiler::AddGpuEvents(std::span<GpuProfileEvent> events) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (auto& event : events) {
+        this->gpuEvents.push_back(std::move(event));
+    }
+    if (this->gpuEvents.size() > maxGpuEvents) {
+        this->gpuEvents.erase(this->gpuEvents.begin(), this->gpuEvents.begin() + (this->gpuEvents.size() - maxGpuEvents));
+    }
+}
+
+std::vector<ProfileThreadSnapshot> Profiler::SnapshotThreads() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::vector<ProfileThreadSnapshot> snapshots;
+    for (const auto& buffer : this->threads) {
+        const uint64_t capacity = ProfileThreadBuffer::capacity;
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = head > capacity ? head - capacity : 0;
+
+        std::vector<ProfileEvent> events;
+        events.reserve(head - begin);
+        for (uint64_t i = begin; i < head; i++) {
+            events.push_back(buffer->events[i % capacity]);
+        }
+
+        // Anything the owner wrapped around onto while we were copying is garbage, as is the slot it may be writing now
+        uint64_t newHead = buffer->head.load(std::memory_order_acquire);
+        uint64_t firstValid = newHead + 1 > capacity ? newHead + 1 - capacity : 0;
+        if (firstValid > begin) {
+            events.erase(events.begin(), events.begin() + std::min<uint64_t>(firstValid - begin, events.size()));
+        }
+        snapshots.push_back({ buffer->name, std::move(events) });
+    }
+    return snapshots;
+}
+
+std::vector<GpuProfileEvent> Profiler::SnapshotGpu() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->gpuEvents;
+}
+
+std::vector<uint64_t> Profiler::SnapshotFrames() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->frames;
+}
+
+void Profiler::ExportChromeTrace(const std::string& filePath) {
+    using nlohmann::json;
+
+    json events = json::array();
+    auto addEvent = [&events](const std::string& name, uint32_t pid, uint32_t tid, uint64_t start, uint64_t end) {
+        events.push_back({ {"name", name}, {"ph", "X"}, {"pid", pid}, {"tid", tid}, {"ts", start / 1000.0}, {"dur", (end - start) / 1000.0} });
+    };
+    auto nameThread = [&events](uint32_t pid, uint32_t tid, const std::string& name) {
+        events.push_back({ {"name", "thread_name"}, {"ph", "M"}, {"pid", pid}, {"tid", tid}, {"args", { {"name", name} }} });
+    };
+
+    std::vector<ProfileThreadSnapshot> threads = this->SnapshotThreads();
+    for (uint32_t i = 0; i < threads.size(); i++) {
+        nameThread(0, i, threads[i].name);
+        for (const auto& event : threads[i].events) {
+            addEvent(event.name, 0, i, event.start, event.end);
+        }
+    }
+
+    nameThread(1, 0, "GPU");
+    for (const auto& event : this->SnapshotGpu()) {
+        addEvent(event.name, 1, 0, event.start, event.end);
+    }
+
+    for (uint64_t frame : this->SnapshotFrames()) {
+        events.push_back({ {"name", "Frame"}, {"ph", "i"}, {"s", "g"}, {"pid", 0}, {"tid", 0}, {"ts", frame / 1000.0} });
+    }
+
+    std::ofstream file(filePath);
+    if (!file.is_open()) {
+        CRITICAL("Couldn't open {} for writing", filePath);
+    }
+    file << json{ {"traceEvents", events}, {"displayTimeUnit", "ms"} }.dump();
+    INFO("Exported {} trace events to {}", events.size(), filePath);
+}
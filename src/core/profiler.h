@@ -0,0 +1,101 @@
+#pragma once
+
+#include "core.h"
+#include "atomic"
+#include "mutex"
+#include "chrono"
+#include "thread"
+#include "span"
+
+// A completed zone, times are nanoseconds since the profiler started
+struct ProfileEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+    uint32_t depth;
+};
+
+// GPU zones come back a few frames late and carry their own copy of the name, pass names don't outlive the frame
+struct GpuProfileEvent {
+    std::string name;
+    uint64_t start;
+    uint64_t end;
+    uint32_t depth;
+    uint64_t frame;
+};
+
+// Written only by its owning thread, readers snapshot it and drop whatever the writer may have lapped in the meantime
+struct ProfileThreadBuffer {
+    static constexpr uint32_t capacity = 1 << 14;
+
+    std::string name;
+    std::array<ProfileEvent, capacity> events;
+    std::atomic<uint64_t> head = 0;
+    uint32_t depth = 0;
+};
+
+struct ProfileThreadSnapshot {
+    std::string name;
+    std::vector<ProfileEvent> events;
+};
+
+class Profiler {
+public:
+    static Profiler& Get();
+
+    static uint64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Get().epoch).count();
+    }
+
+    void SetThreadName(const std::string& name);
+    // Returns the zone's start time, the depth is tracked per thread so zones nest without any shared state
+    uint64_t BeginZone();
+    void EndZone(const char* name, uint64_t start);
+    void MarkFrame();
+
+    // Moves the events out
+    void AddGpuEvents(std::span<GpuProfileEvent> events);
+
+    std::vector<ProfileThreadSnapshot> SnapshotThreads();
+    std::vector<GpuProfileEvent> SnapshotGpu();
+    std::vector<uint64_t> SnapshotFrames();
+
+    // Chrome trace event format, loads in chrome://tracing and ui.perfetto.dev
+    void ExportChromeTrace(const std::string& filePath);
+private:
+    Profiler() : epoch(std::chrono::steady_clock::now()) {}
+    ProfileThreadBuffer& GetThreadBuffer();
+
+    static constexpr size_t maxGpuEvents = 1 << 14;
+    static constexpr size_t maxFrames = 256;
+
+    std::chrono::steady_clock::time_point epoch;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ProfileThreadBuffer>> threads;
+    std::vector<GpuProfileEvent> gpuEvents;
+    std::vector<uint64_t> frames;
+};
+
+class ProfileScope {
+public:
+    ProfileScope(const char* name) : name(name), start(Profiler::Get().BeginZone()) {}
+    ~ProfileScope() { Profiler::Get().EndZone(this->name, this->start); }
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef FENRIR_PROFILING
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_FRAME() Profiler::Get().MarkFrame()
+#define PROFILE_THREAD(name) Profiler::Get().SetThreadName(name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_FRAME()
+#define PROFILE_THREAD(name)
+#endif
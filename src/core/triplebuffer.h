@@ -0,0 +1,63 @@
+#pragma once
+
+#include "core.h"
+#include "atomic"
+
+// Single producer single consumer handoff of whole values. The writer fills its slot and publishes it, the reader
+// swaps in the newest published slot, and the third slot sits between them so neither side ever copies or locks.
+// Slots are reused as is, so containers inside T keep their capacity from frame to frame
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer only
+    T& GetWriteBuffer() { return this->slots[this->writeIndex]; }
+
+    // Writer only, hands the write slot over and takes back whichever slot the reader hasn't picked up
+    void Publish() {
+        uint32_t previous = this->middle.exchange(this->writeIndex | freshBit, std::memory_order_acq_rel);
+        this->writeIndex = previous & indexMask;
+        this->middle.notify_all();
+    }
+
+    // Writer only, blocks until the reader has taken the last published slot
+    void WaitUntilConsumed() {
+        uint32_t state = this->middle.load(std::memory_order_acquire);
+        while (state & freshBit) {
+            this->middle.wait(state, std::memory_order_acquire);
+            state = this->middle.load(std::memory_order_acquire);
+        }
+    }
+
+    // Reader only, returns false when nothing was published since the last call
+    bool Acquire() {
+        if (!(this->middle.load(std::memory_order_acquire) & freshBit)) return false;
+        uint32_t previous = this->middle.exchange(this->readIndex, std::memory_order_acq_rel);
+        this->readIndex = previous & indexMask;
+        this->middle.notify_all();
+        return true;
+    }
+
+    // Reader only, blocks until something is published
+    void WaitForPublish() {
+        uint32_t state = this->middle.load(std::memory_order_acquire);
+        while (!(state & freshBit)) {
+            this->middle.wait(state, std::memory_order_acquire);
+            state = this->middle.load(std::memory_order_acquire);
+        }
+    }
+
+    // Reader only
+    T& GetReadBuffer() { return this->slots[this->readIndex]; }
+private:
+    static constexpr uint32_t indexMask = 3;
+    static constexpr uint32_t freshBit = 4;
+
+    std::array<T, 3> slots;
+    uint32_t writeIndex = 0;
+    alignas(64) std::atomic<uint32_t> middle = 1;
+    alignas(64) uint32_t readIndex = 2;
+};
@@ -0,0 +1,69 @@
+#include "vfs.h"
+#include "filesystem"
+
+FileSystem& FileSystem::Get() {
+    static FileSystem fileSystem;
+    return fileSystem;
+}
+
+bool FileSystem::Mount(const std::string& packPath) {
+    std::unique_ptr<PackFile> pack = std::make_unique<PackFile>();
+    if (!pack->Open(packPath)) return false;
+    INFO("Mounted {} with {} files", packPath, pack->GetFileCount());
+    this->packs.push_back(std::move(pack));
+    return true;
+}
+
+const PackEntry* FileSystem::Find(const std::string& path, const PackFile*& pack) const {
+    if (this->packs.empty()) return nullptr;
+    std::string normalized = NormalizePackPath(path);
+    for (auto it = this->packs.rbegin(); it != this->packs.rend(); it++) {
+        if (const PackEntry* entry = (*it)->Find(normalized)) {
+            pack = it->get();
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+bool FileSystem::Exists(const std::string& path) const {
+    const PackFile* pack;
+    if (this->Find(path, pack)) return true;
+    std::error_code error;
+    return std::filesystem::is_regular_file(path, error);
+}
+
+bool FileSystem::GetSize(const std::string& path, uint64_t& size) const {
+    const PackFile* pack;
+    if (const PackEntry* entry = this->Find(path, pack)) {
+        size = entry->size;
+        return true;
+    }
+    std::error_code error;
+    size = std::filesystem::file_size(path, error);
+    return !error;
+}
+
+bool FileSystem::Read(const std::string& path, uint64_t offset, uint64_t size, char* destination) const {
+    const PackFile* pack;
+    if (const PackEntry* entry = this->Find(path, pack)) {
+        if (!pack->Read(*entry, offset, size, destination)) {
+            WARN("Failed to read {} bytes at {} of {} from {}", size, offset, path, pack->GetPath());
+            return false;
+        }
+        return true;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    file.seekg(offset, std::ios::beg);
+    file.read(destination, size);
+    return (uint64_t)file.gcount() == size;
+}
+
+bool FileSystem::ReadFile(const std::string& path, std::vector<char>& data) const {
+    uint64_t size;
+    if (!this->GetSize(path, size)) return false;
+    data.resize(size);
+    return this->Read(path, 0, size, data.data());
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "core.h"
+#include "pack.h"
+
+// Every asset read goes through here. A file comes out of the newest mounted pack that has it, anything no pack has is
+// read from disk as before. Packs shadow the loose files they contain, so nothing mounts one unless asked to with
+// --pack and edits to loose files show up while iterating on them
+class FileSystem {
+public:
+    static FileSystem& Get();
+
+    // Mount packs before loading starts, reads don't lock. False if it isn't there or can't be read
+    bool Mount(const std::string& packPath);
+
+    bool Exists(const std::string& path) const;
+    bool GetSize(const std::string& path, uint64_t& size) const;
+    // Reads size bytes at offset, packed files only decode the blocks the range covers
+    bool Read(const std::string& path, uint64_t offset, uint64_t size, char* destination) const;
+    bool ReadFile(const std::string& path, std::vector<char>& data) const;
+private:
+    const PackEntry* Find(const std::string& path, const PackFile*& pack) const;
+
+    std::vector<std::unique_ptr<PackFile>> packs;
+};
@@ -0,0 +1,46 @@
+#include "camera.h"
+
+#include "glm/gtc/constants.hpp"
+
+void CameraPath::AddKeyframe(const Camera& camera) {
+    this->keyframes.push_back(camera);
+}
+
+Camera CameraPath::Sample(float t) const {
+    if (this->keyframes.empty()) {
+        CRITICAL("Sampling an empty camera path");
+    }
+    if (this->keyframes.size() == 1) return this->keyframes[0];
+
+    float position = std::clamp(t, 0.0f, 1.0f) * (this->keyframes.size() - 1);
+    size_t index = std::min((size_t)position, this->keyframes.size() - 2);
+    float blend = position - index;
+
+    const Camera& from = this->keyframes[index];
+    const Camera& to = this->keyframes[index + 1];
+    Camera camera = from;
+    camera.eye = glm::mix(from.eye, to.eye, blend);
+    camera.target = glm::mix(from.target, to.target, blend);
+    camera.fov = glm::mix(from.fov, to.fov, blend);
+    return camera;
+}
+
+CameraPath CameraPath::Orbit(const glm::vec3& min, const glm::vec3& max, uint32_t keyframeCount) {
+    glm::vec3 center = (min + max) * 0.5f;
+    float radius = std::max(glm::length(max - min), 0.001f);
+
+    CameraPath path;
+    for (uint32_t i = 0; i <= keyframeCount; i++) {
+        float angle = glm::two_pi<float>() * i / keyframeCount;
+        // Dips below and rises above the model once per loop so both sides of it get drawn
+        float height = std::sin(angle) * radius * 0.5f;
+
+        Camera camera;
+        camera.eye = center + glm::vec3(std::cos(angle) * radius, height, std::sin(angle) * radius);
+        camera.target = center;
+        camera.nearPlane = radius * 0.01f;
+        camera.farPlane = radius * 10.0f;
+        path.AddKeyframe(camera);
+    }
+    return path;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "core/core.h"
+#include "glm/glm.hpp"
+
+struct Camera {
+    glm::vec3 eye;
+    glm::vec3 target;
+    glm::vec3 up = { 0.0f, 1.0f, 0.0f };
+    float fov = 45.0f;
+    float nearPlane = 0.1f;
+    float farPlane = 10000.0f;
+};
+
+// Keyframed camera flight, sampled by normalized time so the same path renders the same frames regardless of frame rate
+class CameraPath {
+public:
+    void AddKeyframe(const Camera& camera);
+    Camera Sample(float t) const;
+    size_t Size() const { return this->keyframes.size(); }
+
+    // Circles the bounds at a few heights, looking at their center
+    static CameraPath Orbit(const glm::vec3& min, const glm::vec3& max, uint32_t keyframeCount = 16);
+private:
+    std::vector<Camera> keyframes;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "core/core.h"
+#include "glm/glm.hpp"
+#include "vulkan/vertex.h"
+#include "filesystem"
+
+// Runtime asset layouts written by fenrir_cook. Each file is a header, then fixed size tables, then the bulk data the
+// tables point into, all little endian and ready to be copied straight into buffers without any parsing
+
+// fenrir_cook's default directories, the runtime looks for cooked copies of sources in the output one
+inline const std::string cookSourceDirectory = "models/samples";
+inline const std::string cookOutputDirectory = "cooked";
+
+// Bumped whenever a layout below or the way the cooker fills it changes, so stale outputs are cooked again
+constexpr uint32_t cookedFormatVersion = 1;
+constexpr uint32_t cookedMeshMagic = 0x48534d46; // "FMSH"
+constexpr uint32_t cookedTextureMagic = 0x58544646; // "FFTX"
+
+// .fmesh: header, primitives, materials, texture references, vertices, then indices. Primitives are the glTF ones
+// flattened out of the node tree, their indices are local to their vertex range like the loader's
+struct CookedMeshHeader {
+    uint32_t magic = cookedMeshMagic;
+    uint32_t version = cookedFormatVersion;
+    uint32_t primitiveCount = 0;
+    uint32_t materialCount = 0;
+    uint32_t textureCount = 0;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    uint32_t padding = 0;
+    glm::vec3 boundsMin{};
+    glm::vec3 boundsMax{};
+};
+
+struct CookedPrimitive {
+    static constexpr uint32_t noMaterial = UINT32_MAX;
+
+    uint32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    uint32_t material = noMaterial;
+};
+
+struct CookedMaterial {
+    static constexpr uint32_t noTexture = UINT32_MAX;
+
+    glm::vec4 baseColorFactor = glm::vec4(1.0f);
+    // Into the mesh's texture references
+    uint32_t baseColorTexture = noTexture;
+    uint32_t padding[3]{};
+};
+
+// Cooked texture relative to the root of the cooked tree, null terminated
+struct CookedTextureReference {
+    char path[256]{};
+};
+
+// .ftex: header, one entry per mip from the largest down, then the mip data. BC formats store 4x4 blocks, mips
+// smaller than a block still take a whole one
+enum class CookedTextureFormat : uint32_t {
+    Rgba8,
+    Bc1,
+    Bc3,
+};
+
+struct CookedTextureHeader {
+    uint32_t magic = cookedTextureMagic;
+    uint32_t version = cookedFormatVersion;
+    CookedTextureFormat format = CookedTextureFormat::Rgba8;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipCount = 0;
+};
+
+struct CookedMip {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // From the start of the file
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+inline uint64_t GetCookedMipSize(CookedTextureFormat format, uint32_t width, uint32_t height) {
+    uint64_t blocks = (uint64_t)((width + 3) / 4) * ((height + 3) / 4);
+    switch (format) {
+    case CookedTextureFormat::Bc1: return blocks * 8;
+    case CookedTextureFormat::Bc3: return blocks * 16;
+    default: return (uint64_t)width * height * 4;
+    }
+}
+
+// Where fenrir_cook's defaults put a model's .fmesh, empty for models outside the source directory
+inline std::string GetCookedMeshPath(const std::string& modelPath) {
+    std::filesystem::path relative = std::filesystem::path(modelPath).lexically_normal().lexically_relative(cookSourceDirectory);
+    if (relative.empty() || *relative.begin() == "..") return "";
+    return (std::filesystem::path(cookOutputDirectory) / relative).replace_extension(".fmesh").generic_string();
+}
+
+// The image a cooked mesh's texture reference was cooked from, which is what the loaders and the streamer take
+inline std::string GetSourceTexturePath(const std::string& reference) {
+    return (std::filesystem::path(cookSourceDirectory) / reference).replace_extension().generic_string();
+}
+
+// Where fenrir_cook's defaults put an image's .ftex, empty for images outside the source directory
+inline std::string GetCookedTexturePath(const std::string& imagePath) {
+    std::filesystem::path relative = std::filesystem::path(imagePath).lexically_normal().lexically_relative(cookSourceDirectory);
+    if (relative.empty() || *relative.begin() == "..") return "";
+    return (std::filesystem::path(cookOutputDirectory) / relative).generic_string() + ".ftex";
+}
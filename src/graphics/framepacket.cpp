@@ -0,0 +1,63 @@
+#include "framepacket.h"
+
+#include "fengui.h"
+
+UiDrawData::UiDrawData() : data(std::make_unique<ImDrawData>()) {}
+
+UiDrawData::~UiDrawData() {
+    this->Clear();
+    for (ImDrawList* list : this->lists) {
+        IM_DELETE(list);
+    }
+}
+
+// CmdLists became an ImVector in ImGui 1.89.8, before that it's a bare array the caller owns
+template<typename DrawData>
+void SetDrawLists(DrawData& data, std::vector<ImDrawList*>& lists, uint32_t count) {
+    if constexpr (std::is_pointer_v<decltype(data.CmdLists)>) {
+        data.CmdLists = lists.data();
+    } else {
+        data.CmdLists.resize((int)count);
+        for (uint32_t i = 0; i < count; i++) data.CmdLists[(int)i] = lists[i];
+    }
+    data.CmdListsCount = (int)count;
+}
+
+// ImVector's assignment frees and reallocates, resizing keeps the capacity
+template<typename T>
+void CopyVector(ImVector<T>& destination, const ImVector<T>& source) {
+    destination.resize(source.Size);
+    if (source.Size != 0) memcpy(destination.Data, source.Data, source.size_in_bytes());
+}
+
+void UiDrawData::CopyFrom(const ImDrawData* source) {
+    this->Clear();
+    if (!source || !source->Valid) return;
+
+    // The same fields ImDrawList::CloneOutput copies
+    for (int i = 0; i < source->CmdListsCount; i++) {
+        const ImDrawList* sourceList = source->CmdLists[i];
+        if (this->count == this->lists.size()) this->lists.push_back(IM_NEW(ImDrawList)(sourceList->_Data));
+        ImDrawList* list = this->lists[this->count++];
+        CopyVector(list->CmdBuffer, sourceList->CmdBuffer);
+        CopyVector(list->IdxBuffer, sourceList->IdxBuffer);
+        CopyVector(list->VtxBuffer, sourceList->VtxBuffer);
+        list->Flags = sourceList->Flags;
+    }
+    this->data->Valid = true;
+    this->data->TotalIdxCount = source->TotalIdxCount;
+    this->data->TotalVtxCount = source->TotalVtxCount;
+    this->data->DisplayPos = source->DisplayPos;
+    this->data->DisplaySize = source->DisplaySize;
+    this->data->FramebufferScale = source->FramebufferScale;
+    // The Vulkan backend keeps its per viewport buffers in the owner's RendererUserData. Viewports live as long as the
+    // ImGui context, so the pointer stays good while the render thread draws
+    this->data->OwnerViewport = source->OwnerViewport;
+    SetDrawLists(*this->data, this->lists, this->count);
+}
+
+void UiDrawData::Clear() {
+    this->count = 0;
+    SetDrawLists(*this->data, this->lists, this->count);
+    this->data->Valid = false;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "core/core.h"
+#include "glm/glm.hpp"
+#include "camera.h"
+#include "vulkan/stats.h"
+#include "modelstreamer.h"
+#include "texturestreamer.h"
+
+struct Mesh;
+class Material;
+struct ImDrawData;
+struct ImDrawList;
+
+struct DrawItem {
+    const Mesh* mesh;
+    const Material* material;
+    glm::mat4 transform;
+};
+
+// Deep copy of a frame's ImGui output. ImGui reuses its own draw lists on the next NewFrame, so the render thread
+// can't read them while the main thread builds the following frame. The copies are kept and refilled, so once they're
+// big enough copying a frame doesn't allocate. Every ImDrawData field the Vulkan backend reads is copied, including
+// the owner viewport
+class UiDrawData {
+public:
+    UiDrawData();
+    ~UiDrawData();
+    UiDrawData(const UiDrawData&) = delete;
+    UiDrawData& operator=(const UiDrawData&) = delete;
+
+    void CopyFrom(const ImDrawData* source);
+    void Clear();
+    ImDrawData* Get() { return this->count == 0 ? nullptr : this->data.get(); }
+private:
+    std::unique_ptr<ImDrawData> data;
+    std::vector<ImDrawList*> lists;
+    uint32_t count = 0;
+};
+
+// Everything the render thread needs for a frame, written by the main thread and read only once published
+struct FramePacket {
+    Camera camera;
+    std::vector<DrawItem> draws;
+    // Packets built before the scene was last replaced point at freed meshes, their draws are skipped
+    uint64_t sceneGeneration = 0;
+
+    // Editor only, the size ImGui laid the viewport out at and the UI to draw over the swapchain
+    glm::uvec2 viewportSize{};
+    UiDrawData ui;
+};
+
+// What the render thread reports back for the UI, copied out under a lock since the originals change every frame
+struct RenderFeedback {
+    FrameStats stats;
+    std::vector<PassStatistics> passes;
+    bool pipelineStatisticsEnabled = false;
+    double gpuFrameTime = 0.0;
+    StreamingStats streaming;
+    TextureStreamingStats textureStreaming;
+};
@@ -1,8 +1,34 @@
 #include "material.h"
 
-#include "spirv_reflect.h"
+#include "vulkan/context.h"
+#include "vulkan/pipeline.h"
+#include "vulkan/uniform.h"
 
-Material::Material(std::shared_ptr<Shader> shader) : shader(shader) 
+Material::Material(Pipeline* pipeline, uint32_t tableIndex) : pipeline(pipeline), tableIndex(tableIndex) 
 {
 
-}
\ No newline at end of file
+}
+
+bool Material::Use(VkCommandBuffer buffer, Context& context, Pipeline* fallback) const {
+    Pipeline* pipeline = this->GetPipeline(fallback);
+    VkPipeline handle = pipeline->GetHandle();
+    if (!handle) return false;
+
+    vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, handle);
+    RenderStats::Get().CountPipelineBind();
+
+    if (pipeline->bindlessSet != UINT32_MAX) {
+        context.bindless.Bind(buffer, pipeline->layout, pipeline->bindlessSet);
+    }
+
+    // View and projection live in set 1, one set per frame in flight that after the first frames always comes from the cache
+    const uint32_t viewProjectionSet = 1;
+    if (pipeline->setLayouts.size() > viewProjectionSet && pipeline->bindlessSet != viewProjectionSet) {
+        DescriptorWriter writer;
+        writer.WriteBuffer(0, context.uniformBuffer, context.GetFrame().uniformOffset, sizeof(UniformBufferObject), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+        VkDescriptorSet viewProjection = context.descriptorCache.Get(pipeline->setLayouts[viewProjectionSet], writer);
+        vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->layout, viewProjectionSet, 1, &viewProjection, 0, nullptr);
+        RenderStats::Get().CountDescriptorBinds(1);
+    }
+    return true;
+}
@@ -1,15 +1,23 @@
 #pragma once
 
-#include "vulkan/shader.h"
 #include "vulkan/vulkan.h"
+#include "core/core.h"
+
+struct Context;
+struct Pipeline;
 
 class Material {
 public:
-	Material(std::shared_ptr<Shader> shader);
-	~Material();
+	// Materials without a pipeline are drawn with the renderer's scene pipeline
+	Material(Pipeline* pipeline = nullptr, uint32_t tableIndex = 0);
+	~Material() = default;
 
-	void Use(VkDescriptorSet set);
+	// Binds the pipeline (the fallback if the material has none) and the per pipeline state it needs, the material
+	// itself travels with each instance as tableIndex. False while the pipeline is still compiling, draws are skipped then
+	bool Use(VkCommandBuffer buffer, Context& context, Pipeline* fallback) const;
+	Pipeline* GetPipeline(Pipeline* fallback) const { return this->pipeline ? this->pipeline : fallback; }
 
-	std::shared_ptr<Shader> shader;
-	VkPipeline pipeline;
-};
\ No newline at end of file
+	Pipeline* pipeline;
+	// Index into the context's bindless material table
+	uint32_t tableIndex;
+};
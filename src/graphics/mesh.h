@@ -6,4 +6,6 @@
 struct Mesh {
 	Buffer<Vertex>::Ref vertices;
 	Buffer<uint32_t>::Ref indices;
+	// Bounding sphere in model space, xyz the center and w the radius. Zero when unknown
+	glm::vec4 bounds{};
 };
\ No newline at end of file
@@ -4,24 +4,43 @@
 #include "glm/gtx/transform.hpp"
 #include "glm/gtx/quaternion.hpp"
 #include "glm/gtc/type_ptr.hpp"
+#include "limits"
 
 #include "vulkan/context.h"
 #include "vulkan/image.h"
 #include "vulkan/pipeline.h"
+#include "texturestreamer.h"
+#include "cooked.h"
+#include "core/jobsystem.h"
+#include "core/arena.h"
+#include "core/vfs.h"
 
 using namespace nlohmann;
 
-Model::Model(Context* renderContext, const std::string& path, glm::mat4 globalTransform) {
-    this->context.renderContext = renderContext;
+Model::Model(Context* renderContext, const std::string& path, glm::mat4 globalTransform, bool cooked) {
+    PROFILE_FUNCTION();
+    this->context.renderContext = nullptr;
     this->context.filePath = path;
 
-    std::ifstream file(path);
-    if (!file.is_open()) {
+    if (!cooked || !this->LoadCooked(GetCookedMeshPath(path))) this->LoadGltf(path);
+
+    // Tools and the streamer load on the CPU only and upload later, if at all
+    if (renderContext) {
+        // Streamed textures are read by the streamer
+        if (!renderContext->textureStreamer) this->DecodeTextures();
+        this->Upload(renderContext);
+    }
+
+    INFO("Loaded model with {} vertices and {} indices", context.vertices.size(), context.indices.size());
+}
+
+void Model::LoadGltf(const std::string& path) {
+    std::vector<char> bytes;
+    if (!FileSystem::Get().ReadFile(path, bytes)) {
         CRITICAL("Couldn't open file {}", path);
     }
 
-    json data;
-    file >> data;
+    json data = json::parse(bytes.begin(), bytes.end());
     uint32_t sceneNumber = data["scene"];
     json scene = data["scenes"][sceneNumber];
 
@@ -30,37 +49,248 @@ Model::Model(Context* renderContext, const std::string& path, glm::mat4 globalTr
         INFO("Loading scene: {}", this->sceneName);
     }
 
+    this->LoadMaterials(data);
+
     std::vector<uint32_t> nodeIndices = scene["nodes"];
     for (const auto nodeIndex : nodeIndices) {
         this->nodes.push_back(std::make_unique<Node>(&context, nullptr, data, data["nodes"][nodeIndex]));
     }
+}
+
+bool Model::LoadCooked(const std::string& cookedPath) {
+    PROFILE_FUNCTION();
+    std::vector<char> bytes;
+    if (cookedPath.empty() || !FileSystem::Get().Exists(cookedPath) || !FileSystem::Get().ReadFile(cookedPath, bytes)) return false;
+
+    CookedMeshHeader header;
+    if (bytes.size() >= sizeof(header)) memcpy(&header, bytes.data(), sizeof(header));
+    if (bytes.size() < sizeof(header) || header.magic != cookedMeshMagic || header.version != cookedFormatVersion) {
+        WARN("{} isn't a mesh this build can read, loading the source instead", cookedPath);
+        return false;
+    }
+    uint64_t size = sizeof(header) + (uint64_t)header.primitiveCount * sizeof(CookedPrimitive) + (uint64_t)header.materialCount * sizeof(CookedMaterial) +
+        (uint64_t)header.textureCount * sizeof(CookedTextureReference) + (uint64_t)header.vertexCount * sizeof(Vertex) + (uint64_t)header.indexCount * sizeof(uint32_t);
+    if (bytes.size() != size) {
+        WARN("{} is {} bytes instead of {}, loading the source instead", cookedPath, bytes.size(), size);
+        return false;
+    }
 
-    context.vertexBuffer.Init(context.renderContext, context.vertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-    context.indexBuffer.Init(context.renderContext, context.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    // Nothing in the file is aligned beyond 4 bytes, so the tables are copied out rather than pointed into
+    const char* cursor = bytes.data() + sizeof(header);
+    auto copyOut = [&cursor]<class T>(std::vector<T>& destination, uint32_t count) {
+        destination.resize(count);
+        memcpy(destination.data(), cursor, (size_t)count * sizeof(T));
+        cursor += (size_t)count * sizeof(T);
+    };
+    std::vector<CookedPrimitive> primitives;
+    std::vector<CookedMaterial> materials;
+    std::vector<CookedTextureReference> textures;
+    copyOut(primitives, header.primitiveCount);
+    copyOut(materials, header.materialCount);
+    copyOut(textures, header.textureCount);
+    for (const CookedPrimitive& primitive : primitives) {
+        if ((uint64_t)primitive.vertexOffset + primitive.vertexCount > header.vertexCount || (uint64_t)primitive.indexOffset + primitive.indexCount > header.indexCount) {
+            WARN("{} has a primitive past the end of its buffers, loading the source instead", cookedPath);
+            return false;
+        }
+    }
+    copyOut(context.vertices, header.vertexCount);
+    copyOut(context.indices, header.indexCount);
 
-    INFO("Vertex buffer length: {}", context.vertices.size());
+    for (const CookedTextureReference& texture : textures) {
+        context.texturePaths.push_back(GetSourceTexturePath(std::string(texture.path, strnlen(texture.path, sizeof(texture.path)))));
+    }
+    for (const CookedMaterial& material : materials) {
+        MaterialSource source;
+        source.baseColorFactor = material.baseColorFactor;
+        if (material.baseColorTexture < context.texturePaths.size()) source.baseColorTexture = material.baseColorTexture;
+        context.materialSources.push_back(source);
+    }
+    this->CreateMaterials();
 
-    INFO("Loaded model");
+    // The cooker flattened the node tree, every primitive hangs off a single node
+    std::unique_ptr<Node> root = std::make_unique<Node>(&context, nullptr);
+    for (const CookedPrimitive& primitive : primitives) {
+        root->geometries.push_back(std::make_unique<Geometry>(&context, primitive));
+    }
+    this->nodes.push_back(std::move(root));
+    return true;
+}
+
+void Model::LoadMaterials(json& data) {
+    PROFILE_FUNCTION();
+    if (data.contains("textures")) {
+        for (auto& texture : data["textures"]) {
+            if (!texture.contains("source") || !data["images"][(uint32_t)texture["source"]].contains("uri")) {
+                context.texturePaths.emplace_back();
+                continue;
+            }
+            std::string uri = data["images"][(uint32_t)texture["source"]]["uri"];
+            std::filesystem::path imagePath = context.filePath;
+            imagePath.replace_filename(uri);
+            context.texturePaths.push_back(imagePath.string());
+        }
+    }
+
+    if (data.contains("materials")) {
+        for (auto& material : data["materials"]) {
+            MaterialSource source;
+            json pbr = material.value("pbrMetallicRoughness", json::object());
+            if (pbr.contains("baseColorFactor")) {
+                std::vector<float> baseColorFactor = pbr["baseColorFactor"];
+                source.baseColorFactor = { baseColorFactor[0], baseColorFactor[1], baseColorFactor[2], baseColorFactor[3] };
+            }
+            if (pbr.contains("baseColorTexture")) {
+                uint32_t textureIndex = pbr["baseColorTexture"]["index"];
+                if (textureIndex < context.texturePaths.size()) source.baseColorTexture = textureIndex;
+            }
+            context.materialSources.push_back(source);
+        }
+    }
+
+    this->CreateMaterials();
+}
+
+void Model::CreateMaterials() {
+    for (uint32_t i = 0; i < context.materialSources.size(); i++) {
+        context.materials.push_back(std::make_unique<Material>(nullptr, i));
+    }
+    context.defaultMaterial = std::make_unique<Material>();
+}
+
+void Model::DecodeTextures() {
+    PROFILE_FUNCTION();
+    const std::vector<std::string>& imagePaths = context.texturePaths;
+    // Decoding dominates texture loading and is independent per image
+    context.decodedTextures.resize(imagePaths.size());
+    JobSystem::Get().ParallelFor((uint32_t)imagePaths.size(), [&](uint32_t i, uint32_t) {
+        PROFILE_SCOPE("Decode texture");
+        if (imagePaths[i].empty()) return;
+        try {
+            context.decodedTextures[i] = Image::DecodeImage(imagePaths[i]);
+        }
+        catch (const std::exception&) {
+            // Already logged, thrown again from this thread below since a job can't throw
+        }
+    });
+
+    for (uint32_t i = 0; i < imagePaths.size(); i++) {
+        if (!imagePaths[i].empty() && context.decodedTextures[i].data.empty()) {
+            CRITICAL("Failed to load image: {}", imagePaths[i]);
+        }
+    }
+}
+
+void Model::Upload(Context* renderContext) {
+    std::vector<std::unique_ptr<Buffer<uint8_t>>> staging;
+    renderContext->StartAndSubmitCommandBuffer(renderContext->graphics, [&](VkCommandBuffer commandBuffer) {
+        this->Upload(renderContext, commandBuffer, staging);
+    });
+}
+
+void Model::Upload(Context* renderContext, VkCommandBuffer commandBuffer, std::vector<std::unique_ptr<Buffer<uint8_t>>>& staging) {
+    PROFILE_FUNCTION();
+    context.renderContext = renderContext;
+    BindlessTable& bindless = renderContext->bindless;
+    {
+        PROFILE_SCOPE("Upload model buffers");
+        context.vertexBuffer.Init(renderContext, context.vertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+        context.indexBuffer.Init(renderContext, context.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    }
+
+    // Textures that weren't decoded (streamed, or a path without an image) sample the default one
+    for (uint32_t i = 0; i < context.decodedTextures.size(); i++) {
+        if (context.decodedTextures[i].data.empty()) {
+            context.textureIndices.push_back(BindlessTable::defaultTexture);
+            continue;
+        }
+        context.textures.push_back(Image::CreateFromPixels(renderContext, context.decodedTextures[i], commandBuffer, staging.emplace_back()));
+        Image* image = context.textures.back().get();
+        context.textureIndices.push_back(bindless.AddTexture(image->GetImageView(VK_IMAGE_ASPECT_COLOR_BIT), image->GetSampler()));
+    }
+    context.decodedTextures.clear();
+
+    TextureStreamer* streamer = renderContext->textureStreamer;
+    for (uint32_t i = 0; i < context.materialSources.size(); i++) {
+        const MaterialSource& source = context.materialSources[i];
+        GpuMaterial gpuMaterial;
+        gpuMaterial.baseColorFactor = source.baseColorFactor;
+        if (source.baseColorTexture < context.textureIndices.size()) gpuMaterial.baseColorTexture = context.textureIndices[source.baseColorTexture];
+        context.materials[i]->tableIndex = bindless.AddMaterial(gpuMaterial);
+
+        context.streamedTextures.push_back(TextureStreamer::noTexture);
+        if (streamer && source.baseColorTexture != MaterialSource::noTexture && !context.texturePaths[source.baseColorTexture].empty()) {
+            context.streamedTextures.back() = streamer->Add(context.texturePaths[source.baseColorTexture], context.materials[i]->tableIndex);
+        }
+    }
+    context.defaultMaterial->tableIndex = bindless.AddMaterial(GpuMaterial{});
+    INFO("Loaded {} textures and {} materials", context.textures.size(), context.materials.size());
+}
+
+void Model::FreeGeometryData() {
+    context.vertices = {};
+    context.indices = {};
+}
+
+uint64_t Model::GetGpuSize() const {
+    uint64_t size = context.vertices.size() * sizeof(Vertex) + context.indices.size() * sizeof(uint32_t);
+    // A full mip chain adds a third on top of the base level
+    for (const auto& image : context.textures) size += (uint64_t)image->width * image->height * 4 * 4 / 3;
+    for (const auto& pixels : context.decodedTextures) size += (uint64_t)pixels.width * pixels.height * 4 * 4 / 3;
+    return size;
 }
 
 void Model::Render(VkCommandBuffer buffer) {
+    this->BindBuffers(buffer);
+    for (auto& node : this->nodes) {
+        node->Render(buffer);
+    }
+}
+
+void Model::BindBuffers(VkCommandBuffer buffer) {
     VkDeviceSize offsets[] = { 0 };
     vkCmdBindVertexBuffers(buffer, 0, 1, &context.vertexBuffer.buffer, offsets);
     vkCmdBindIndexBuffer(buffer, context.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+    RenderStats::Get().CountBufferBinds(2);
+}
+
+void Model::CollectDraws(std::vector<const Geometry*>& draws) const {
     for (auto& node : this->nodes) {
-        node->Render(buffer);
+        node->CollectDraws(draws);
+    }
+}
+
+void Model::GetBounds(glm::vec3& min, glm::vec3& max) const {
+    min = glm::vec3(std::numeric_limits<float>::max());
+    max = glm::vec3(std::numeric_limits<float>::lowest());
+    for (const auto& vertex : this->context.vertices) {
+        min = glm::min(min, vertex.pos);
+        max = glm::max(max, vertex.pos);
+    }
+    if (this->context.vertices.empty()) {
+        min = max = glm::vec3(0.0f);
     }
 }
 
 Model::~Model() {
     context.vertexBuffer.Destroy();
     context.indexBuffer.Destroy();
+    if (!context.renderContext) return;
+    BindlessTable& bindless = context.renderContext->bindless;
+    for (uint32_t i = 0; i < context.streamedTextures.size(); i++) {
+        if (context.streamedTextures[i] == TextureStreamer::noTexture) continue;
+        context.renderContext->textureStreamer->Remove(context.streamedTextures[i], context.materials[i]->tableIndex);
+    }
+    for (auto& material : context.materials) bindless.RemoveMaterial(material->tableIndex);
+    bindless.RemoveMaterial(context.defaultMaterial->tableIndex);
+    for (uint32_t index : context.textureIndices) bindless.RemoveTexture(index);
 }
 
 Node::Node(ModelContext* context, Node* parent, json data, json node) : parent(parent), context(context) {
     if (node.contains("name")) {
         this->name = node["name"];
-        INFO("Loading node: {}", this->name);
+        // Large scenes have thousands of these, they'd be most of the load time if every one was written out
+        DEBUG_LIMITED("Loading node: {}", this->name);
     }
 
     if (node.contains("mesh")) {
@@ -69,7 +299,7 @@ Node::Node(ModelContext* context, Node* parent, json data, json node) : parent(p
 
         if (node.contains("name")) {
             this->meshName = mesh["name"];
-            INFO("Loading mesh: {}", this->meshName);
+            DEBUG_LIMITED("Loading mesh: {}", this->meshName);
         }
 
         std::vector<json> primitives = mesh["primitives"];
@@ -96,6 +326,16 @@ void Node::Render(VkCommandBuffer buffer) {
     }
 }
 
+void Node::CollectDraws(std::vector<const Geometry*>& draws) const {
+    for (auto& geometry : this->geometries) {
+        draws.push_back(geometry.get());
+    }
+
+    for (auto& child : this->children) {
+        child->CollectDraws(draws);
+    }
+}
+
 uint32_t sizeOfComponentType(uint32_t componentType) {
     switch (componentType) {
     case 5120: return 1;
@@ -135,7 +375,8 @@ uint32_t sizeOfType(const std::string& type) {
     CRITICAL("Invalid type: {}", type);
 }
 
-std::vector<char> readAccessorData(std::filesystem::path path, json data, json accessor, uint32_t& count, uint32_t& size) {
+// Allocated from memory, loaders pass their scratch arena since the bytes only live until they're unpacked
+std::pmr::vector<char> readAccessorData(std::filesystem::path path, json data, json accessor, uint32_t& count, uint32_t& size, std::pmr::memory_resource* memory) {
     if (!accessor.contains("bufferView")) {
         CRITICAL("An accessor doesn't have a buffer view");
     }
@@ -159,70 +400,80 @@ std::vector<char> readAccessorData(std::filesystem::path path, json data, json a
     count = accessor["count"];
     size = sizeOfComponentType(accessor["componentType"]) * sizeOfType(accessor["type"]) * count;
 
-    // Open file and read data
+    // Only the accessor's range is read, out of a pack that decodes just the blocks it covers
     if (!buffer.contains("uri")) {
         CRITICAL("Buffer doesn't have a uri");
     }
     std::string uri = buffer["uri"];
-    std::ifstream file(path.replace_filename(uri), std::ios::binary);
-    if (!file.is_open()) {
-        CRITICAL("Couldn't open file {}", "models/" + uri);
+    std::string bufferPath = path.replace_filename(uri).string();
+    std::pmr::vector<char> bytes(size, memory);
+    if (!FileSystem::Get().Read(bufferPath, offset, size, bytes.data())) {
+        CRITICAL("Couldn't read {} bytes at {} of {}", size, offset, bufferPath);
     }
 
-    file.seekg(offset, std::ios::beg);
-    std::vector<char> bytes(size);
-    file.read(bytes.data(), bytes.size());
-    file.close();
-
     return bytes;
 }
 
 Geometry::Geometry(ModelContext* context, Node* parent, nlohmann::json& data, nlohmann::json& primitive) : context(context) {
+    // The base colour lives in the material table, vertex colours stay white
     glm::vec3 color = { 1.0f, 1.0f, 1.0f };
+    this->material = context->defaultMaterial.get();
     if (primitive.contains("material")) {
         uint32_t materialIndex = primitive["material"];
-        json material = data["materials"][materialIndex];
-        if (material.contains("pbrMetallicRoughness")) {
-            json pbr = material["pbrMetallicRoughness"];
-            if (pbr.contains("baseColorFactor")) {
-                std::vector<float> baseColorFactor = pbr["baseColorFactor"];
-                color = { baseColorFactor[0], baseColorFactor[1], baseColorFactor[2] };
-            }
-        }
+        if (materialIndex < context->materials.size()) this->material = context->materials[materialIndex].get();
     }
 
+    ScratchScope scratch;
     json attributes = primitive["attributes"];
     if (attributes.contains("POSITION")) {
         uint32_t vertexAccessorIndex = attributes["POSITION"];
         json vertexAccessor = data["accessors"][vertexAccessorIndex];
 
         uint32_t normalCount, normalSize;
-        std::vector<char> normalBuffer;
+        std::pmr::vector<char> normalBuffer(scratch.Get());
 
         if (attributes.contains("NORMAL")) {
             uint32_t normalAccessorIndex = attributes["NORMAL"];
             json normalAccessor = data["accessors"][normalAccessorIndex];
-            normalBuffer = readAccessorData(context->filePath, data, normalAccessor, normalCount, normalSize);
+            normalBuffer = readAccessorData(context->filePath, data, normalAccessor, normalCount, normalSize, scratch.Get());
         }
 
-        std::vector<char> uvBuffer;
+        uint32_t uvCount = 0, uvSize;
+        std::pmr::vector<char> uvBuffer(scratch.Get());
+        if (attributes.contains("TEXCOORD_0")) {
+            uint32_t uvAccessorIndex = attributes["TEXCOORD_0"];
+            json uvAccessor = data["accessors"][uvAccessorIndex];
+            // Only float UVs, normalized integer ones are rare enough to leave at zero
+            if (uvAccessor["componentType"] == 5126) uvBuffer = readAccessorData(context->filePath, data, uvAccessor, uvCount, uvSize, scratch.Get());
+        }
 
         uint32_t count, size;
-        std::vector<char> buffer = readAccessorData(context->filePath, data, vertexAccessor, count, size);
+        std::pmr::vector<char> buffer = readAccessorData(context->filePath, data, vertexAccessor, count, size, scratch.Get());
 
         this->mesh.vertices.offset = context->vertices.size();
         this->mesh.vertices.buffer = &context->vertexBuffer;
         this->mesh.vertices.size = count;
         context->vertices.resize(context->vertices.size() + count);
 
+        glm::vec3 min(std::numeric_limits<float>::max());
+        glm::vec3 max(std::numeric_limits<float>::lowest());
         for (uint32_t i = 0; i < count; i++) {
             glm::vec3 position;
             position.x = *(float*)(buffer.data() + i * 12 + 0);
             position.y = *(float*)(buffer.data() + i * 12 + 4);
             position.z = *(float*)(buffer.data() + i * 12 + 8);
+            min = glm::min(min, position);
+            max = glm::max(max, position);
+
+            glm::vec2 uv{};
+            if (i < uvCount) {
+                uv.x = *(float*)(uvBuffer.data() + i * 8 + 0);
+                uv.y = *(float*)(uvBuffer.data() + i * 8 + 4);
+            }
 
-            context->vertices[this->mesh.vertices.offset + i] = { position, color };
+            context->vertices[this->mesh.vertices.offset + i] = { position, color, uv };
         }
+        if (count > 0) this->mesh.bounds = glm::vec4((min + max) * 0.5f, glm::length(max - min) * 0.5f);
     }
 
     if (primitive.contains("indices")) {
@@ -230,7 +481,7 @@ Geometry::Geometry(ModelContext* context, Node* parent, nlohmann::json& data, nl
         json indexAccessor = data["accessors"][indexAccessorIndex];
 
         uint32_t count, size;
-        std::vector<char> buffer = readAccessorData(context->filePath, data, indexAccessor, count, size);
+        std::pmr::vector<char> buffer = readAccessorData(context->filePath, data, indexAccessor, count, size, scratch.Get());
 
         this->mesh.indices.offset = context->indices.size();
         this->mesh.indices.buffer = &context->indexBuffer;
@@ -255,9 +506,24 @@ Geometry::Geometry(ModelContext* context, Node* parent, nlohmann::json& data, nl
     }
 }
 
+Geometry::Geometry(ModelContext* context, const CookedPrimitive& primitive) : context(context) {
+    this->material = primitive.material < context->materials.size() ? context->materials[primitive.material].get() : context->defaultMaterial.get();
+    this->mesh.vertices = context->vertexBuffer.GetRef(primitive.vertexOffset, primitive.vertexCount);
+    this->mesh.indices = context->indexBuffer.GetRef(primitive.indexOffset, primitive.indexCount);
+
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    for (uint32_t i = 0; i < primitive.vertexCount; i++) {
+        min = glm::min(min, context->vertices[primitive.vertexOffset + i].pos);
+        max = glm::max(max, context->vertices[primitive.vertexOffset + i].pos);
+    }
+    if (primitive.vertexCount > 0) this->mesh.bounds = glm::vec4((min + max) * 0.5f, glm::length(max - min) * 0.5f);
+}
+
 Geometry::~Geometry() {}
 
 void Geometry::Render(VkCommandBuffer buffer) const {
     VkDeviceSize offsets[] = { 0 };
     vkCmdDrawIndexed(buffer, (uint32_t)this->mesh.indices.size, 1, (uint32_t)this->mesh.indices.offset, (int32_t)this->mesh.vertices.offset, 0);
+    RenderStats::Get().CountDraw((uint32_t)this->mesh.indices.size);
 }
@@ -6,20 +6,47 @@
 #include "vulkan/uniform.h"
 #include "vulkan/image.h"
 #include "mesh.h"
+#include "material.h"
 
 #include "nlohmann/json.hpp"
 
+struct CookedPrimitive;
+
+// What a glTF material asked for, kept with or without a render context so tools can read it
+struct MaterialSource {
+    static constexpr uint32_t noTexture = UINT32_MAX;
+
+    glm::vec4 baseColorFactor = glm::vec4(1.0f);
+    // glTF texture index, noTexture when it has none
+    uint32_t baseColorTexture = noTexture;
+};
+
 struct ModelContext {
-    Context* renderContext;
+    // Null until uploaded, models loaded on the CPU only (the asset cooker, the streamer's workers) have materials whose
+    // table indices are their glTF indices until then
+    Context* renderContext = nullptr;
     std::filesystem::path filePath;
     std::vector<Vertex> vertices;
     Buffer<Vertex> vertexBuffer;
     std::vector<uint32_t> indices;
     Buffer<uint32_t> indexBuffer;
+    // Source image per glTF texture, empty for ones without a uri
+    std::vector<std::string> texturePaths;
+    std::vector<MaterialSource> materialSources;
+    // Per glTF texture between DecodeTextures and Upload, empty for ones that weren't decoded
+    std::vector<Image::Pixels> decodedTextures;
+    // Bindless table indices per glTF texture, materials point into the table too
+    std::vector<std::unique_ptr<Image>> textures;
+    std::vector<uint32_t> textureIndices;
+    // Per material, the TextureStreamer texture its base colour streams from (noTexture when it doesn't)
+    std::vector<uint32_t> streamedTextures;
+    std::vector<std::unique_ptr<Material>> materials;
+    std::unique_ptr<Material> defaultMaterial;
 };
 
 struct Geometry {
     Geometry(ModelContext* context, struct Node* parent, nlohmann::json& data, nlohmann::json& primitive);
+    Geometry(ModelContext* context, const CookedPrimitive& primitive);
     ~Geometry();
 
     void Render(VkCommandBuffer buffer) const;
@@ -27,6 +54,7 @@ struct Geometry {
     ModelContext* context;
     
     Mesh mesh;
+    const Material* material = nullptr;
 };
 
 struct Node {
@@ -38,7 +66,9 @@ struct Node {
     std::vector<std::unique_ptr<Geometry>> geometries;
 
     Node(ModelContext* context, Node* parent, nlohmann::json data, nlohmann::json node);
+    Node(ModelContext* context, Node* parent) : context(context), parent(parent) {}
     void Render(VkCommandBuffer buffer);
+    void CollectDraws(std::vector<const Geometry*>& draws) const;
 };
 
 struct Model {
@@ -46,7 +76,31 @@ struct Model {
     std::string sceneName;
     std::vector<std::unique_ptr<Node>> nodes;
 
-    Model(Context* context, const std::string& path, glm::mat4 globalTransform = glm::mat4(1.0f));
+    // Without a render context nothing touches the GPU, so it's safe on any thread. DecodeTextures and Upload finish it.
+    // The model's .fmesh is read instead of the glTF when fenrir_cook made one, unless cooked is false
+    Model(Context* context, const std::string& path, glm::mat4 globalTransform = glm::mat4(1.0f), bool cooked = true);
     ~Model();
+    void LoadGltf(const std::string& path);
+    // False when there's no cooked copy this build can read
+    bool LoadCooked(const std::string& cookedPath);
+    void LoadMaterials(nlohmann::json& data);
+    // Table indices are the glTF ones until Upload adds the materials to the bindless table
+    void CreateMaterials();
+    // Decodes every texture on the job system, any thread
+    void DecodeTextures();
+    // Creates the buffers, textures and bindless entries, on the thread that owns the graphics queue. Textures go up
+    // through a one time submit that waits for the queue
+    void Upload(Context* renderContext);
+    // Records the texture copies into commandBuffer instead, their staging buffers are added to staging and have to
+    // outlive its execution
+    void Upload(Context* renderContext, VkCommandBuffer commandBuffer, std::vector<std::unique_ptr<Buffer<uint8_t>>>& staging);
+    // Drops the CPU side vertices and indices once they're uploaded, bounds and sizes can't be measured after that
+    void FreeGeometryData();
+    // Device memory the model takes once uploaded, estimated from the decoded textures before then. Streamed textures
+    // aren't included, they come out of the texture streamer's budget
+    uint64_t GetGpuSize() const;
     void Render(VkCommandBuffer buffer);
+    void BindBuffers(VkCommandBuffer buffer);
+    // Flattens the node hierarchy so draws can be split up and recorded on several threads
+    void CollectDraws(std::vector<const Geometry*>& draws) const;
 };
\ No newline at end of file
@@ -0,0 +1,273 @@
+#include "modelstreamer.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+#include "limits"
+
+#include "vulkan/context.h"
+#include "vulkan/image.h"
+#include "core/jobsystem.h"
+#include "core/arena.h"
+#include "core/profiler.h"
+#include "core/vfs.h"
+
+using namespace nlohmann;
+
+// Enough of an image for stb to read the size of a PNG or a JPEG without much metadata in front of its frame header
+static constexpr uint64_t imageHeaderSize = 64 * 1024;
+
+static glm::vec3 ToVec3(const json& values) {
+    return { values[0].get<float>(), values[1].get<float>(), values[2].get<float>() };
+}
+
+void ModelStreamer::Init(Context* context, uint64_t budget) {
+    this->context = context;
+    this->SetBudget(budget);
+}
+
+void ModelStreamer::Destroy() {
+    // Probes and loads still running point at the entries
+    JobSystem::Get().WaitIdle();
+    this->added.clear();
+    this->entries.clear();
+    this->FreeRetired(true);
+    this->residentBytes = 0;
+}
+
+void ModelStreamer::Add(const std::string& path, const glm::mat4& transform, float priority) {
+    std::unique_ptr<Entry> entry = std::make_unique<Entry>();
+    entry->path = path;
+    entry->transform = transform;
+    entry->priority = priority;
+    Entry* probed = entry.get();
+    {
+        std::lock_guard<std::mutex> lock(this->addedMutex);
+        this->added.push_back(std::move(entry));
+    }
+    JobSystem::Get().Submit([this, probed](uint32_t) { this->Probe(*probed); });
+}
+
+bool ModelStreamer::AddWorld(const std::string& path) {
+    std::vector<char> bytes;
+    if (!FileSystem::Get().ReadFile(path, bytes)) {
+        WARN("Couldn't open world {}", path);
+        return false;
+    }
+    json data = json::parse(bytes.begin(), bytes.end(), nullptr, false);
+    if (data.is_discarded() || !data.contains("models")) {
+        WARN("{} isn't a world file", path);
+        return false;
+    }
+
+    // Model paths are relative to the working directory like every other asset path
+    for (auto& model : data["models"]) {
+        glm::mat4 transform(1.0f);
+        if (model.contains("position")) transform = glm::translate(transform, ToVec3(model["position"]));
+        if (model.contains("scale")) transform = glm::scale(transform, glm::vec3(model["scale"].get<float>()));
+        this->Add(model["path"].get<std::string>(), transform, model.value("priority", 1.0f));
+    }
+    INFO("Streaming {} models from {}", data["models"].size(), path);
+    return true;
+}
+
+// Sizes everything from the glTF alone, parsing it is a fraction of a load and nothing big is read
+void ModelStreamer::Probe(Entry& entry) {
+    PROFILE_FUNCTION();
+    try {
+        std::vector<char> bytes;
+        if (!FileSystem::Get().ReadFile(entry.path, bytes)) {
+            CRITICAL("Couldn't open file {}", entry.path);
+        }
+        json data = json::parse(bytes.begin(), bytes.end());
+
+        // Meshes instanced by several nodes are counted once, the load measures them properly
+        const json accessors = data.value("accessors", json::array());
+        glm::vec3 min(std::numeric_limits<float>::max());
+        glm::vec3 max(std::numeric_limits<float>::lowest());
+        uint64_t size = 0;
+        for (auto& mesh : data.value("meshes", json::array())) {
+            for (auto& primitive : mesh.value("primitives", json::array())) {
+                json attributes = primitive.value("attributes", json::object());
+                if (attributes.contains("POSITION")) {
+                    const json& accessor = accessors.at((uint32_t)attributes["POSITION"]);
+                    size += accessor.value("count", 0ull) * sizeof(Vertex);
+                    if (accessor.contains("min") && accessor.contains("max")) {
+                        min = glm::min(min, ToVec3(accessor["min"]));
+                        max = glm::max(max, ToVec3(accessor["max"]));
+                    }
+                }
+                if (primitive.contains("indices")) {
+                    size += accessors.at((uint32_t)primitive["indices"]).value("count", 0ull) * sizeof(uint32_t);
+                }
+            }
+        }
+
+        // Streamed textures come out of a budget of their own
+        std::vector<char> header;
+        json images = this->context->textureStreamer ? json::array() : data.value("images", json::array());
+        for (auto& image : images) {
+            if (!image.contains("uri")) continue;
+            std::filesystem::path imagePath = entry.path;
+            imagePath.replace_filename(image["uri"].get<std::string>());
+            uint64_t fileSize;
+            if (!FileSystem::Get().GetSize(imagePath.string(), fileSize)) continue;
+            header.resize(std::min(fileSize, imageHeaderSize));
+            int width, height, channels;
+            if (FileSystem::Get().Read(imagePath.string(), 0, header.size(), header.data()) &&
+                stbi_info_from_memory((const stbi_uc*)header.data(), (int)header.size(), &width, &height, &channels)) {
+                // Uploaded as RGBA8 with a full mip chain
+                size += (uint64_t)width * height * 4 * 4 / 3;
+            }
+        }
+
+        if (min.x > max.x) min = max = glm::vec3(0.0f);
+        entry.measured = Measure(entry.transform, min, max, size);
+        entry.state.store(State::Unloaded, std::memory_order_release);
+    }
+    catch (const std::exception& exception) {
+        WARN("Not streaming {}, it couldn't be read: {}", entry.path, exception.what());
+        entry.state.store(State::Failed, std::memory_order_release);
+    }
+}
+
+void ModelStreamer::Load(Entry& entry) {
+    PROFILE_FUNCTION();
+    try {
+        std::unique_ptr<Model> model = std::make_unique<Model>(nullptr, entry.path);
+        // Streamed textures are read by the texture streamer once the model's uploaded
+        if (!this->context->textureStreamer) model->DecodeTextures();
+        glm::vec3 min, max;
+        model->GetBounds(min, max);
+        entry.measured = Measure(entry.transform, min, max, model->GetGpuSize());
+        entry.model = std::move(model);
+        entry.state.store(State::Loaded, std::memory_order_release);
+    }
+    catch (const std::exception& exception) {
+        WARN("Not streaming {} any more, loading it failed: {}", entry.path, exception.what());
+        entry.state.store(State::Failed, std::memory_order_release);
+    }
+}
+
+ModelStreamer::Extent ModelStreamer::Measure(const glm::mat4& transform, glm::vec3 min, glm::vec3 max, uint64_t size) {
+    glm::vec3 center = (min + max) * 0.5f;
+    // The largest axis scale keeps the sphere around the model when it's scaled unevenly
+    float scale = std::max({ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) });
+    return { glm::vec3(transform * glm::vec4(center, 1.0f)), glm::length(max - center) * scale, size };
+}
+
+void ModelStreamer::Update(const glm::vec3& eye, VkCommandBuffer commandBuffer) {
+    PROFILE_FUNCTION();
+    {
+        std::lock_guard<std::mutex> lock(this->addedMutex);
+        for (auto& entry : this->added) this->entries.push_back(std::move(entry));
+        this->added.clear();
+    }
+    this->FreeRetired(false);
+
+    ScratchScope scratch;
+    std::pmr::vector<Entry*> ranked(scratch.Get());
+    ranked.reserve(this->entries.size());
+    uint32_t loading = 0;
+    uint32_t resident = 0;
+    for (auto& entry : this->entries) {
+        State state = entry->state.load(std::memory_order_acquire);
+        if (state == State::Loading) loading++;
+        if (state == State::Resident) resident++;
+        if (state == State::Probing || state == State::Failed) continue;
+        // Loading entries' measurements are still being written
+        if (state == State::Unloaded || state == State::Loaded) entry->extent = entry->measured;
+        // Anything the camera is inside of counts as right next to it
+        float distance = std::max(glm::length(entry->extent.center - eye) - entry->extent.radius, 1.0f);
+        entry->score = entry->priority / distance;
+        ranked.push_back(entry.get());
+    }
+    std::sort(ranked.begin(), ranked.end(), [](const Entry* a, const Entry* b) { return a->score > b->score; });
+
+    // The best ranked models that fit the budget should be resident, a model too big to fit doesn't hold up the rest.
+    // The rest stay until their memory is needed, so turning the camera back and forth doesn't reload them
+    uint64_t budget = this->budget.load(std::memory_order_relaxed);
+    uint64_t wantedBytes = 0;
+    std::pmr::vector<bool> wanted(ranked.size(), false, scratch.Get());
+    for (size_t i = 0; i < ranked.size(); i++) {
+        if (wantedBytes + ranked[i]->extent.size > budget) continue;
+        wantedBytes += ranked[i]->extent.size;
+        wanted[i] = true;
+    }
+
+    // After the budget shrank, worst ranked first
+    for (size_t i = ranked.size(); i-- > 0 && this->residentBytes > budget;) {
+        if (!wanted[i] && ranked[i]->state.load(std::memory_order_relaxed) == State::Resident) this->Evict(*ranked[i]);
+    }
+
+    // One load per worker at most, so frames' parallel loops still find idle threads
+    uint32_t maxLoads = std::max(JobSystem::Get().GetWorkerCount(), 1u);
+    uint64_t uploaded = 0;
+    for (size_t i = 0; i < ranked.size(); i++) {
+        Entry& entry = *ranked[i];
+        State state = entry.state.load(std::memory_order_acquire);
+        if (state == State::Unloaded && wanted[i] && loading < maxLoads) {
+            loading++;
+            entry.state.store(State::Loading, std::memory_order_relaxed);
+            JobSystem::Get().Submit([this, &entry](uint32_t) { this->Load(entry); });
+        }
+        else if (state == State::Loaded && !wanted[i]) {
+            // Fell out of range while it loaded, nothing of it is on the GPU yet
+            entry.model.reset();
+            entry.state.store(State::Unloaded, std::memory_order_relaxed);
+        }
+        else if (state == State::Loaded && uploaded < uploadBytesPerFrame) {
+            for (size_t j = ranked.size(); j-- > i + 1 && this->residentBytes + entry.extent.size > budget;) {
+                if (!wanted[j] && ranked[j]->state.load(std::memory_order_relaxed) == State::Resident) this->Evict(*ranked[j]);
+            }
+            // Estimates were off and nothing unwanted is left to evict, it waits for the camera to move
+            if (this->residentBytes + entry.extent.size > budget) continue;
+            uploaded += entry.extent.size;
+            this->MakeResident(entry, commandBuffer);
+            resident++;
+        }
+    }
+
+    this->stats.models = (uint32_t)this->entries.size();
+    this->stats.resident = resident;
+    this->stats.loading = loading;
+    this->stats.residentBytes = this->residentBytes;
+    this->stats.budgetBytes = budget;
+    this->stats.uploadedBytes = uploaded;
+}
+
+void ModelStreamer::MakeResident(Entry& entry, VkCommandBuffer commandBuffer) {
+    PROFILE_FUNCTION();
+    std::vector<std::unique_ptr<Buffer<uint8_t>>> staging;
+    entry.model->Upload(this->context, commandBuffer, staging);
+    if (!staging.empty()) {
+        this->retired.push_back({ this->context->frameNumber + this->context->framesInFlight, nullptr, std::move(staging) });
+    }
+    // The buffers hold them now, and the bounds were measured when the load finished
+    entry.model->FreeGeometryData();
+    entry.model->CollectDraws(entry.draws);
+    this->residentBytes += entry.extent.size;
+    entry.state.store(State::Resident, std::memory_order_relaxed);
+}
+
+void ModelStreamer::Evict(Entry& entry) {
+    this->residentBytes -= entry.extent.size;
+    entry.draws.clear();
+    // Frames still in flight may be drawing it
+    this->retired.push_back({ this->context->frameNumber + this->context->framesInFlight, std::move(entry.model), {} });
+    entry.state.store(State::Unloaded, std::memory_order_relaxed);
+    this->stats.evictions++;
+}
+
+void ModelStreamer::FreeRetired(bool all) {
+    std::erase_if(this->retired, [this, all](const Retired& retired) {
+        return all || retired.frame <= this->context->frameNumber;
+    });
+}
+
+void ModelStreamer::CollectDraws(FunctionRef<void(const Geometry& geometry, const glm::mat4& transform)> draw) const {
+    for (const auto& entry : this->entries) {
+        if (entry->state.load(std::memory_order_relaxed) != State::Resident) continue;
+        for (const Geometry* geometry : entry->draws) {
+            draw(*geometry, entry->transform);
+        }
+    }
+}
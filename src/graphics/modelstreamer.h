@@ -0,0 +1,108 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/functionref.h"
+#include "model.h"
+#include "glm/glm.hpp"
+#include "atomic"
+#include "mutex"
+
+struct StreamingStats {
+    uint32_t models = 0;
+    uint32_t resident = 0;
+    uint32_t loading = 0;
+    uint64_t residentBytes = 0;
+    uint64_t budgetBytes = 0;
+    // This frame's
+    uint64_t uploadedBytes = 0;
+    uint64_t evictions = 0;
+};
+
+// Keeps a world of many models, more than fit in device memory at once, resident around the camera. Every frame models
+// are ranked by priority over distance, the best ranked ones that fit the budget are loaded and decoded on the job
+// system and the worst ranked resident ones evicted to make room. Only the render thread uploads or frees anything,
+// so a frame never waits on a load
+class ModelStreamer {
+public:
+    static constexpr uint64_t defaultBudget = 1024ull * 1024 * 1024;
+    // Uploads stop for the frame once this much went up, a burst of finished loads is spread over several frames
+    static constexpr uint64_t uploadBytesPerFrame = 64ull * 1024 * 1024;
+
+    void Init(Context* context, uint64_t budget = defaultBudget);
+    // Waits for loads still running and frees every model, the device has to be idle
+    void Destroy();
+
+    // Any thread. The model is probed on a worker for its size and bounds and only considered for loading after that
+    void Add(const std::string& path, const glm::mat4& transform = glm::mat4(1.0f), float priority = 1.0f);
+    // Adds every model in {"models": [{"path": ..., "position": [x, y, z], "scale": s, "priority": p}]}, false if the
+    // file can't be read
+    bool AddWorld(const std::string& path);
+    // Any thread, models over it are evicted over the next frames
+    void SetBudget(uint64_t bytes) { this->budget.store(bytes, std::memory_order_relaxed); }
+
+    // Render thread, once per frame before drawing. Doesn't allocate unless models were added or change state. Models
+    // becoming resident record their texture copies into the frame's command buffer, so nothing waits on the GPU
+    void Update(const glm::vec3& eye, VkCommandBuffer commandBuffer);
+    // Render thread, every geometry of every resident model with its model's transform
+    void CollectDraws(FunctionRef<void(const Geometry& geometry, const glm::mat4& transform)> draw) const;
+    StreamingStats GetStats() const { return this->stats; }
+private:
+    enum class State {
+        Probing,
+        Unloaded,
+        Loading,
+        Loaded,
+        Resident,
+        Failed,
+    };
+
+    struct Extent {
+        // World space bounding sphere
+        glm::vec3 center{};
+        float radius = 0.0f;
+        // Device bytes
+        uint64_t size = 0;
+    };
+
+    struct Entry {
+        std::string path;
+        glm::mat4 transform;
+        float priority = 1.0f;
+        // Estimated from the glTF's accessors by the probe, replaced with the real thing once a load finishes. Workers
+        // write it and the model, then hand the entry back by storing its next state
+        Extent measured;
+        std::unique_ptr<Model> model;
+        std::atomic<State> state = State::Probing;
+        // Render thread only
+        Extent extent;
+        float score = 0.0f;
+        std::vector<const Geometry*> draws;
+    };
+
+    struct Retired {
+        // Frame number from which no frame in flight can still be using it
+        uint64_t frame;
+        std::unique_ptr<Model> model;
+        std::vector<std::unique_ptr<Buffer<uint8_t>>> staging;
+    };
+
+    // Worker side
+    void Probe(Entry& entry);
+    void Load(Entry& entry);
+    static Extent Measure(const glm::mat4& transform, glm::vec3 min, glm::vec3 max, uint64_t size);
+
+    void MakeResident(Entry& entry, VkCommandBuffer commandBuffer);
+    void Evict(Entry& entry);
+    void FreeRetired(bool all);
+
+    Context* context = nullptr;
+    std::atomic<uint64_t> budget = defaultBudget;
+    std::mutex addedMutex;
+    // Waiting to be picked up by the next Update
+    std::vector<std::unique_ptr<Entry>> added;
+    // Render thread only from here on
+    std::vector<std::unique_ptr<Entry>> entries;
+    std::vector<Retired> retired;
+    uint64_t residentBytes = 0;
+    StreamingStats stats;
+};
@@ -0,0 +1,109 @@
+#include "profilerwindow.h"
+
+#include "fengui.h"
+#include "core/profiler.h"
+#include "string_view"
+
+static ImU32 ZoneColor(const char* name) {
+    // Stable per name so a zone keeps its color from frame to frame
+    size_t hash = std::hash<std::string_view>{}(name);
+    return ImColor::HSV((hash % 360) / 360.0f, 0.5f, 0.8f);
+}
+
+static void DrawLane(ImDrawList* drawList, ImVec2 origin, float width, float rowHeight, uint64_t begin, uint64_t end,
+    uint32_t depth, uint64_t start, uint64_t stop, const char* name) {
+    if (stop < begin || start > end) return;
+    double scale = width / (double)(end - begin);
+    float x0 = origin.x + (float)((std::max(start, begin) - begin) * scale);
+    float x1 = origin.x + (float)((std::min(stop, end) - begin) * scale);
+    float y0 = origin.y + depth * rowHeight;
+    ImVec2 min = { x0, y0 };
+    ImVec2 max = { std::max(x1, x0 + 1.0f), y0 + rowHeight - 1.0f };
+    drawList->AddRectFilled(min, max, ZoneColor(name));
+
+    ImVec2 textSize = ImGui::CalcTextSize(name);
+    if (textSize.x < max.x - min.x - 4.0f) {
+        drawList->AddText({ min.x + 2.0f, min.y }, IM_COL32(0, 0, 0, 255), name);
+    }
+    if (ImGui::IsMouseHoveringRect(min, max)) {
+        ImGui::SetTooltip("%s: %.3f ms", name, (stop - start) / 1000000.0);
+    }
+}
+
+void DrawProfilerWindow() {
+    static int frameCount = 2;
+    static bool paused = false;
+    static std::vector<ProfileThreadSnapshot> threads;
+    static std::vector<GpuProfileEvent> gpuEvents;
+    static std::vector<uint64_t> frames;
+
+    ImGui::Begin("Profiler");
+#ifndef FENRIR_PROFILING
+    ImGui::TextUnformatted("Profiling is compiled out, configure with FENRIR_PROFILING=ON");
+    ImGui::End();
+    return;
+#endif
+    ImGui::Checkbox("Pause", &paused);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(120.0f);
+    ImGui::SliderInt("Frames", &frameCount, 1, 16);
+    ImGui::SameLine();
+    if (ImGui::Button("Export trace")) {
+        Profiler::Get().ExportChromeTrace("trace.json");
+    }
+
+    if (!paused) {
+        threads = Profiler::Get().SnapshotThreads();
+        gpuEvents = Profiler::Get().SnapshotGpu();
+        frames = Profiler::Get().SnapshotFrames();
+    }
+    if (frames.size() < 2) {
+        ImGui::TextUnformatted("Waiting for frames");
+        ImGui::End();
+        return;
+    }
+
+    // GPU results trail the CPU by the frames in flight, leave the newest frame out so both lanes are filled in
+    size_t last = frames.size() - 1;
+    size_t first = last >= (size_t)frameCount ? last - frameCount : 0;
+    uint64_t begin = frames[first];
+    uint64_t end = frames[last];
+    ImGui::Text("%.3f ms over %zu frames", (end - begin) / 1000000.0, last - first);
+
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    float rowHeight = ImGui::GetTextLineHeight() + 2.0f;
+    float labelWidth = 100.0f;
+    float width = std::max(ImGui::GetContentRegionAvail().x - labelWidth, 1.0f);
+
+    auto drawLabel = [&](const std::string& name) {
+        ImGui::TextUnformatted(name.c_str());
+        ImGui::SameLine(labelWidth);
+        return ImGui::GetCursorScreenPos();
+    };
+
+    for (const auto& thread : threads) {
+        uint32_t maxDepth = 0;
+        for (const auto& event : thread.events) {
+            if (event.end >= begin && event.start <= end) maxDepth = std::max(maxDepth, event.depth + 1);
+        }
+        if (maxDepth == 0) continue;
+
+        ImVec2 origin = drawLabel(thread.name);
+        for (const auto& event : thread.events) {
+            DrawLane(drawList, origin, width, rowHeight, begin, end, event.depth, event.start, event.end, event.name);
+        }
+        ImGui::Dummy({ width, maxDepth * rowHeight });
+    }
+
+    uint32_t maxDepth = 1;
+    for (const auto& event : gpuEvents) {
+        if (event.end >= begin && event.start <= end) maxDepth = std::max(maxDepth, event.depth + 1);
+    }
+    ImVec2 origin = drawLabel("GPU");
+    for (const auto& event : gpuEvents) {
+        DrawLane(drawList, origin, width, rowHeight, begin, end, event.depth, event.start, event.end, event.name.c_str());
+    }
+    ImGui::Dummy({ width, maxDepth * rowHeight });
+
+    ImGui::End();
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "core/core.h"
+
+// Timeline of the most recent frames, one lane per thread plus one for the GPU
+void DrawProfilerWindow();
@@ -9,6 +9,8 @@
 #include "vulkan/uniform.h"
 #include "fengui.h"
 #include "vulkan/pipeline.h"
+#include "profilerwindow.h"
+#include "statswindow.h"
 
 const std::vector<Vertex> vertices = {
     {{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
@@ -21,7 +23,7 @@ const std::vector<uint32_t> indices = {
     0, 1, 2, 2, 3, 0
 };
 
-Renderer::Renderer(Window *window) : context(window) {
+Renderer::Renderer(Window *window) : context(window), graph(&context) {
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;       // Enable Keyboard Controls
@@ -36,7 +38,8 @@ Renderer::Renderer(Window *window) : context(window) {
     imguiInfo.Device = context.device;
     imguiInfo.QueueFamily = context.queueFamilies.graphics.value();
     imguiInfo.Queue = context.graphics;
-    imguiInfo.DescriptorPool = context.descriptorPool;
+    imguiInfo.DescriptorPool = context.uiDescriptorPool;
+    imguiInfo.PipelineCache = context.pipelineCache.Get();
     imguiInfo.Subpass = 0;
     imguiInfo.MinImageCount = context.images.size();
     imguiInfo.ImageCount = context.images.size();
@@ -48,6 +51,15 @@ Renderer::Renderer(Window *window) : context(window) {
     });
     ImGui_ImplVulkan_DestroyFontUploadObjects();
 
+    this->Init(defaultModelPath);
+    this->renderThread = std::thread(&Renderer::RenderLoop, this);
+}
+
+Renderer::Renderer(uint32_t width, uint32_t height, const std::string& modelPath) : context(width, height), graph(&context) {
+    this->Init(modelPath);
+}
+
+void Renderer::Init(const std::string& modelPath) {
     this->vertexBuffer.Init(&context, vertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
     this->indexBuffer.Init(&context, indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
@@ -61,17 +73,59 @@ Renderer::Renderer(Window *window) : context(window) {
         .SetShader(&fragment)
         .SetDynamicViewport()
         .SetResolveLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-        .Build();
+        .BuildAsync(JobSystem::Get());
+
+    context.CreateWorkerCommandPools(JobSystem::Get().GetThreadCount());
+    this->instanceBuffers.resize(context.framesInFlight);
+    this->instanceCapacities.resize(context.framesInFlight, 0);
+    this->streamer.Init(&context);
+    // Headless captures load their textures whole, so they render the same every run
+    if (!context.headless) {
+        this->textureStreamer.Init(&context);
+        context.textureStreamer = &this->textureStreamer;
+    }
+    this->LoadModel(modelPath);
+}
 
-    this->model = std::make_unique<Model>(&context, "models/samples/2.0/2CylinderEngine/glTF/2CylinderEngine.gltf");
+void Renderer::LoadModel(const std::string& path) {
+    std::lock_guard<std::mutex> lock(this->renderMutex);
+    // Frames in flight may still be drawing the old buffers
+    vkDeviceWaitIdle(context.device);
+    this->sceneDraws.clear();
+    this->model.reset();
+    this->sceneGeneration++;
+
+    if (path.empty()) return;
+    this->model = std::make_unique<Model>(&context, path);
+    this->model->CollectDraws(this->sceneDraws);
 }
 
 Renderer::~Renderer() {
+    if (this->renderThread.joinable()) {
+        this->stopping.store(true, std::memory_order_release);
+        // Wakes the render thread if it's waiting for a packet
+        this->packets.Publish();
+        this->renderThread.join();
+    }
+    // Background jobs (pipeline compiles) hold on to the context
+    JobSystem::Get().WaitIdle();
     vkDeviceWaitIdle(context.device);
+    // Models hand their textures back to the texture streamer, so they go first
+    this->sceneDraws.clear();
+    this->model.reset();
+    this->streamer.Destroy();
+    if (context.textureStreamer) {
+        this->textureStreamer.Destroy();
+        context.textureStreamer = nullptr;
+    }
+    this->graph.Destroy();
     INFO("Deleting scene image");
-    this->sceneImage->Destroy();
-    delete this->sceneImage;
+    if (this->sceneImage) {
+        this->sceneImage->Destroy();
+        delete this->sceneImage;
+    }
     this->scenePipeline->Destroy();
+    if (context.headless) return;
     ImGui_ImplVulkan_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -93,175 +147,415 @@ void CreateDockspace() {
     ImGui::End();
 }
 
-void Renderer::OnTick() {
-    vkWaitForFences(context.device, 1, &context.inFlightFence, VK_TRUE, UINT64_MAX);
-    vkResetFences(context.device, 1, &context.inFlightFence);
+void Renderer::Submit(const Mesh& mesh, const Material& material, const glm::mat4& transform) {
+    float distance = glm::length(glm::vec3(transform[3]) - this->eye);
+    this->queue.Submit(mesh, material, material.GetPipeline(this->scenePipeline), transform, distance / this->farPlane);
+    if (context.textureStreamer) {
+        // The mesh's bounding sphere projected at its nearest point, which is what its texture can cover at most
+        float scale = std::max({ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) });
+        float radius = mesh.bounds.w * scale;
+        float centerDistance = glm::length(glm::vec3(transform * glm::vec4(glm::vec3(mesh.bounds), 1.0f)) - this->eye);
+        float screenSize = 2.0f * radius * this->pixelsPerUnit / std::max(centerDistance - radius, this->nearPlane);
+        this->textureStreamer.Request(material.tableIndex, screenSize);
+    }
+}
+
+void Renderer::UploadInstances() {
+    PROFILE_FUNCTION();
+    const std::vector<InstanceData>& instances = this->queue.GetInstances();
+    if (instances.empty()) return;
+
+    // The frame's fence has signalled, so its buffer is free to rewrite or replace
+    auto& buffer = this->instanceBuffers[context.currentFrame];
+    size_t& capacity = this->instanceCapacities[context.currentFrame];
+    if (instances.size() > capacity) {
+        capacity = std::max(instances.size(), capacity * 2);
+        buffer = std::make_unique<Buffer<InstanceData>>(&context, std::vector<InstanceData>(capacity), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    }
+    buffer->Update(instances);
+}
 
-    ImGui_ImplVulkan_NewFrame();
+std::pmr::vector<VkCommandBuffer> Renderer::RecordSceneDraws(VkFramebuffer framebuffer, const VkViewport& viewport, const VkRect2D& scissor) {
+    // Small chunks aren't worth a secondary buffer, large scenes get a couple of chunks per worker to even out the load
+    const uint32_t minBatchesPerChunk = 256;
+    const std::vector<DrawBatch>& batches = this->queue.GetBatches();
+    uint32_t batchCount = (uint32_t)batches.size();
+    std::pmr::vector<VkCommandBuffer> secondaries(&context.GetFrameArena());
+    if (batchCount == 0) return secondaries;
+    uint32_t chunkCount = std::clamp((batchCount + minBatchesPerChunk - 1) / minBatchesPerChunk, 1u, JobSystem::Get().GetThreadCount() * 2);
+    uint32_t chunkSize = (batchCount + chunkCount - 1) / chunkCount;
+    VkBuffer instanceBuffer = this->instanceBuffers[context.currentFrame]->buffer;
+
+    secondaries.resize(chunkCount);
+    JobSystem::Get().ParallelFor(chunkCount, [&](uint32_t chunk, uint32_t thread) {
+        PROFILE_SCOPE("Record scene chunk");
+        VkCommandBuffer buffer = context.GetSecondaryCommandBuffer(thread);
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = this->scenePipeline->renderPass;
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = framebuffer;
+        inheritanceInfo.pipelineStatistics = context.pipelineStatistics.GetInheritedFlags();
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+        VkResult beginResult = vkBeginCommandBuffer(buffer, &beginInfo);
+        if (beginResult != VK_SUCCESS) {
+            CRITICAL("Failed to begin secondary command buffer with error code: {}", beginResult);
+        }
+
+        vkCmdSetViewport(buffer, 0, 1, &viewport);
+        vkCmdSetScissor(buffer, 0, 1, &scissor);
+        VkDeviceSize instanceOffset = 0;
+        vkCmdBindVertexBuffers(buffer, 1, 1, &instanceBuffer, &instanceOffset);
+        RenderStats::Get().CountBufferBinds(1);
+
+        // Batches arrive sorted, so each of these only changes when the sort key's upper fields do
+        Pipeline* boundPipeline = nullptr;
+        bool drawable = false;
+        const Buffer<Vertex>* boundVertices = nullptr;
+        const Buffer<uint32_t>* boundIndices = nullptr;
+        uint32_t end = std::min(batchCount, (chunk + 1) * chunkSize);
+        for (uint32_t i = chunk * chunkSize; i < end; i++) {
+            const DrawBatch& batch = batches[i];
+            if (batch.pipeline != boundPipeline) {
+                // The scene pipeline compiles in the background, until then its draws are skipped and the pass only clears
+                drawable = batch.material->Use(buffer, context, batch.pipeline);
+                boundPipeline = batch.pipeline;
+            }
+            if (!drawable) continue;
+
+            const Mesh& mesh = *batch.mesh;
+            if (mesh.vertices.buffer != boundVertices) {
+                VkDeviceSize offset = 0;
+                vkCmdBindVertexBuffers(buffer, 0, 1, &mesh.vertices.buffer->buffer, &offset);
+                RenderStats::Get().CountBufferBinds(1);
+                boundVertices = mesh.vertices.buffer;
+            }
+            if (mesh.indices.buffer != boundIndices) {
+                vkCmdBindIndexBuffer(buffer, mesh.indices.buffer->buffer, 0, VK_INDEX_TYPE_UINT32);
+                RenderStats::Get().CountBufferBinds(1);
+                boundIndices = mesh.indices.buffer;
+            }
+            vkCmdDrawIndexed(buffer, (uint32_t)mesh.indices.size, batch.instanceCount, (uint32_t)mesh.indices.offset, (int32_t)mesh.vertices.offset, batch.firstInstance);
+            RenderStats::Get().CountDraw((uint32_t)mesh.indices.size, batch.instanceCount);
+        }
+
+        VkResult endResult = vkEndCommandBuffer(buffer);
+        if (endResult != VK_SUCCESS) {
+            CRITICAL("Failed to end secondary command buffer with error code: {}", endResult);
+        }
+        secondaries[chunk] = buffer;
+    });
+
+    return secondaries;
+}
+
+RenderGraphResource Renderer::AddScenePass(Image* target, VkImageLayout finalLayout) {
+    uint32_t width = target->width;
+    uint32_t height = target->height;
+    RenderGraphResource sceneColor = this->graph.CreateImage("scene.color", { width, height, context.format.format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, context.msaaSamples });
+    RenderGraphResource sceneDepth = this->graph.CreateImage("scene.depth", { width, height, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, context.msaaSamples });
+    RenderGraphResource sceneResolve = this->graph.ImportImage("scene", target);
+
+    this->graph.AddPass("scene", [&](RenderPassBuilder& pass) {
+        pass.Write(sceneColor, ResourceUsage::ColorAttachment);
+        pass.Write(sceneDepth, ResourceUsage::DepthAttachment);
+        pass.Write(sceneResolve, ResourceUsage::ResolveAttachment, finalLayout);
+    }, [this, sceneColor, sceneDepth, sceneResolve, width, height](VkCommandBuffer cmd) {
+        VkFramebuffer framebuffer = this->graph.GetFramebuffer(this->scenePipeline->renderPass, { sceneColor, sceneDepth, sceneResolve });
+
+        VkViewport viewport{};
+        viewport.width = (float)width;
+        viewport.height = (float)height;
+        viewport.x = 0;
+        viewport.y = 0;
+        viewport.maxDepth = 1.0f;
+        viewport.minDepth = 0.0f;
+
+        VkExtent2D extent = { width, height };
+
+        VkRect2D scissor{};
+        scissor.offset = { 0, 0 };
+        scissor.extent = extent;
+
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = scenePipeline->renderPass;
+        renderPassInfo.framebuffer = framebuffer;
+        renderPassInfo.renderArea.offset = { 0, 0 };
+        renderPassInfo.renderArea.extent = extent;
+        std::array<VkClearValue, 2> clearValues{};
+        clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+        clearValues[1].depthStencil = { 1.0f, 0 };
+        renderPassInfo.clearValueCount = clearValues.size();
+        renderPassInfo.pClearValues = clearValues.data();
+        vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        std::pmr::vector<VkCommandBuffer> secondaries = this->RecordSceneDraws(framebuffer, viewport, scissor);
+        if (!secondaries.empty()) {
+            vkCmdExecuteCommands(cmd, (uint32_t)secondaries.size(), secondaries.data());
+        }
+        vkCmdEndRenderPass(cmd);
+    });
+
+    return sceneResolve;
+}
+
+Camera GetOrbitCamera(float time) {
+    glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(22.5f * time), glm::vec3(0.0f, 0.0f, 1.0f));
+    Camera camera;
+    camera.eye = glm::vec3(glm::vec4(100.0f, 100.0f, 100.0f, 0.0f) * rotation);
+    camera.target = glm::vec3(0.0f, 0.0f, 400.0f);
+    camera.up = glm::vec3(0.0f, 0.0f, 1.0f);
+    camera.nearPlane = 1.0f;
+    camera.farPlane = 10000.0f;
+    return camera;
+}
+
+void Renderer::UpdateUniforms(const Camera& camera) {
+    UniformBufferObject ubo{};
+    ubo.view = glm::lookAt(camera.eye, camera.target, camera.up);
+    ubo.proj = glm::perspective(glm::radians(camera.fov), context.extent.width / (float) context.extent.height, camera.nearPlane, camera.farPlane);
+    ubo.proj[1][1] *= -1;
+    this->eye = camera.eye;
+    this->farPlane = camera.farPlane;
+    this->nearPlane = camera.nearPlane;
+    this->pixelsPerUnit = context.extent.height / (2.0f * std::tan(glm::radians(camera.fov) * 0.5f));
+
+    memcpy(context.GetFrameUniforms(), &ubo, sizeof(ubo));
+    RenderStats::Get().CountUpload(sizeof(ubo));
+}
+
+void Renderer::BuildUi(FramePacket& packet) {
+    PROFILE_FUNCTION();
+    {
+        std::lock_guard<std::mutex> lock(this->uiBackendMutex);
+        ImGui_ImplVulkan_NewFrame();
+    }
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
     
     CreateDockspace();
 
     ImGui::Begin("Viewport");
-    glm::vec2 offset = { ImGui::GetWindowContentRegionMin().x, ImGui::GetWindowContentRegionMin().y };
-    offset += glm::vec2{ ImGui::GetWindowPos().x, ImGui::GetWindowPos().y };
-    glm::vec2 size = { ImGui::GetContentRegionAvail().x, ImGui::GetContentRegionAvail().y };
+    ImVec2 size = ImGui::GetContentRegionAvail();
+    packet.viewportSize = { (uint32_t)std::max(size.x, 0.0f), (uint32_t)std::max(size.y, 0.0f) };
+    // Until the render thread has made the scene image there's nothing to show
+    VkDescriptorSet sceneTexture = this->sceneTexture.load(std::memory_order_acquire);
+    if (sceneTexture && packet.viewportSize.x != 0 && packet.viewportSize.y != 0) {
+        ImGui::Image(sceneTexture, size);
+    }
+    ImGui::End();
+
+    DrawProfilerWindow();
+    this->GetFeedback(this->uiFeedback);
+    DrawStatsWindow(this->uiFeedback);
+    ImGui::ShowMetricsWindow();
+    ImGui::ShowDemoWindow();
+
+    ImGui::Render();
+    packet.ui.CopyFrom(ImGui::GetDrawData());
+    std::lock_guard<std::mutex> lock(this->uiBackendMutex);
+    ImGui::UpdatePlatformWindows();
+    ImGui::RenderPlatformWindowsDefault();
+}
+
+void Renderer::ResizeSceneImage(glm::uvec2 size) {
     if (this->sceneImage == nullptr || this->sceneImage->width != size.x || this->sceneImage->height != size.y) {
         if (this->sceneImage != nullptr) {
+            // Other frames in flight may still be sampling the old image
+            vkDeviceWaitIdle(context.device);
+            this->graph.InvalidateFramebuffers();
             delete this->sceneImage;
+            this->sceneImage = nullptr;
         }
 
         if (size.x != 0 && size.y != 0) {
-            this->sceneImage = new Image(&context, size.x, size.y, context.format.format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+            this->sceneImage = new Image(&context, size.x, size.y, context.format.format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+            this->sceneTextureStale = true;
         }
     }
+    if (!this->sceneImage) return;
 
-    if (this->sceneImage) {
-        Image colorImage(&context, size.x, size.y, context.format.format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, context.msaaSamples);
-        Image depthImage(&context, size.x, size.y, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, context.msaaSamples);
-        std::vector<VkImageView> attachments = { colorImage.GetImageView(VK_IMAGE_ASPECT_COLOR_BIT), depthImage.GetImageView(VK_IMAGE_ASPECT_DEPTH_BIT), this->sceneImage->GetImageView(VK_IMAGE_ASPECT_COLOR_BIT) };
-
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.width = size.x;
-        framebufferInfo.height = size.y;
-        framebufferInfo.renderPass = this->scenePipeline->renderPass;
-        framebufferInfo.attachmentCount = attachments.size();
-        framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.layers = 1;
-        
-        VkFramebuffer framebuffer;
-        VkResult framebufferResult = vkCreateFramebuffer(context.device, &framebufferInfo, nullptr, &framebuffer);
-        if (framebufferResult != VK_SUCCESS) {
-            CRITICAL("Framebuffer creation failed with error code: {}", framebufferResult);
-        }
+    VkDescriptorSet sceneTexture = this->sceneTexture.load(std::memory_order_relaxed);
+    if (!sceneTexture) {
+        std::lock_guard<std::mutex> lock(this->uiBackendMutex);
+        this->sceneTexture.store(ImGui_ImplVulkan_AddTexture(sceneImage->GetSampler(), sceneImage->GetImageView(VK_IMAGE_ASPECT_COLOR_BIT), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL), std::memory_order_release);
+    }
+    else if (this->sceneTextureStale) {
+        // Only rewritten after the wait idle above, the set may be in use by frames still in flight otherwise
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = this->sceneImage->GetImageView(VK_IMAGE_ASPECT_COLOR_BIT);
+        imageInfo.sampler = this->sceneImage->GetSampler();
+
+        VkWriteDescriptorSet textureUpdate{};
+        textureUpdate.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        textureUpdate.descriptorCount = 1;
+        textureUpdate.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        textureUpdate.dstBinding = 0;
+        textureUpdate.dstSet = sceneTexture;
+        textureUpdate.pImageInfo = &imageInfo;
+
+
+        vkUpdateDescriptorSets(context.device, 1, &textureUpdate, 0, nullptr);
+    }
+    this->sceneTextureStale = false;
+}
 
-        context.StartAndSubmitCommandBuffer(context.graphics, [this, framebuffer, size](VkCommandBuffer cmd) {
-            VkViewport viewport{};
-            viewport.width = size.x;
-            viewport.height = size.y;
-            viewport.x = 0;
-            viewport.y = 0;
-            viewport.maxDepth = 1.0f;
-            viewport.minDepth = 0.0f;
-
-            VkExtent2D extent = { (uint32_t)size.x, (uint32_t)size.y };
-
-            VkRect2D scissor{};
-            scissor.offset = { 0, 0 };
-            scissor.extent = extent;
-
-            VkRenderPassBeginInfo renderPassInfo{};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass = scenePipeline->renderPass;
-            renderPassInfo.framebuffer = framebuffer;
-            renderPassInfo.renderArea.offset = { 0, 0 };
-            renderPassInfo.renderArea.extent = extent;
-            std::array<VkClearValue, 2> clearValues{};
-            clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
-            clearValues[1].depthStencil = { 1.0f, 0 };
-            renderPassInfo.clearValueCount = clearValues.size();
-            renderPassInfo.pClearValues = clearValues.data();
-            vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->scenePipeline->pipeline);
-
-            vkCmdSetViewport(cmd, 0, 1, &viewport);
-            vkCmdSetScissor(cmd, 0, 1, &scissor);
-
-            this->model->Render(cmd);
-
-            vkCmdEndRenderPass(cmd);
-        });
+void Renderer::AddEditorPasses(uint32_t imageIndex, FramePacket& packet) {
+    this->ResizeSceneImage(packet.viewportSize);
 
-        vkDestroyFramebuffer(context.device, framebuffer, nullptr);
+    RenderGraphResource sceneResolve{};
+    if (this->sceneImage) {
+        sceneResolve = this->AddScenePass(this->sceneImage, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
 
-        if (!this->sceneTexture) {
-            this->sceneTexture = ImGui_ImplVulkan_AddTexture(sceneImage->GetSampler(), sceneImage->GetImageView(VK_IMAGE_ASPECT_COLOR_BIT), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-        }
-        else {
-            VkDescriptorImageInfo imageInfo{};
-            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            imageInfo.imageView = this->sceneImage->GetImageView(VK_IMAGE_ASPECT_COLOR_BIT);
-            imageInfo.sampler = this->sceneImage->GetSampler();
-
-            VkWriteDescriptorSet textureUpdate{};
-            textureUpdate.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            textureUpdate.descriptorCount = 1;
-            textureUpdate.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            textureUpdate.dstBinding = 0;
-            textureUpdate.dstSet = this->sceneTexture;
-            textureUpdate.pImageInfo = &imageInfo;
-
-
-            vkUpdateDescriptorSets(context.device, 1, &textureUpdate, 0, nullptr);
+    ImDrawData* uiDrawData = packet.ui.Get();
+    // The backend draws through the owner viewport's buffers, a copy without one would crash inside it
+    if (uiDrawData && (!uiDrawData->OwnerViewport || !uiDrawData->OwnerViewport->RendererUserData)) {
+        CRITICAL("UI draw data was copied without its owner viewport");
+    }
+    this->graph.AddPass("ui", [&](RenderPassBuilder& pass) {
+        if (this->sceneImage) pass.Read(sceneResolve, ResourceUsage::Sampled);
+        pass.SetSideEffects();
+    }, [this, uiDrawData, imageIndex](VkCommandBuffer cmd) {
+        context.StartRenderPass(cmd, imageIndex);
+        if (uiDrawData) {
+            std::lock_guard<std::mutex> lock(this->uiBackendMutex);
+            ImGui_ImplVulkan_RenderDrawData(uiDrawData, cmd);
         }
-        ImGui::Image(this->sceneTexture, ImVec2{ size.x, size.y });
+        context.EndRenderPass(cmd);
+    });
+    this->lastTarget = this->sceneImage;
+}
+
+void Renderer::OnFixedUpdate(float timestep) {
+    this->previousSimulationTime = this->simulationTime;
+    this->simulationTime += timestep;
+}
+
+void Renderer::OnTick(float interpolation) {
+    PROFILE_FUNCTION();
+    if (!this->renderThread.joinable()) {
+        FramePacket& packet = this->packets.GetWriteBuffer();
+        this->BuildPacket(packet, interpolation);
+        this->RenderPacket(packet);
+        return;
     }
 
-    ImGui::End();
+    // At most one packet waits for the render thread, building the next one overlaps with it drawing the current one
+    this->packets.WaitUntilConsumed();
+    this->BuildPacket(this->packets.GetWriteBuffer(), interpolation);
+    this->packets.Publish();
+}
 
-    ImGui::ShowMetricsWindow();
-    ImGui::ShowDemoWindow();
+void Renderer::BuildPacket(FramePacket& packet, float interpolation) {
+    PROFILE_FUNCTION();
+    float time = glm::mix(this->previousSimulationTime, this->simulationTime, interpolation);
+    packet.camera = this->camera ? *this->camera : GetOrbitCamera(time);
+    packet.sceneGeneration = this->sceneGeneration;
 
-    ImGui::Render();
-    ImDrawData* imguiDrawData = ImGui::GetDrawData();
+    // Nothing is culled yet, every draw in the scene is visible
+    packet.draws.clear();
+    for (const Geometry* geometry : this->sceneDraws) {
+        packet.draws.push_back({ &geometry->mesh, geometry->material, glm::mat4(1.0f) });
+    }
 
-    uint32_t imageIndex;
-    VkResult acquireResult = vkAcquireNextImageKHR(context.device, context.swapchain, UINT64_MAX, context.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
-    if (acquireResult != VK_SUCCESS) {
-        CRITICAL("Image acquiring failed with error code: {}", acquireResult);
+    if (!context.headless) {
+        this->BuildUi(packet);
     }
+}
 
-    static auto startTime = std::chrono::high_resolution_clock::now();
+void Renderer::RenderLoop() {
+    PROFILE_THREAD("Render");
+    // Recording fans out over the workers, this thread helps with it rather than spinning
+    JobSystem::Get().AttachThread();
+    while (true) {
+        this->packets.WaitForPublish();
+        if (this->stopping.load(std::memory_order_acquire)) return;
+        this->packets.Acquire();
+        this->RenderPacket(this->packets.GetReadBuffer());
+    }
+}
 
-    auto currentTime = std::chrono::high_resolution_clock::now();
-    float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-    UniformBufferObject ubo{};
-    glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(22.5f * time), glm::vec3(0.0f, 0.0f, 1.0f));
-    glm::vec3 eye = glm::vec3(glm::vec4(100.0f, 100.0f, 100.0f, 0.0f) * rotation);
-    ubo.view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, 400.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    ubo.proj = glm::perspective(glm::radians(45.0f), context.extent.width / (float) context.extent.height, 1.0f, 10000.0f);
-    ubo.proj[1][1] *= -1;
+void Renderer::RenderPacket(FramePacket& packet) {
+    PROFILE_FRAME();
+    PROFILE_FUNCTION();
+    std::lock_guard<std::mutex> lock(this->renderMutex);
+    uint32_t imageIndex = context.BeginFrame();
+    Frame& frame = context.GetFrame();
+    this->UpdateUniforms(packet.camera);
+    // Started before the render queue is built, streamed models record their texture copies while becoming resident
+    context.StartCommandBuffer(frame.commandBuffer);
+    context.BeginFrameQueries(frame.commandBuffer);
+
+    {
+        PROFILE_SCOPE("Build render queue");
+        if (packet.sceneGeneration == this->sceneGeneration) {
+            for (const DrawItem& draw : packet.draws) {
+                this->Submit(*draw.mesh, *draw.material, draw.transform);
+            }
+        }
+        // Streamed models are only ever touched here, so they don't go through the packet
+        this->streamer.Update(packet.camera.eye, frame.commandBuffer);
+        this->streamer.CollectDraws([this](const Geometry& geometry, const glm::mat4& transform) {
+            this->Submit(geometry.mesh, *geometry.material, transform);
+        });
+        this->queue.Build();
+        this->UploadInstances();
+    }
 
-    void* data;
-    vkMapMemory(context.device, context.uniformBufferMemory, 0, sizeof(ubo), 0, &data);
-    memcpy(data, &ubo, sizeof(ubo));
-    vkUnmapMemory(context.device, context.uniformBufferMemory);
-
-    vkResetCommandBuffer(context.commandBuffer, 0);
-    context.StartCommandBuffer(context.commandBuffer, imageIndex);
-    ImGui_ImplVulkan_RenderDrawData(imguiDrawData, context.commandBuffer);
-    context.EndCommandBuffer(context.commandBuffer);
-
-    VkSubmitInfo submitInfo{};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &context.imageAvailableSemaphore;
-    submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &context.commandBuffer;
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &context.renderFinishedSemaphore;
-
-    VkResult submitResult = vkQueueSubmit(context.graphics, 1, &submitInfo, context.inFlightFence);
-    if (submitResult != VK_SUCCESS) {
-        CRITICAL("Failed to submit draw command buffer with error code: {}", submitResult);
+    // The scene and the UI are recorded into the frame's command buffer and go out in a single submission
+    {
+        PROFILE_SCOPE("Build render graph");
+        this->graph.Reset();
+        if (context.headless) {
+            Image* target = context.targets[imageIndex].get();
+            RenderGraphResource sceneResolve = this->AddScenePass(target, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            this->graph.Export(sceneResolve, ResourceUsage::TransferSrc);
+            this->lastTarget = target;
+        } else {
+            this->AddEditorPasses(imageIndex, packet);
+        }
+        this->graph.Compile();
     }
 
-    ImGui::UpdatePlatformWindows();
-    ImGui::RenderPlatformWindowsDefault();
+    {
+        PROFILE_SCOPE("Record frame");
+        // Mip copies go ahead of the passes that sample them
+        if (context.textureStreamer) this->textureStreamer.Update(frame.commandBuffer);
+        this->graph.Execute(frame.commandBuffer);
+        context.EndFrameQueries(frame.commandBuffer);
+        context.EndCommandBuffer(frame.commandBuffer);
+    }
 
-    VkPresentInfoKHR presentInfo{};
-    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = &context.renderFinishedSemaphore;
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = &context.swapchain;
-    presentInfo.pImageIndices = &imageIndex;
-    VkResult presentResult = vkQueuePresentKHR(context.present, &presentInfo);
-    if (presentResult != VK_SUCCESS) {
-        CRITICAL("Vulkan presentation failed with error code: {}", presentResult);
+    context.EndFrame(imageIndex);
+    this->queue.Clear();
+    RenderStats::Get().EndFrame();
+
+    std::lock_guard<std::mutex> feedbackLock(this->feedbackMutex);
+    this->feedback.stats = RenderStats::Get().GetLastFrame();
+    this->feedback.passes = context.pipelineStatistics.GetLastFrame();
+    this->feedback.pipelineStatisticsEnabled = context.pipelineStatistics.IsEnabled();
+    this->feedback.gpuFrameTime = context.gpuFrameTime;
+    this->feedback.streaming = this->streamer.GetStats();
+    this->feedback.textureStreaming = this->textureStreamer.GetStats();
+}
+
+void Renderer::GetFeedback(RenderFeedback& feedback) {
+    std::lock_guard<std::mutex> lock(this->feedbackMutex);
+    feedback = this->feedback;
+}
+
+void Renderer::Capture(const std::string& filePath) {
+    if (!this->lastTarget) {
+        WARN("Nothing has been rendered yet, skipping capture to {}", filePath);
+        return;
     }
+    vkDeviceWaitIdle(context.device);
+    this->lastTarget->Save(filePath);
 }
\ No newline at end of file
@@ -5,24 +5,109 @@
 #include "mesh.h"
 #include "material.h"
 #include "model.h"
+#include "modelstreamer.h"
+#include "texturestreamer.h"
 #include "vulkan/image.h"
+#include "vulkan/rendergraph.h"
+#include "core/jobsystem.h"
+#include "camera.h"
+#include "renderqueue.h"
+#include "framepacket.h"
+#include "core/triplebuffer.h"
+#include "thread"
+#include "mutex"
 
+inline const std::string defaultModelPath = "models/samples/2.0/2CylinderEngine/glTF/2CylinderEngine.gltf";
+
+// With a window the main thread only turns the scene and UI into frame packets, a render thread records and submits
+// them so a slow GPU frame doesn't hold up input or simulation. Headless renderers do both on the calling thread
 class Renderer : public Layer {
 public:
     Renderer(Window* window);
+    // Renders the scene offscreen without a window or UI
+    Renderer(uint32_t width, uint32_t height, const std::string& modelPath = defaultModelPath);
     ~Renderer();
 
-    void Submit(const Mesh& mesh, const Material& material);
+    // Queues a draw for the current frame, identical mesh and material pairs end up in one instanced draw
+    void Submit(const Mesh& mesh, const Material& material, const glm::mat4& transform = glm::mat4(1.0f));
+
+    // Advances the default orbit
+    virtual void OnFixedUpdate(float timestep) override;
+    // Builds this frame's packet, headless renderers then render it straight away
+    virtual void OnTick(float interpolation) override;
+    // Writes the last rendered frame out as a PNG
+    void Capture(const std::string& filePath);
+    // Replaces the scene, an empty path just unloads it. Holds the render thread off while it does
+    void LoadModel(const std::string& path);
+    // Overrides the default orbit until cleared
+    void SetCamera(const Camera& camera) { this->camera = camera; }
+    void ClearCamera() { this->camera.reset(); }
+    // Pipelines compile in the background, runs that need every frame to be complete wait for them first
+    void WaitForPipelines() { JobSystem::Get().WaitIdle(); }
+
+    // Copies the render thread's latest statistics into feedback, reusing its storage. Safe from the main thread
+    void GetFeedback(RenderFeedback& feedback);
 
-    virtual void OnTick() override;
+    Context& GetContext() { return this->context; }
+    Model* GetModel() { return this->model.get(); }
+    // Models added here are drawn alongside the scene model while they're resident
+    ModelStreamer& GetStreamer() { return this->streamer; }
+    // Only windowed renderers stream textures
+    TextureStreamer& GetTextureStreamer() { return this->textureStreamer; }
 private:
+    void Init(const std::string& modelPath);
+    void BuildPacket(FramePacket& packet, float interpolation);
+    void BuildUi(FramePacket& packet);
+    void RenderLoop();
+    void RenderPacket(FramePacket& packet);
+    void UpdateUniforms(const Camera& camera);
+    void ResizeSceneImage(glm::uvec2 size);
+    void AddEditorPasses(uint32_t imageIndex, FramePacket& packet);
+    RenderGraphResource AddScenePass(Image* target, VkImageLayout finalLayout);
+    void UploadInstances();
+    std::pmr::vector<VkCommandBuffer> RecordSceneDraws(VkFramebuffer framebuffer, const VkViewport& viewport, const VkRect2D& scissor);
+
     Context context;
+    RenderGraph graph;
     Buffer<Vertex> vertexBuffer;
     Buffer<uint32_t> indexBuffer;
 
     Pipeline* scenePipeline{};
     Image* sceneImage = nullptr;
-    VkDescriptorSet sceneTexture{};
+    // Created and rewritten by the render thread, the main thread only hands the handle to ImGui
+    std::atomic<VkDescriptorSet> sceneTexture{};
+    bool sceneTextureStale = false;
+    Image* lastTarget = nullptr;
+    std::optional<Camera> camera;
+    float simulationTime = 0.0f;
+    float previousSimulationTime = 0.0f;
+
+    TripleBuffer<FramePacket> packets;
+    std::thread renderThread;
+    std::atomic<bool> stopping = false;
+    // Held by the render thread for a whole frame, anything replacing what packets point at takes it first
+    std::mutex renderMutex;
+    // The ImGui Vulkan backend keeps global state (descriptor pool, per viewport buffers) and isn't thread safe. The
+    // main thread calls it while building the UI and the render thread while drawing it, every call takes this first
+    std::mutex uiBackendMutex;
+    uint64_t sceneGeneration = 0;
+    std::mutex feedbackMutex;
+    RenderFeedback feedback;
+    // The main thread's copy for the UI
+    RenderFeedback uiFeedback;
 
     std::unique_ptr<Model> model;
+    std::vector<const Geometry*> sceneDraws;
+    ModelStreamer streamer;
+    TextureStreamer textureStreamer;
+    RenderQueue queue;
+    // One per frame in flight, grown when a frame has more instances than fit
+    std::vector<std::unique_ptr<Buffer<InstanceData>>> instanceBuffers;
+    std::vector<size_t> instanceCapacities;
+    // Where the last uniforms put the camera, for the queue's depth ordering
+    glm::vec3 eye{};
+    float farPlane = 10000.0f;
+    float nearPlane = 1.0f;
+    // Screen pixels across one unit at a distance of one, for the texture streamer's screen sizes
+    float pixelsPerUnit = 1.0f;
 };
\ No newline at end of file
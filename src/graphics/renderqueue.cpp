@@ -0,0 +1,72 @@
+#include "renderqueue.h"
+#include "core/profiler.h"
+
+uint64_t RenderQueue::MakeKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth) {
+    uint64_t quantizedDepth = (uint64_t)(std::clamp(depth, 0.0f, 1.0f) * 0xFFFF);
+    return ((uint64_t)(pipeline & 0xFFF) << 52) |
+        ((uint64_t)(material & 0xFFFF) << 36) |
+        ((uint64_t)(mesh & 0xFFFFF) << 16) |
+        quantizedDepth;
+}
+
+void RenderQueue::Submit(const Mesh& mesh, const Material& material, Pipeline* pipeline, const glm::mat4& transform, float depth) {
+    uint64_t key = MakeKey(this->pipelineIds.Get(pipeline), this->materialIds.Get(&material), this->meshIds.Get(&mesh), depth);
+    this->items.push_back({ &mesh, &material, pipeline, transform });
+    this->keys.push_back(key);
+}
+
+void RenderQueue::Build() {
+    PROFILE_FUNCTION();
+    this->RadixSort();
+
+    this->batches.clear();
+    this->instances.clear();
+    this->instances.reserve(this->items.size());
+    for (uint32_t index : this->order) {
+        const RenderItem& item = this->items[index];
+        if (!this->batches.empty()) {
+            DrawBatch& last = this->batches.back();
+            if (last.pipeline == item.pipeline && last.material == item.material && last.mesh == item.mesh) {
+                last.instanceCount++;
+                this->instances.push_back({ item.transform, item.material->tableIndex });
+                continue;
+            }
+        }
+        this->batches.push_back({ item.pipeline, item.material, item.mesh, (uint32_t)this->instances.size(), 1 });
+        this->instances.push_back({ item.transform, item.material->tableIndex });
+    }
+}
+
+void RenderQueue::Clear() {
+    this->items.clear();
+    this->keys.clear();
+    this->pipelineIds.ids.clear();
+    this->materialIds.ids.clear();
+    this->meshIds.ids.clear();
+}
+
+void RenderQueue::RadixSort() {
+    // Least significant byte first, a stable counting sort per byte. Passes where every key has the same byte are
+    // skipped, with few pipelines and materials that's most of the upper ones
+    uint32_t count = (uint32_t)this->items.size();
+    this->order.resize(count);
+    this->scratch.resize(count);
+    for (uint32_t i = 0; i < count; i++) this->order[i] = i;
+
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        std::array<uint32_t, 256> histogram{};
+        for (uint64_t key : this->keys) histogram[(key >> shift) & 0xFF]++;
+        if (count == 0 || histogram[(this->keys[0] >> shift) & 0xFF] == count) continue;
+
+        uint32_t offset = 0;
+        for (uint32_t& bucket : histogram) {
+            uint32_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (uint32_t index : this->order) {
+            this->scratch[histogram[(this->keys[index] >> shift) & 0xFF]++] = index;
+        }
+        std::swap(this->order, this->scratch);
+    }
+}
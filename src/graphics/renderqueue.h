@@ -0,0 +1,67 @@
+#pragma once
+
+#include "core/core.h"
+#include "glm/glm.hpp"
+#include "mesh.h"
+#include "material.h"
+#include "vulkan/vertex.h"
+#include "memory_resource"
+
+struct Pipeline;
+
+struct RenderItem {
+    const Mesh* mesh;
+    const Material* material;
+    Pipeline* pipeline;
+    glm::mat4 transform;
+};
+
+// Consecutive items with the same pipeline, material and mesh, drawn with one instanced call
+struct DrawBatch {
+    Pipeline* pipeline;
+    const Material* material;
+    const Mesh* mesh;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+};
+
+// Collects a frame's draws and orders them so state changes are as rare as possible: by pipeline, then material,
+// then mesh, front to back within a mesh. Runs that only differ in transform become a single instanced draw
+class RenderQueue {
+public:
+    // Depth is the distance to the camera over the far plane, anything outside 0-1 is clamped
+    void Submit(const Mesh& mesh, const Material& material, Pipeline* pipeline, const glm::mat4& transform, float depth);
+    // Sorts the items and fills the batches and their instance records, in draw order
+    void Build();
+    void Clear();
+
+    size_t Size() const { return this->items.size(); }
+    const std::vector<DrawBatch>& GetBatches() const { return this->batches; }
+    const std::vector<InstanceData>& GetInstances() const { return this->instances; }
+
+    // Pipeline in the top 12 bits, then 16 bits of material, 20 of mesh and 16 of depth. Ids wrapping around only
+    // costs batching, batches are split on the actual pointers
+    static uint64_t MakeKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+private:
+    // Handed out per frame in submission order, so they stay small enough for the key's fields. Cleared nodes go back
+    // to the pool and the buckets are kept, so after the first frames handing out ids doesn't allocate
+    struct DenseIds {
+        std::pmr::unsynchronized_pool_resource pool;
+        std::pmr::unordered_map<const void*, uint32_t> ids{ &this->pool };
+
+        uint32_t Get(const void* object) { return this->ids.emplace(object, (uint32_t)this->ids.size()).first->second; }
+    };
+
+    void RadixSort();
+
+    std::vector<RenderItem> items;
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> scratch;
+    DenseIds pipelineIds;
+    DenseIds materialIds;
+    DenseIds meshIds;
+
+    std::vector<DrawBatch> batches;
+    std::vector<InstanceData> instances;
+};
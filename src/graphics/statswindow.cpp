@@ -0,0 +1,67 @@
+#include "statswindow.h"
+
+#include "fengui.h"
+#include "core/memory.h"
+
+void DrawStatsWindow(const RenderFeedback& feedback) {
+    ImGui::Begin("Statistics");
+
+    const FrameStats& frame = feedback.stats;
+    ImGui::Text("CPU frame time: %.2f ms", ImGui::GetIO().DeltaTime * 1000.0f);
+    ImGui::Text("GPU frame time: %.2f ms", feedback.gpuFrameTime);
+    ImGui::Separator();
+    ImGui::Text("Draws: %llu", (unsigned long long)frame.draws);
+    ImGui::Text("Triangles: %llu", (unsigned long long)frame.triangles);
+    ImGui::Text("Pipeline binds: %llu", (unsigned long long)frame.pipelineBinds);
+    ImGui::Text("Buffer binds: %llu", (unsigned long long)frame.bufferBinds);
+    ImGui::Text("Descriptor set binds: %llu", (unsigned long long)frame.descriptorBinds);
+    ImGui::Text("Descriptor writes: %llu", (unsigned long long)frame.descriptorWrites);
+    ImGui::Text("Uploaded: %.1f KiB", frame.uploadedBytes / 1024.0);
+    if (IsHeapTrackingEnabled()) ImGui::Text("Heap allocations (process): %llu", (unsigned long long)frame.heapAllocations);
+    ImGui::Separator();
+
+    const StreamingStats& streaming = feedback.streaming;
+    if (streaming.models > 0) {
+        ImGui::Text("Streamed models: %u resident, %u loading of %u", streaming.resident, streaming.loading, streaming.models);
+        ImGui::Text("Streaming memory: %.1f / %.1f MiB", streaming.residentBytes / (1024.0 * 1024.0), streaming.budgetBytes / (1024.0 * 1024.0));
+        ImGui::Text("Streamed in: %.1f MiB, evictions: %llu", streaming.uploadedBytes / (1024.0 * 1024.0), (unsigned long long)streaming.evictions);
+        ImGui::Separator();
+    }
+
+    const TextureStreamingStats& textures = feedback.textureStreaming;
+    if (textures.textures > 0) {
+        ImGui::Text("Streamed textures: %u, %u reading", textures.textures, textures.reading);
+        ImGui::Text("Texture memory: %.1f / %.1f MiB", textures.residentBytes / (1024.0 * 1024.0), textures.budgetBytes / (1024.0 * 1024.0));
+        ImGui::Text("Mips streamed in: %.1f MiB, evictions: %llu", textures.uploadedBytes / (1024.0 * 1024.0), (unsigned long long)textures.evictions);
+        ImGui::Separator();
+    }
+
+    if (!feedback.pipelineStatisticsEnabled) {
+        ImGui::TextUnformatted("Pipeline statistics queries aren't supported on this device");
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::BeginTable("Passes", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Pass");
+        ImGui::TableSetupColumn("Vertices");
+        ImGui::TableSetupColumn("Primitives");
+        ImGui::TableSetupColumn("VS invocations");
+        ImGui::TableSetupColumn("Clipped in");
+        ImGui::TableSetupColumn("Clipped out");
+        ImGui::TableSetupColumn("FS invocations");
+        ImGui::TableHeadersRow();
+        for (const auto& pass : feedback.passes) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(pass.name.c_str());
+            for (uint64_t value : { pass.inputVertices, pass.inputPrimitives, pass.vertexInvocations, pass.clippingInvocations, pass.clippingPrimitives, pass.fragmentInvocations }) {
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", (unsigned long long)value);
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::End();
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "core/core.h"
+#include "framepacket.h"
+
+// Last frame's CPU side counters and the per pass pipeline statistics
+void DrawStatsWindow(const RenderFeedback& feedback);
@@ -0,0 +1,471 @@
+#include "texturestreamer.h"
+
+#include "cmath"
+
+#include "vulkan/context.h"
+#include "vulkan/image.h"
+#include "vulkan/buffer.h"
+#include "core/jobsystem.h"
+#include "core/arena.h"
+#include "core/profiler.h"
+#include "core/vfs.h"
+
+static constexpr VkImageUsageFlags streamedUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+// Moves some of an image's mips between layouts without touching the rest, which frames may be sampling meanwhile
+static void TransitionMips(VkCommandBuffer commandBuffer, Image& image, uint32_t first, uint32_t count, VkImageLayout from, VkImageLayout to) {
+    VkPipelineStageFlags sourceStage, destinationStage;
+    VkAccessFlags sourceAccess, destinationAccess;
+    Image::GetLayoutUsage(from, sourceStage, sourceAccess);
+    Image::GetLayoutUsage(to, destinationStage, destinationAccess);
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = from;
+    barrier.newLayout = to;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image.image;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, first, count, 0, 1 };
+    barrier.srcAccessMask = sourceAccess;
+    barrier.dstAccessMask = destinationAccess;
+    vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+static uint32_t GetMipExtent(uint32_t size, uint32_t level) {
+    return std::max(1u, size >> level);
+}
+
+void TextureStreamer::Init(Context* context, uint64_t budget) {
+    this->context = context;
+    this->SetBudget(budget);
+    this->materialTextures.assign(BindlessTable::maxMaterials, noTexture);
+
+    // Cooked textures are mostly block compressed, devices that can't sample that get the source images instead
+    VkFormatProperties bc1, bc3;
+    vkGetPhysicalDeviceFormatProperties(context->physical, this->GetFormat(CookedTextureFormat::Bc1), &bc1);
+    vkGetPhysicalDeviceFormatProperties(context->physical, this->GetFormat(CookedTextureFormat::Bc3), &bc3);
+    this->compressedSupported = (bc1.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) && (bc3.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+}
+
+void TextureStreamer::Destroy() {
+    // Reads still running write into the textures
+    JobSystem::Get().WaitIdle();
+    this->textures.clear();
+    this->freeTextures.clear();
+    this->paths.clear();
+    this->released.clear();
+    this->materialTextures.clear();
+    this->FreeRetired(true);
+    this->residentBytes = 0;
+    this->context = nullptr;
+}
+
+uint32_t TextureStreamer::Add(const std::string& path, uint32_t material) {
+    uint32_t index;
+    auto found = this->paths.find(path);
+    if (found != this->paths.end()) {
+        index = found->second;
+    }
+    else {
+        if (!this->freeTextures.empty()) {
+            index = this->freeTextures.back();
+            this->freeTextures.pop_back();
+        }
+        else {
+            index = (uint32_t)this->textures.size();
+            this->textures.emplace_back();
+        }
+        this->textures[index] = std::make_unique<Texture>();
+        this->textures[index]->path = path;
+        this->paths.emplace(path, index);
+        this->StartRead(*this->textures[index], noTexture, 0);
+    }
+
+    Texture& texture = *this->textures[index];
+    texture.materials.push_back(material);
+    this->materialTextures[material] = index;
+    // A pending slot reaches it along with the texture's other materials
+    if (texture.tableIndex != BindlessTable::defaultTexture) this->context->bindless.SetMaterialTexture(material, texture.tableIndex);
+    return index;
+}
+
+void TextureStreamer::Remove(uint32_t texture, uint32_t material) {
+    // Models outliving the streamer have nothing left to remove
+    if (!this->context) return;
+    std::erase(this->textures[texture]->materials, material);
+    this->materialTextures[material] = noTexture;
+    if (this->textures[texture]->materials.empty()) this->Release(texture);
+}
+
+void TextureStreamer::Release(uint32_t index) {
+    Texture& texture = *this->textures[index];
+    auto found = this->paths.find(texture.path);
+    if (found != this->paths.end() && found->second == index) this->paths.erase(found);
+    if (texture.read.load(std::memory_order_acquire) == ReadState::Reading) {
+        this->released.push_back(index);
+        return;
+    }
+
+    uint64_t frame = this->context->frameNumber + this->context->framesInFlight;
+    if (texture.image) {
+        this->residentBytes -= this->GetSize(texture, texture.imageBase);
+        this->retired.push_back({ frame, std::move(texture.image), nullptr });
+    }
+    if (texture.previousImage) this->retired.push_back({ frame, std::move(texture.previousImage), nullptr });
+    this->context->bindless.RemoveTexture(texture.tableIndex);
+    this->context->bindless.RemoveTexture(texture.pendingIndex);
+    this->textures[index] = std::make_unique<Texture>();
+    this->freeTextures.push_back(index);
+}
+
+void TextureStreamer::Request(uint32_t material, float screenSize) {
+    if (material >= this->materialTextures.size() || this->materialTextures[material] == noTexture) return;
+    Texture& texture = *this->textures[this->materialTextures[material]];
+    texture.screenSize = std::max(texture.screenSize, screenSize);
+}
+
+void TextureStreamer::StartRead(Texture& texture, uint32_t first, uint32_t last) {
+    texture.readFirst = first;
+    texture.readLast = last;
+    texture.read.store(ReadState::Reading, std::memory_order_relaxed);
+    JobSystem::Get().Submit([this, &texture](uint32_t) { this->Read(texture); });
+}
+
+void TextureStreamer::Read(Texture& texture) {
+    PROFILE_FUNCTION();
+    bool first = texture.readFirst == noTexture;
+    try {
+        texture.data.clear();
+        texture.mips.clear();
+        // The first read decides where every later one reads from
+        if (first) {
+            std::string cookedPath = GetCookedTexturePath(texture.path);
+            if (!cookedPath.empty() && FileSystem::Get().Exists(cookedPath)) texture.cookedPath = cookedPath;
+        }
+        if (!texture.cookedPath.empty()) this->ReadCooked(texture);
+        else this->ReadSource(texture);
+        texture.read.store(ReadState::Ready, std::memory_order_release);
+    }
+    catch (const std::exception& exception) {
+        // Update retries later ones, the tail is in by then
+        if (first) WARN("Not streaming {}, reading it failed: {}", texture.path, exception.what());
+        else WARN("Reading more of {} failed: {}", texture.path, exception.what());
+        texture.read.store(ReadState::Failed, std::memory_order_release);
+    }
+}
+
+// Only the wanted mips are read, which out of a pack decodes just the blocks they're in
+void TextureStreamer::ReadCooked(Texture& texture) {
+    CookedTextureHeader header;
+    if (!FileSystem::Get().Read(texture.cookedPath, 0, sizeof(header), (char*)&header) || header.magic != cookedTextureMagic ||
+        header.version != cookedFormatVersion || header.mipCount == 0 || header.mipCount > 32) {
+        CRITICAL("{} isn't a texture this build can read", texture.cookedPath);
+    }
+    if (texture.readFirst == noTexture && header.format != CookedTextureFormat::Rgba8 && !this->compressedSupported) {
+        texture.cookedPath.clear();
+        this->ReadSource(texture);
+        return;
+    }
+
+    std::array<CookedMip, 32> mips;
+    if (!FileSystem::Get().Read(texture.cookedPath, sizeof(header), header.mipCount * sizeof(CookedMip), (char*)mips.data())) {
+        CRITICAL("{} is cut short", texture.cookedPath);
+    }
+    if (texture.readFirst == noTexture) {
+        texture.format = header.format;
+        texture.width = header.width;
+        texture.height = header.height;
+        texture.mipCount = header.mipCount;
+        texture.tailMip = 0;
+        while (texture.tailMip + 1 < texture.mipCount && std::max(GetMipExtent(texture.width, texture.tailMip), GetMipExtent(texture.height, texture.tailMip)) > tailSize) texture.tailMip++;
+        texture.readFirst = texture.tailMip;
+        texture.readLast = texture.mipCount;
+    }
+
+    // Checked before anything is copied to the GPU, which would read past the staging buffer otherwise
+    if (header.format != texture.format || header.width != texture.width || header.height != texture.height || header.mipCount != texture.mipCount) {
+        CRITICAL("{} changed while it was streamed", texture.cookedPath);
+    }
+    for (uint32_t level = texture.readFirst; level < texture.readLast; level++) {
+        const CookedMip& mip = mips[level];
+        if (mip.width != GetMipExtent(header.width, level) || mip.height != GetMipExtent(header.height, level) || mip.offset % 16 != 0 ||
+            mip.size != GetCookedMipSize(header.format, mip.width, mip.height) || (level > texture.readFirst && mip.offset < mips[level - 1].offset + mips[level - 1].size)) {
+            CRITICAL("{} has a damaged mip table", texture.cookedPath);
+        }
+    }
+
+    // Mips are stored largest first and 16 byte aligned, so a run of them is read in one go and copied from as is
+    uint64_t start = mips[texture.readFirst].offset;
+    const CookedMip& last = mips[texture.readLast - 1];
+    texture.data.resize(last.offset + last.size - start);
+    if (!FileSystem::Get().Read(texture.cookedPath, start, texture.data.size(), (char*)texture.data.data())) {
+        CRITICAL("{} is cut short", texture.cookedPath);
+    }
+    for (uint32_t level = texture.readFirst; level < texture.readLast; level++) {
+        texture.mips.push_back({ level, mips[level].width, mips[level].height, mips[level].offset - start });
+    }
+}
+
+// Every mip is filtered from the one above it, so any of them costs decoding the whole image. The first read builds the
+// full chain and the texture is all tail from then on, never evicted and never read again
+void TextureStreamer::ReadSource(Texture& texture) {
+    Image::Pixels level = Image::DecodeImage(texture.path);
+    texture.format = CookedTextureFormat::Rgba8;
+    texture.width = level.width;
+    texture.height = level.height;
+    texture.mipCount = (uint32_t)std::floor(std::log2(std::max(level.width, level.height))) + 1;
+    texture.tailMip = 0;
+    texture.readFirst = 0;
+    texture.readLast = texture.mipCount;
+
+    for (uint32_t i = 0; i < texture.mipCount; i++) {
+        if (i > 0) level = Image::Downsample(level);
+        texture.mips.push_back({ i, level.width, level.height, texture.data.size() });
+        texture.data.insert(texture.data.end(), level.data.begin(), level.data.end());
+    }
+}
+
+// Copies in whatever a finished read brought that the image still has room for and isn't resident yet
+uint64_t TextureStreamer::Upload(VkCommandBuffer commandBuffer, Texture& texture) {
+    PROFILE_FUNCTION();
+    texture.read.store(ReadState::Idle, std::memory_order_relaxed);
+    bool first = !texture.image;
+    if (first) {
+        // Starts out as just the tail
+        texture.image = std::make_unique<Image>(this->context, GetMipExtent(texture.width, texture.tailMip), GetMipExtent(texture.height, texture.tailMip), this->GetFormat(texture.format), streamedUsage, VK_SAMPLE_COUNT_1_BIT, texture.mipCount - texture.tailMip);
+        texture.imageBase = texture.tailMip;
+        texture.residentMip = texture.mipCount;
+        texture.wantedMip = texture.tailMip;
+        texture.targetMip = texture.tailMip;
+        this->residentBytes += this->GetSize(texture, texture.imageBase);
+    }
+
+    std::array<VkBufferImageCopy, 32> regions{};
+    uint32_t regionCount = 0;
+    uint32_t finest = texture.residentMip;
+    for (const MipData& mip : texture.mips) {
+        // Evicted again while it was read, or already there
+        if (mip.level < texture.imageBase || mip.level >= texture.residentMip) continue;
+        VkBufferImageCopy& region = regions[regionCount++];
+        region.bufferOffset = mip.offset;
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip.level - texture.imageBase, 0, 1 };
+        region.imageExtent = { mip.width, mip.height, 1 };
+        finest = std::min(finest, mip.level);
+    }
+    if (regionCount == 0) return 0;
+
+    uint64_t size = texture.data.size();
+    std::unique_ptr<Buffer<uint8_t>> staging = std::make_unique<Buffer<uint8_t>>(this->context, texture.data, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    if (first) {
+        texture.image->TransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    }
+    else {
+        // Clamped off by minLod so nothing samples them, but they're in the layout the rest of the image is in
+        TransitionMips(commandBuffer, *texture.image, finest - texture.imageBase, texture.residentMip - finest, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    }
+    vkCmdCopyBufferToImage(commandBuffer, staging->buffer, texture.image->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regionCount, regions.data());
+    if (first) {
+        texture.image->TransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+    else {
+        TransitionMips(commandBuffer, *texture.image, finest - texture.imageBase, texture.residentMip - finest, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    this->retired.push_back({ this->context->frameNumber + this->context->framesInFlight, nullptr, std::move(staging) });
+    texture.data.clear();
+    texture.data.shrink_to_fit();
+    texture.mips.clear();
+    texture.residentMip = finest;
+    this->Publish(texture);
+    return size;
+}
+
+// Reallocates the image with base as its finest mip, keeping the resident mips it still has room for
+void TextureStreamer::Resize(VkCommandBuffer commandBuffer, Texture& texture, uint32_t base) {
+    PROFILE_FUNCTION();
+    std::unique_ptr<Image> image = std::make_unique<Image>(this->context, GetMipExtent(texture.width, base), GetMipExtent(texture.height, base), this->GetFormat(texture.format), streamedUsage, VK_SAMPLE_COUNT_1_BIT, texture.mipCount - base);
+    uint32_t firstCopied = std::max(texture.residentMip, base);
+
+    std::array<VkImageCopy, 32> copies{};
+    uint32_t copyCount = 0;
+    for (uint32_t level = firstCopied; level < texture.mipCount; level++) {
+        VkImageCopy& copy = copies[copyCount++];
+        copy.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - texture.imageBase, 0, 1 };
+        copy.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - base, 0, 1 };
+        copy.extent = { GetMipExtent(texture.width, level), GetMipExtent(texture.height, level), 1 };
+    }
+
+    // Waits for earlier frames to finish sampling the old image, they're ahead of this one in the queue. It goes back to
+    // being sampled afterwards, this frame's draws still use it
+    texture.image->TransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    image->TransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    vkCmdCopyImage(commandBuffer, texture.image->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copyCount, copies.data());
+    texture.image->TransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    // The mips that weren't copied stay undefined until a read fills them in, minLod keeps them from being sampled
+    image->TransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    this->residentBytes = this->residentBytes - this->GetSize(texture, texture.imageBase) + this->GetSize(texture, base);
+    // Resized again before the switch, nothing but this frame's copy reads the one in between
+    if (texture.previousImage) this->retired.push_back({ this->context->frameNumber + this->context->framesInFlight, std::move(texture.image), nullptr });
+    else texture.previousImage = std::move(texture.image);
+    texture.image = std::move(image);
+    texture.imageBase = base;
+    texture.residentMip = firstCopied;
+    this->Publish(texture);
+}
+
+// Gives the texture's current image and resident mips a new table slot. Slots aren't rewritten in place and materials
+// only switch to it once every frame recorded before this one is done, as those could otherwise sample the new slot
+// ahead of the copies this frame makes
+void TextureStreamer::Publish(Texture& texture) {
+    BindlessTable& bindless = this->context->bindless;
+    float minLod = (float)(texture.residentMip - texture.imageBase);
+    VkSampler sampler = texture.image->GetSampler(VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_SAMPLER_ADDRESS_MODE_REPEAT, minLod);
+    // Superseded before any material pointed at it
+    bindless.RemoveTexture(texture.pendingIndex);
+    texture.pendingIndex = bindless.AddTexture(texture.image->GetImageView(VK_IMAGE_ASPECT_COLOR_BIT), sampler);
+    texture.pendingFrame = this->context->frameNumber + this->context->framesInFlight - 1;
+}
+
+void TextureStreamer::Switch(Texture& texture) {
+    BindlessTable& bindless = this->context->bindless;
+    for (uint32_t material : texture.materials) bindless.SetMaterialTexture(material, texture.pendingIndex);
+    // Frames in flight still sample the old slot
+    bindless.RemoveTexture(texture.tableIndex);
+    if (texture.previousImage) this->retired.push_back({ this->context->frameNumber + this->context->framesInFlight, std::move(texture.previousImage), nullptr });
+    texture.tableIndex = texture.pendingIndex;
+    texture.pendingIndex = BindlessTable::defaultTexture;
+}
+
+void TextureStreamer::Update(VkCommandBuffer commandBuffer) {
+    PROFILE_FUNCTION();
+    this->FreeRetired(false);
+    for (size_t i = 0; i < this->released.size();) {
+        uint32_t index = this->released[i];
+        if (this->textures[index]->read.load(std::memory_order_acquire) == ReadState::Reading) {
+            i++;
+            continue;
+        }
+        this->released[i] = this->released.back();
+        this->released.pop_back();
+        this->Release(index);
+    }
+
+    uint64_t frame = this->context->frameNumber;
+    uint64_t budget = this->budget.load(std::memory_order_relaxed);
+    uint64_t uploaded = 0;
+    uint32_t reading = 0;
+    ScratchScope scratch;
+    std::pmr::vector<Texture*> ranked(scratch.Get());
+    ranked.reserve(this->textures.size());
+    for (auto& entry : this->textures) {
+        Texture& texture = *entry;
+        float screenSize = texture.screenSize;
+        texture.screenSize = 0.0f;
+        if (texture.materials.empty()) continue;
+
+        if (texture.pendingIndex != BindlessTable::defaultTexture && texture.pendingFrame <= frame) this->Switch(texture);
+        ReadState state = texture.read.load(std::memory_order_acquire);
+        if (state == ReadState::Reading) reading++;
+        if (state == ReadState::Failed && texture.image) {
+            // Keeps the mips it has and tries again later, or settles for its tail
+            texture.data.clear();
+            texture.mips.clear();
+            texture.failedReads++;
+            texture.retryFrame = frame + retryFrames * texture.failedReads;
+            if (texture.failedReads == maxFailedReads) WARN("Keeping {} at its smallest mips, reading more of it failed {} times", texture.path, maxFailedReads);
+            texture.read.store(ReadState::Idle, std::memory_order_relaxed);
+        }
+        if (state == ReadState::Ready && uploaded < uploadBytesPerFrame) uploaded += this->Upload(commandBuffer, texture);
+        // Nothing's known about it until the first read is in
+        if (!texture.image) continue;
+
+        if (screenSize > 0.0f) {
+            texture.lastSeen = frame;
+            texture.priority = screenSize;
+            // The finest mip with at least as many texels across as pixels it covers, assuming the texture is
+            // stretched over the draw once
+            float level = std::floor(std::log2(std::max(texture.width, texture.height) / std::max(screenSize, 1.0f)));
+            texture.wantedMip = (uint32_t)std::clamp(level, 0.0f, (float)texture.tailMip);
+        }
+        else if (frame - texture.lastSeen > unseenFrames) {
+            texture.wantedMip = texture.tailMip;
+        }
+        if (texture.failedReads >= maxFailedReads) texture.wantedMip = texture.tailMip;
+        ranked.push_back(&texture);
+    }
+
+    // Textures drawn lately first, the largest on screen first among them
+    std::sort(ranked.begin(), ranked.end(), [frame](const Texture* a, const Texture* b) {
+        bool aSeen = frame - a->lastSeen <= unseenFrames;
+        bool bSeen = frame - b->lastSeen <= unseenFrames;
+        if (aSeen != bSeen) return aSeen;
+        return a->priority > b->priority;
+    });
+
+    // Every tail stays, what the budget has left goes to finer mips in ranked order
+    uint64_t committed = 0;
+    for (Texture* texture : ranked) committed += this->GetSize(*texture, texture->tailMip);
+    for (Texture* texture : ranked) {
+        uint32_t target = texture->wantedMip;
+        uint64_t tail = this->GetSize(*texture, texture->tailMip);
+        while (target < texture->tailMip && committed + this->GetSize(*texture, target) - tail > budget) target++;
+        committed += this->GetSize(*texture, target) - tail;
+        texture->targetMip = target;
+    }
+
+    // Shrinking first, worst ranked first, makes room for what grows below
+    for (size_t i = ranked.size(); i-- > 0;) {
+        Texture& texture = *ranked[i];
+        if (texture.targetMip <= texture.imageBase || texture.read.load(std::memory_order_relaxed) == ReadState::Reading) continue;
+        this->Resize(commandBuffer, texture, texture.targetMip);
+        this->stats.evictions++;
+    }
+
+    // One read per worker at most, so frames' parallel loops still find idle threads
+    uint32_t maxReads = std::max(JobSystem::Get().GetWorkerCount(), 1u);
+    for (Texture* entry : ranked) {
+        Texture& texture = *entry;
+        if (reading >= maxReads) break;
+        if (texture.read.load(std::memory_order_relaxed) != ReadState::Idle || frame < texture.retryFrame) continue;
+        if (texture.targetMip < texture.imageBase) {
+            uint64_t growth = this->GetSize(texture, texture.targetMip) - this->GetSize(texture, texture.imageBase);
+            // Memory freed by shrinking others goes back only once their frames are done, so it waits a frame or two
+            if (this->residentBytes + growth > budget) continue;
+            this->Resize(commandBuffer, texture, texture.targetMip);
+        }
+        if (texture.residentMip > texture.imageBase) {
+            this->StartRead(texture, texture.imageBase, texture.residentMip);
+            reading++;
+        }
+    }
+
+    this->stats.textures = (uint32_t)(this->textures.size() - this->freeTextures.size());
+    this->stats.reading = reading;
+    this->stats.residentBytes = this->residentBytes;
+    this->stats.budgetBytes = budget;
+    this->stats.uploadedBytes = uploaded;
+}
+
+uint64_t TextureStreamer::GetSize(const Texture& texture, uint32_t base) const {
+    uint64_t size = 0;
+    for (uint32_t level = base; level < texture.mipCount; level++) {
+        size += GetCookedMipSize(texture.format, GetMipExtent(texture.width, level), GetMipExtent(texture.height, level));
+    }
+    return size;
+}
+
+VkFormat TextureStreamer::GetFormat(CookedTextureFormat format) const {
+    switch (format) {
+    case CookedTextureFormat::Bc1: return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    case CookedTextureFormat::Bc3: return VK_FORMAT_BC3_UNORM_BLOCK;
+    default: return VK_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+void TextureStreamer::FreeRetired(bool all) {
+    std::erase_if(this->retired, [this, all](const Retired& retired) {
+        return all || retired.frame <= this->context->frameNumber;
+    });
+}
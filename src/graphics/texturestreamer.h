@@ -0,0 +1,149 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+#include "vulkan/bindless.h"
+#include "vulkan/image.h"
+#include "cooked.h"
+#include "atomic"
+
+struct TextureStreamingStats {
+    uint32_t textures = 0;
+    uint32_t reading = 0;
+    uint64_t residentBytes = 0;
+    uint64_t budgetBytes = 0;
+    // This frame's
+    uint64_t uploadedBytes = 0;
+    uint64_t evictions = 0;
+};
+
+// Textures start out as their smallest mips and stream the rest in as draws need them. Every draw reports how many
+// pixels its material's texture covers, which picks the finest mip worth having and orders the reads. Mips are read
+// on the job system, only the ones wanted out of the cooked .ftex fenrir_cook made. Source images without one are
+// decoded once and loaded whole, they don't stream. A texture's image holds its mips from the finest wanted one down
+// and the sampler's minLod keeps the GPU off those still on their way. Over the budget, the fine mips of textures that
+// haven't been drawn lately go first
+class TextureStreamer {
+public:
+    static constexpr uint32_t noTexture = UINT32_MAX;
+    static constexpr uint64_t defaultBudget = 512ull * 1024 * 1024;
+    // Uploads stop for the frame once this much went up, the rest go out with the next frames
+    static constexpr uint64_t uploadBytesPerFrame = 32ull * 1024 * 1024;
+    // Mips this size and smaller are read first and never evicted, so a texture is usable soon after it's added
+    static constexpr uint32_t tailSize = 64;
+    // Textures not drawn for this many frames are the first to lose their fine mips
+    static constexpr uint64_t unseenFrames = 120;
+    // A failed read of finer mips is tried again this many frames times the failures so far later. After the last
+    // one the texture keeps just its tail
+    static constexpr uint64_t retryFrames = 60;
+    static constexpr uint32_t maxFailedReads = 3;
+
+    void Init(Context* context, uint64_t budget = defaultBudget);
+    // Waits for reads still running and frees every image, the device has to be idle
+    void Destroy();
+
+    // Render thread. Streams the image at path into the bindless material's base colour texture, materials sharing an
+    // image share its mips. The material samples the default texture until the first mips are in
+    uint32_t Add(const std::string& path, uint32_t material);
+    void Remove(uint32_t texture, uint32_t material);
+    // Any thread, textures over it lose their fine mips over the next frames
+    void SetBudget(uint64_t bytes) { this->budget.store(bytes, std::memory_order_relaxed); }
+
+    // Render thread, for every draw this frame: how many pixels across the material's texture is drawn
+    void Request(uint32_t material, float screenSize);
+    // Render thread, once the frame's draws are submitted and before they're recorded. Mips that arrived are copied in
+    // through the frame's command buffer, so nothing waits on the GPU
+    void Update(VkCommandBuffer commandBuffer);
+    TextureStreamingStats GetStats() const { return this->stats; }
+private:
+    enum class ReadState {
+        Idle,
+        Reading,
+        Ready,
+        Failed,
+    };
+
+    struct MipData {
+        uint32_t level;
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset;
+    };
+
+    struct Texture {
+        std::string path;
+        std::vector<uint32_t> materials;
+        // Filled in by the first read, nothing else looks at them before it's done
+        std::string cookedPath;
+        CookedTextureFormat format = CookedTextureFormat::Rgba8;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t mipCount = 0;
+        uint32_t tailMip = 0;
+
+        // The image holds mips [imageBase, mipCount), the ones from residentMip down are uploaded
+        std::unique_ptr<Image> image;
+        uint32_t imageBase = 0;
+        uint32_t residentMip = 0;
+        // The slot the materials sample, and the one they switch to once frames older than its mips' copy are done
+        uint32_t tableIndex = BindlessTable::defaultTexture;
+        uint32_t pendingIndex = BindlessTable::defaultTexture;
+        uint64_t pendingFrame = 0;
+        // What tableIndex views when a resize replaced it, kept until the switch
+        std::unique_ptr<Image> previousImage;
+        // Largest on screen this frame so far, and when it was last drawn at what size
+        float screenSize = 0.0f;
+        uint64_t lastSeen = 0;
+        float priority = 0.0f;
+        // What draws asked for, and what the budget leaves of it
+        uint32_t wantedMip = 0;
+        uint32_t targetMip = 0;
+        // Reads of finer mips that failed, and the frame the next one may start
+        uint32_t failedReads = 0;
+        uint64_t retryFrame = 0;
+
+        // A read owns everything below until it stores Ready or Failed
+        std::atomic<ReadState> read = ReadState::Idle;
+        // Mips [readFirst, readLast), noTexture as readFirst for the first read, which reads the tail
+        uint32_t readFirst = 0;
+        uint32_t readLast = 0;
+        std::vector<uint8_t> data;
+        std::vector<MipData> mips;
+    };
+
+    struct Retired {
+        // Frame number from which no frame in flight can still be using it
+        uint64_t frame;
+        std::unique_ptr<Image> image;
+        std::unique_ptr<Buffer<uint8_t>> staging;
+    };
+
+    // Worker side
+    void Read(Texture& texture);
+    void ReadCooked(Texture& texture);
+    void ReadSource(Texture& texture);
+
+    void StartRead(Texture& texture, uint32_t first, uint32_t last);
+    uint64_t Upload(VkCommandBuffer commandBuffer, Texture& texture);
+    void Resize(VkCommandBuffer commandBuffer, Texture& texture, uint32_t base);
+    void Publish(Texture& texture);
+    void Switch(Texture& texture);
+    void Release(uint32_t index);
+    uint64_t GetSize(const Texture& texture, uint32_t base) const;
+    VkFormat GetFormat(CookedTextureFormat format) const;
+    void FreeRetired(bool all);
+
+    Context* context = nullptr;
+    std::atomic<uint64_t> budget = defaultBudget;
+    bool compressedSupported = false;
+    std::vector<std::unique_ptr<Texture>> textures;
+    std::vector<uint32_t> freeTextures;
+    std::unordered_map<std::string, uint32_t> paths;
+    // Per bindless material, the texture streamed into it
+    std::vector<uint32_t> materialTextures;
+    // Released while a read was still running, freed once it's done
+    std::vector<uint32_t> released;
+    std::vector<Retired> retired;
+    uint64_t residentBytes = 0;
+    TextureStreamingStats stats;
+};
@@ -0,0 +1,202 @@
+#include "bindless.h"
+
+#include "context.h"
+#include "image.h"
+#include "buffer.h"
+#include "atomic"
+
+uint32_t BindlessTable::Slots::Allocate(uint32_t capacity, const char* kind) {
+    if (!this->free.empty()) {
+        uint32_t index = this->free.back();
+        this->free.pop_back();
+        return index;
+    }
+    if (this->next == capacity) {
+        CRITICAL("Bindless {} table is full ({} entries)", kind, capacity);
+    }
+    return this->next++;
+}
+
+void BindlessTable::Init(Context* context) {
+    this->context = context;
+    this->maxTextures = context->maxBindlessTextures;
+
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[materialBinding].binding = materialBinding;
+    bindings[materialBinding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[materialBinding].descriptorCount = 1;
+    bindings[materialBinding].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+    bindings[textureBinding].binding = textureBinding;
+    bindings[textureBinding].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[textureBinding].descriptorCount = this->maxTextures;
+    bindings[textureBinding].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+
+    // Textures come and go while earlier frames still have the set bound, unused slots are simply never read
+    std::array<VkDescriptorBindingFlagsEXT, 2> bindingFlags = {
+        0,
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT_EXT
+    };
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    bindingFlagsInfo.bindingCount = bindingFlags.size();
+    bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    layoutInfo.bindingCount = bindings.size();
+    layoutInfo.pBindings = bindings.data();
+
+    VkResult layoutResult = vkCreateDescriptorSetLayout(context->device, &layoutInfo, nullptr, &this->layout);
+    if (layoutResult != VK_SUCCESS) {
+        CRITICAL("Bindless descriptor set layout creation failed with error code: {}", layoutResult);
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes = { {
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, this->maxTextures }
+    } };
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = poolSizes.size();
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    VkResult poolResult = vkCreateDescriptorPool(context->device, &poolInfo, nullptr, &this->pool);
+    if (poolResult != VK_SUCCESS) {
+        CRITICAL("Bindless descriptor pool creation failed with error code: {}", poolResult);
+    }
+
+    VkDescriptorSetVariableDescriptorCountAllocateInfoEXT countInfo{};
+    countInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO_EXT;
+    countInfo.descriptorSetCount = 1;
+    countInfo.pDescriptorCounts = &this->maxTextures;
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.pNext = &countInfo;
+    allocInfo.descriptorPool = this->pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &this->layout;
+
+    VkResult allocResult = vkAllocateDescriptorSets(context->device, &allocInfo, &this->set);
+    if (allocResult != VK_SUCCESS) {
+        CRITICAL("Bindless descriptor set allocation failed with error code: {}", allocResult);
+    }
+
+    // The material table stays mapped, it's small and written rarely enough that host visible memory is fine
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = sizeof(GpuMaterial) * maxMaterials;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+    VmaAllocationCreateInfo bufferAllocInfo{};
+    bufferAllocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+    bufferAllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    VmaAllocationInfo mappedInfo{};
+    VkResult bufferResult = vmaCreateBuffer(context->allocator, &bufferInfo, &bufferAllocInfo, &this->materialBuffer, &this->materialAllocation, &mappedInfo);
+    if (bufferResult != VK_SUCCESS) {
+        CRITICAL("Material table allocation failed with error code: {}", bufferResult);
+    }
+    this->materials = (GpuMaterial*)mappedInfo.pMappedData;
+
+    VkDescriptorBufferInfo materialInfo{ this->materialBuffer, 0, VK_WHOLE_SIZE };
+    VkWriteDescriptorSet materialWrite{};
+    materialWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    materialWrite.dstSet = this->set;
+    materialWrite.dstBinding = materialBinding;
+    materialWrite.descriptorCount = 1;
+    materialWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    materialWrite.pBufferInfo = &materialInfo;
+    vkUpdateDescriptorSets(context->device, 1, &materialWrite, 0, nullptr);
+
+    this->whiteTexture = new Image(context, 1, 1, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+    Buffer<uint8_t> stagingBuffer(context, { 255, 255, 255, 255 }, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    context->StartAndSubmitCommandBuffer(context->graphics, [this, &stagingBuffer](VkCommandBuffer commandBuffer) {
+        this->whiteTexture->TransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        this->whiteTexture->CopyFrom(commandBuffer, stagingBuffer);
+        this->whiteTexture->TransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    });
+    this->AddTexture(this->whiteTexture->GetImageView(VK_IMAGE_ASPECT_COLOR_BIT), this->whiteTexture->GetSampler());
+
+    INFO("Bindless table ready with room for {} textures and {} materials", this->maxTextures, maxMaterials);
+}
+
+void BindlessTable::Destroy() {
+    delete this->whiteTexture;
+    vmaDestroyBuffer(this->context->allocator, this->materialBuffer, this->materialAllocation);
+    vkDestroyDescriptorPool(this->context->device, this->pool, nullptr);
+    vkDestroyDescriptorSetLayout(this->context->device, this->layout, nullptr);
+}
+
+uint32_t BindlessTable::AddTexture(VkImageView view, VkSampler sampler) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    uint32_t index = this->textures.Allocate(this->maxTextures, "texture");
+
+    VkDescriptorImageInfo imageInfo{ sampler, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    VkWriteDescriptorSet textureWrite{};
+    textureWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    textureWrite.dstSet = this->set;
+    textureWrite.dstBinding = textureBinding;
+    textureWrite.dstArrayElement = index;
+    textureWrite.descriptorCount = 1;
+    textureWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    textureWrite.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(this->context->device, 1, &textureWrite, 0, nullptr);
+    RenderStats::Get().CountDescriptorWrites(1);
+
+    return index;
+}
+
+void BindlessTable::RemoveTexture(uint32_t index) {
+    if (index == defaultTexture) return;
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->textures.retired.push_back({ index, this->context->frameNumber });
+}
+
+uint32_t BindlessTable::AddMaterial(const GpuMaterial& material) {
+    uint32_t index;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        index = this->materialSlots.Allocate(maxMaterials, "material");
+    }
+    this->UpdateMaterial(index, material);
+    return index;
+}
+
+void BindlessTable::UpdateMaterial(uint32_t index, const GpuMaterial& material) {
+    this->materials[index] = material;
+    vmaFlushAllocation(this->context->allocator, this->materialAllocation, index * sizeof(GpuMaterial), sizeof(GpuMaterial));
+    RenderStats::Get().CountUpload(sizeof(GpuMaterial));
+}
+
+void BindlessTable::SetMaterialTexture(uint32_t index, uint32_t texture) {
+    // A single aligned word, so the GPU never sees half of it
+    std::atomic_ref<uint32_t>(this->materials[index].baseColorTexture).store(texture, std::memory_order_relaxed);
+    vmaFlushAllocation(this->context->allocator, this->materialAllocation, index * sizeof(GpuMaterial), sizeof(GpuMaterial));
+    RenderStats::Get().CountUpload(sizeof(uint32_t));
+}
+
+void BindlessTable::RemoveMaterial(uint32_t index) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->materialSlots.retired.push_back({ index, this->context->frameNumber });
+}
+
+void BindlessTable::Collect(uint64_t frameNumber) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (Slots* slots : { &this->textures, &this->materialSlots }) {
+        auto done = std::partition(slots->retired.begin(), slots->retired.end(), [&](const auto& retired) {
+            return retired.second + this->context->framesInFlight > frameNumber;
+        });
+        for (auto it = done; it != slots->retired.end(); it++) slots->free.push_back(it->first);
+        slots->retired.erase(done, slots->retired.end());
+    }
+}
+
+void BindlessTable::Bind(VkCommandBuffer buffer, VkPipelineLayout layout, uint32_t set) const {
+    vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, set, 1, &this->set, 0, nullptr);
+    RenderStats::Get().CountDescriptorBinds(1);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+#include "vma.h"
+#include "glm/glm.hpp"
+#include "mutex"
+
+struct Context;
+class Image;
+
+// Mirrors Material in shader.frag, std430 so the array stride is 32 bytes
+struct GpuMaterial {
+    glm::vec4 baseColorFactor = glm::vec4(1.0f);
+    uint32_t baseColorTexture = 0;
+    uint32_t padding[3]{};
+};
+
+// One descriptor set holding every texture and the material table, bound once per pipeline instead of per draw.
+// Shaders index textures through the material, whose index comes in with each instance, so draws with different
+// materials share a pipeline bind and can be batched. Needs VK_EXT_descriptor_indexing, which the context requires
+class BindlessTable {
+public:
+    static constexpr uint32_t materialBinding = 0;
+    static constexpr uint32_t textureBinding = 1;
+    static constexpr uint32_t maxMaterials = 4096;
+    // Texture index 0 is always a white texel, so untextured materials sample through it unchanged
+    static constexpr uint32_t defaultTexture = 0;
+
+    void Init(Context* context);
+    void Destroy();
+
+    // Indices are freed framesInFlight frames after removal, the GPU may still be reading them until then
+    uint32_t AddTexture(VkImageView view, VkSampler sampler);
+    void RemoveTexture(uint32_t index);
+    uint32_t AddMaterial(const GpuMaterial& material);
+    // Written straight into the mapped table, so only for materials no frame in flight draws with
+    void UpdateMaterial(uint32_t index, const GpuMaterial& material);
+    // Swaps a material's texture while frames in flight may be drawing with it. They read the old index or the new one,
+    // and the old one stays valid until they're done as long as it's removed rather than reused
+    void SetMaterialTexture(uint32_t index, uint32_t texture);
+    void RemoveMaterial(uint32_t index);
+    // Releases removed indices whose frames have finished, called once the frame's fence has signalled
+    void Collect(uint64_t frameNumber);
+
+    void Bind(VkCommandBuffer buffer, VkPipelineLayout layout, uint32_t set) const;
+
+    VkDescriptorSetLayout GetLayout() const { return this->layout; }
+    uint32_t GetTextureCapacity() const { return this->maxTextures; }
+private:
+    struct Slots {
+        uint32_t next = 0;
+        std::vector<uint32_t> free;
+        std::vector<std::pair<uint32_t, uint64_t>> retired;
+
+        uint32_t Allocate(uint32_t capacity, const char* kind);
+    };
+
+    Context* context{};
+    uint32_t maxTextures = 0;
+    VkDescriptorSetLayout layout{};
+    VkDescriptorPool pool{};
+    VkDescriptorSet set{};
+
+    VkBuffer materialBuffer{};
+    VmaAllocation materialAllocation{};
+    GpuMaterial* materials = nullptr;
+
+    Image* whiteTexture = nullptr;
+    std::mutex mutex;
+    Slots textures;
+    Slots materialSlots;
+};
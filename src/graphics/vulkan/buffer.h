@@ -8,11 +8,11 @@
 template <class T> class Buffer {
 public:
     Buffer<T>() = default;
-    Buffer<T>(Context* context, std::vector<T> data, VkBufferUsageFlags usage) {
+    Buffer<T>(Context* context, const std::vector<T>& data, VkBufferUsageFlags usage) {
         this->Init(context, data, usage);
     }
 
-    void Init(Context* context, std::vector<T> data, VkBufferUsageFlags usage) {
+    void Init(Context* context, const std::vector<T>& data, VkBufferUsageFlags usage) {
         this->context = context;
 
         VkBufferCreateInfo bufferInfo{};
@@ -32,6 +32,7 @@ public:
         vmaMapMemory(context->allocator, this->allocation, &mapping);
         memcpy(mapping, data.data(), data.size() * sizeof(T));
         vmaUnmapMemory(context->allocator, this->allocation);
+        RenderStats::Get().CountUpload(data.size() * sizeof(T));
     }
 
     ~Buffer<T>() {
@@ -46,22 +47,27 @@ public:
         vkCmdCopyBuffer(commandBuffer, this->buffer, dest.buffer, 1, &copy);
     }
 
-    void Update(std::vector<T> data) {
+    void Update(const std::vector<T>& data) {
         void* mapping;
         vmaMapMemory(context->allocator, this->allocation, &mapping);
         memcpy(mapping, data.data(), data.size() * sizeof(T));
         vmaUnmapMemory(context->allocator, this->allocation);
+        RenderStats::Get().CountUpload(data.size() * sizeof(T));
     }
 
     void Destroy() {
-        vmaDestroyBuffer(context->allocator, this->buffer, this->allocation);
+        // Never initialised, e.g. the buffers of a model loaded on the CPU only
+        if (this->context) {
+            context->descriptorCache.ForgetBuffer(this->buffer);
+            vmaDestroyBuffer(context->allocator, this->buffer, this->allocation);
+        }
         this->isDestroyed = true;
     }
 
     struct Ref {
-        Buffer<T> *buffer;
-        uint64_t offset;
-        uint64_t size;
+        Buffer<T> *buffer = nullptr;
+        uint64_t offset = 0;
+        uint64_t size = 0;
     };
 
     Ref GetRef(uint64_t offset, uint64_t size) {
@@ -76,7 +82,7 @@ public:
     VmaAllocation allocation{};
     uint32_t size{};
 
-    Context* context;
+    Context* context = nullptr;
 private:
     bool isDestroyed = false;
 };
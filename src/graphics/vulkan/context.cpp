@@ -9,41 +9,70 @@
 
 const std::vector<const char*> instanceExtensions = {};
 const std::vector<const char*> validationLayers = {"VK_LAYER_KHRONOS_validation"};
-const std::vector<const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+const std::vector<const char*> swapchainDeviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+const std::vector<const char*> descriptorIndexingDeviceExtensions = {VK_KHR_MAINTENANCE3_EXTENSION_NAME, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME};
+// Bindless tables don't need more than this, and some drivers report limits in the millions
+const uint32_t bindlessTextureLimit = 16384;
+
+static bool HasExtension(const std::vector<VkExtensionProperties>& available, const char* extension) {
+    for (const auto& properties : available) {
+        if (strcmp(properties.extensionName, extension) == 0) return true;
+    }
+    return false;
+}
 
-Context::Context(Window* window) : window(window) {
+Context::Context(Window* window, uint32_t framesInFlight) : window(window), framesInFlight(framesInFlight) {
     INFO("Initializing Vulkan");
 
     this->CreateDevice();
     this->CreateSwapchain();
     this->CreatePipeline();
     this->CreateUniformBuffer();
+    this->CreateDescriptorPools();
+    this->CreateFrames();
+    this->gpuProfiler.Init(this);
+    this->pipelineStatistics.Init(this);
+    this->bindless.Init(this);
+}
 
-    VkSemaphoreCreateInfo semaphoreInfo{};
-    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    if (vkCreateSemaphore(this->device, &semaphoreInfo, nullptr, &this->imageAvailableSemaphore) != VK_SUCCESS ||
-        vkCreateSemaphore(this->device, &semaphoreInfo, nullptr, &this->renderFinishedSemaphore) != VK_SUCCESS ||
-        vkCreateFence(this->device, &fenceInfo, nullptr, &this->inFlightFence) != VK_SUCCESS){
+Context::Context(uint32_t width, uint32_t height, uint32_t framesInFlight) : window(nullptr), headless(true), framesInFlight(framesInFlight) {
+    INFO("Initializing headless Vulkan");
+    this->extent = { width, height };
 
-        CRITICAL("failed to create synchronization objects");
-    }
+    this->CreateDevice();
+    this->CreateSwapchain();
+    this->CreatePipeline();
+    this->CreateUniformBuffer();
+    this->CreateDescriptorPools();
+    this->CreateFrames();
+    this->gpuProfiler.Init(this);
+    this->pipelineStatistics.Init(this);
+    this->bindless.Init(this);
 }
 
 Context::~Context() {
     vkDeviceWaitIdle(this->device);
 
-    vkDestroyDescriptorPool(this->device, this->descriptorPool, nullptr);
-    for (auto& descriptorSetLayout : this->descriptorSetLayouts) {
-        vkDestroyDescriptorSetLayout(this->device, descriptorSetLayout, nullptr);
-    }
+    vkDestroyDescriptorPool(this->device, this->uiDescriptorPool, nullptr);
+    this->descriptorCache.Destroy();
+    vkUnmapMemory(this->device, this->uniformBufferMemory);
     vkDestroyBuffer(this->device, this->uniformBuffer, nullptr);
     vkFreeMemory(this->device, this->uniformBufferMemory, nullptr);
-    vkDestroySemaphore(this->device, this->imageAvailableSemaphore, nullptr);
-    vkDestroySemaphore(this->device, this->renderFinishedSemaphore, nullptr);
-    vkDestroyFence(this->device, this->inFlightFence, nullptr);
+    this->gpuProfiler.Destroy();
+    this->pipelineStatistics.Destroy();
+    this->bindless.Destroy();
+    for (auto& frame : this->frames) {
+        vkDestroySemaphore(this->device, frame.imageAvailableSemaphore, nullptr);
+        vkDestroyFence(this->device, frame.inFlightFence, nullptr);
+        if (frame.timestampPool) vkDestroyQueryPool(this->device, frame.timestampPool, nullptr);
+        vkDestroyCommandPool(this->device, frame.commandPool, nullptr);
+        for (auto& worker : frame.workers) {
+            vkDestroyCommandPool(this->device, worker.commandPool, nullptr);
+        }
+    }
+    for (auto& semaphore : this->renderFinishedSemaphores) {
+        vkDestroySemaphore(this->device, semaphore, nullptr);
+    }
     vkDestroyCommandPool(this->device, this->commandPool, nullptr);
     for (auto& framebuffer : this->framebuffers) {
         vkDestroyFramebuffer(this->device, framebuffer, nullptr);
@@ -51,13 +80,20 @@ Context::~Context() {
     this->colorImage->Destroy();
     this->depthImage->Destroy();
     this->pipeline->Destroy();
-    for (auto& imageView : this->imageViews) {
-        vkDestroyImageView(this->device, imageView, nullptr);
+    if (this->headless) {
+        this->targets.clear(); // The targets own their views
+    } else {
+        for (auto& imageView : this->imageViews) {
+            vkDestroyImageView(this->device, imageView, nullptr);
+        }
+        vkDestroySwapchainKHR(this->device, this->swapchain, nullptr);
     }
-    vkDestroySwapchainKHR(this->device, this->swapchain, nullptr);
+    this->samplerCache.Destroy();
+    this->layoutCache.Destroy();
+    this->pipelineCache.Destroy();
     vmaDestroyAllocator(this->allocator);
     vkDestroyDevice(this->device, nullptr);
-    vkDestroySurfaceKHR(this->instance, this->surface, nullptr);
+    if (!this->headless) vkDestroySurfaceKHR(this->instance, this->surface, nullptr);
     vkDestroyInstance(this->instance, nullptr);
 }
 
@@ -80,12 +116,18 @@ void Context::CreateDevice() {
     std::vector<VkLayerProperties> availableLayers(numAvailableLayers);
     vkEnumerateInstanceLayerProperties(&numAvailableLayers, availableLayers.data());
 
+    // Without a window there's nothing to present to, so no surface extensions are needed
     std::vector<const char*> extensions = instanceExtensions;
-    uint32_t numGlfwExtensions;
-    const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&numGlfwExtensions);
-    for (uint32_t i = 0; i < numGlfwExtensions; i++) {
-        extensions.push_back(glfwExtensions[i]);
-    } 
+    // Needed to query the descriptor indexing features on a 1.0 instance
+    bool properties2Supported = HasExtension(availableInstanceExtensions, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    if (properties2Supported) extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    if (!this->headless) {
+        uint32_t numGlfwExtensions;
+        const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&numGlfwExtensions);
+        for (uint32_t i = 0; i < numGlfwExtensions; i++) {
+            extensions.push_back(glfwExtensions[i]);
+        }
+    }
 
     for (const auto& extension : extensions) {
         bool found = false;
@@ -130,11 +172,14 @@ void Context::CreateDevice() {
     INFO("Vulkan instance created");
 
     // Create surface
-    VkResult surfaceResult = glfwCreateWindowSurface(this->instance, this->window->GetRawWindow(), nullptr, &this->surface);
-    if (surfaceResult != VK_SUCCESS) {
-        CRITICAL("Surface creation failed with error code: {}", surfaceResult);
+    if (!this->headless) {
+        VkResult surfaceResult = glfwCreateWindowSurface(this->instance, this->window->GetRawWindow(), nullptr, &this->surface);
+        if (surfaceResult != VK_SUCCESS) {
+            CRITICAL("Surface creation failed with error code: {}", surfaceResult);
+        }
+        INFO("Vulkan surface created");
     }
-    INFO("Vulkan surface created");   
+    std::vector<const char*> deviceExtensions = this->headless ? std::vector<const char*>{} : swapchainDeviceExtensions;
 
     // Find physical device
     uint32_t numDevices;
@@ -147,6 +192,12 @@ void Context::CreateDevice() {
     this->queueFamilies = FindQueueFamilies(this);
     this->msaaSamples = GetMaxUsableSampleCount(this->physicalProperties);
 
+    uint32_t numQueueFamilies;
+    vkGetPhysicalDeviceQueueFamilyProperties(this->physical, &numQueueFamilies, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(numQueueFamilies);
+    vkGetPhysicalDeviceQueueFamilyProperties(this->physical, &numQueueFamilies, queueFamilyProperties.data());
+    this->timestampsSupported = queueFamilyProperties[this->queueFamilies.graphics.value()].timestampValidBits != 0;
+
     // Create device
     float queuePriority = 1.0f;
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
@@ -160,11 +211,77 @@ void Context::CreateDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
     
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(this->physical, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+    deviceFeatures.inheritedQueries = supportedFeatures.inheritedQueries;
+    this->enabledFeatures = deviceFeatures;
+
+    // Every pipeline samples its textures through the bindless table, which needs descriptor indexing
+    uint32_t numAvailableDeviceExtensions;
+    vkEnumerateDeviceExtensionProperties(this->physical, nullptr, &numAvailableDeviceExtensions, nullptr);
+    std::vector<VkExtensionProperties> availableDeviceExtensions(numAvailableDeviceExtensions);
+    vkEnumerateDeviceExtensionProperties(this->physical, nullptr, &numAvailableDeviceExtensions, availableDeviceExtensions.data());
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    bool indexingSupported = false;
+    bool indexingExtensionsPresent = properties2Supported && std::all_of(descriptorIndexingDeviceExtensions.begin(), descriptorIndexingDeviceExtensions.end(), [&](const char* extension) {
+        return HasExtension(availableDeviceExtensions, extension);
+    });
+    if (indexingExtensionsPresent) {
+        auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(this->instance, "vkGetPhysicalDeviceFeatures2KHR");
+        auto getProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(this->instance, "vkGetPhysicalDeviceProperties2KHR");
+
+        VkPhysicalDeviceFeatures2KHR features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+        features2.pNext = &indexingFeatures;
+        getFeatures2(this->physical, &features2);
+
+        VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties{};
+        indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+        VkPhysicalDeviceProperties2KHR properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+        properties2.pNext = &indexingProperties;
+        getProperties2(this->physical, &properties2);
+
+        indexingSupported = indexingFeatures.runtimeDescriptorArray &&
+            indexingFeatures.descriptorBindingPartiallyBound &&
+            indexingFeatures.descriptorBindingVariableDescriptorCount &&
+            indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+            indexingFeatures.shaderSampledImageArrayNonUniformIndexing;
+        // The array is combined image samplers, so the sampler limits apply as well as the image ones, and the fragment
+        // stage also sees the material buffer
+        this->maxBindlessTextures = std::min({
+            bindlessTextureLimit,
+            indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+            indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+            indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+            indexingProperties.maxPerStageUpdateAfterBindResources - 1
+        });
+    }
+
+    if (!indexingSupported) {
+        CRITICAL("{} doesn't support VK_EXT_descriptor_indexing, which bindless textures and materials need", this->physicalProperties.deviceName);
+    }
+
+    // Only what the bindless table uses is turned on
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT enabledIndexingFeatures{};
+    enabledIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    enabledIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+    enabledIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+    enabledIndexingFeatures.descriptorBindingVariableDescriptorCount = VK_TRUE;
+    enabledIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    enabledIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    deviceExtensions.insert(deviceExtensions.end(), descriptorIndexingDeviceExtensions.begin(), descriptorIndexingDeviceExtensions.end());
 
     VkDeviceCreateInfo deviceInfo{};
     deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.pNext = &enabledIndexingFeatures;
     deviceInfo.pQueueCreateInfos = queueCreateInfos.data();
     deviceInfo.queueCreateInfoCount = queueCreateInfos.size();
     deviceInfo.pEnabledFeatures = &deviceFeatures;
@@ -181,6 +298,9 @@ void Context::CreateDevice() {
 
     vkGetDeviceQueue(this->device, this->queueFamilies.graphics.value(), 0, &this->graphics);
     vkGetDeviceQueue(this->device, this->queueFamilies.present.value(), 0, &this->present);
+    this->samplerCache.Init(this->device);
+    this->layoutCache.Init(this->device);
+    this->pipelineCache.Init(this->device, this->physicalProperties, "pipeline_cache.bin");
 
     VmaVulkanFunctions vulkanFunctions = {};
     vulkanFunctions.vkGetInstanceProcAddr = &vkGetInstanceProcAddr;
@@ -197,6 +317,18 @@ void Context::CreateDevice() {
 }   
 
 void Context::CreateSwapchain() {
+    if (this->headless) {
+        // Offscreen images stand in for the swapchain, one per frame in flight so a target is never shared between frames
+        this->format = { VK_FORMAT_R8G8B8A8_SRGB, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+        for (uint32_t i = 0; i < this->framesInFlight; i++) {
+            this->targets.push_back(std::make_unique<Image>(this, this->extent.width, this->extent.height, this->format.format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT));
+            this->images.push_back(this->targets.back()->image);
+            this->imageViews.push_back(this->targets.back()->GetImageView(VK_IMAGE_ASPECT_COLOR_BIT));
+        }
+        INFO("Created {} offscreen targets of {}x{}", this->targets.size(), this->extent.width, this->extent.height);
+        return;
+    }
+
     SwapchainDetails details = GetSwapchainDetails(this);
 
     bool formatFound = false;
@@ -298,6 +430,7 @@ void Context::CreatePipeline() {
     Shader fragment(this->device, "shaders/frag.spv", FRAGMENT);
 
     PipelineBuilder builder(this);
+    if (this->headless) builder.SetResolveLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
     this->pipeline = builder
         .SetDepthTesting(true)
         .SetMsaaSamples(this->msaaSamples)
@@ -337,27 +470,227 @@ void Context::CreatePipeline() {
     if (poolResult != VK_SUCCESS) {
         CRITICAL("Command pool creation failed with error code: {}", poolResult);
     }
+}
 
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = commandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = 1;
-    
-    VkResult allocResult = vkAllocateCommandBuffers(this->device, &allocInfo, &this->commandBuffer);
-    if (allocResult != VK_SUCCESS) {
-        CRITICAL("Command buffer allocation failed with error code: {}", allocResult);
+void Context::CreateFrames() {
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    this->frames.resize(this->framesInFlight);
+    for (uint32_t i = 0; i < this->framesInFlight; i++) {
+        Frame& frame = this->frames[i];
+
+        // Transient pool that is reset wholesale once the frame's fence has signalled
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = this->queueFamilies.graphics.value();
+
+        VkResult poolResult = vkCreateCommandPool(this->device, &poolInfo, nullptr, &frame.commandPool);
+        if (poolResult != VK_SUCCESS) {
+            CRITICAL("Frame command pool creation failed with error code: {}", poolResult);
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = frame.commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkResult allocResult = vkAllocateCommandBuffers(this->device, &allocInfo, &frame.commandBuffer);
+        if (allocResult != VK_SUCCESS) {
+            CRITICAL("Command buffer allocation failed with error code: {}", allocResult);
+        }
+
+        if (vkCreateSemaphore(this->device, &semaphoreInfo, nullptr, &frame.imageAvailableSemaphore) != VK_SUCCESS ||
+            vkCreateFence(this->device, &fenceInfo, nullptr, &frame.inFlightFence) != VK_SUCCESS) {
+            CRITICAL("failed to create synchronization objects");
+        }
+
+        frame.uniformOffset = this->uniformStride * i;
+
+        if (this->timestampsSupported) {
+            VkQueryPoolCreateInfo queryPoolInfo{};
+            queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            queryPoolInfo.queryCount = 2;
+
+            VkResult queryPoolResult = vkCreateQueryPool(this->device, &queryPoolInfo, nullptr, &frame.timestampPool);
+            if (queryPoolResult != VK_SUCCESS) {
+                CRITICAL("Timestamp query pool creation failed with error code: {}", queryPoolResult);
+            }
+        }
     }
+
+    if (this->headless) {
+        INFO("Created {} frames in flight", this->framesInFlight);
+        return;
+    }
+
+    this->renderFinishedSemaphores.resize(this->images.size());
+    for (auto& semaphore : this->renderFinishedSemaphores) {
+        if (vkCreateSemaphore(this->device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+            CRITICAL("failed to create synchronization objects");
+        }
+    }
+    this->imagesInFlight.resize(this->images.size(), VK_NULL_HANDLE);
+
+    INFO("Created {} frames in flight", this->framesInFlight);
+}
+
+uint32_t Context::BeginFrame() {
+    PROFILE_FUNCTION();
+    Frame& frame = this->GetFrame();
+    {
+        PROFILE_SCOPE("Wait for frame fence");
+        vkWaitForFences(this->device, 1, &frame.inFlightFence, VK_TRUE, UINT64_MAX);
+    }
+    this->gpuProfiler.Collect(this->currentFrame, this->frameNumber);
+    this->pipelineStatistics.Collect(this->currentFrame);
+    frame.arena.Reset();
+    this->bindless.Collect(this->frameNumber);
+    this->descriptorCache.Collect(this->frameNumber);
+
+    uint32_t imageIndex = this->currentFrame;
+    if (!this->headless) {
+        VkResult acquireResult = vkAcquireNextImageKHR(this->device, this->swapchain, UINT64_MAX, frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+        if (acquireResult != VK_SUCCESS) {
+            CRITICAL("Image acquiring failed with error code: {}", acquireResult);
+        }
+
+        // The swapchain can hand back an image an older frame is still rendering to when there are more frames than images
+        if (this->imagesInFlight[imageIndex] != VK_NULL_HANDLE && this->imagesInFlight[imageIndex] != frame.inFlightFence) {
+            vkWaitForFences(this->device, 1, &this->imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+        }
+        this->imagesInFlight[imageIndex] = frame.inFlightFence;
+    }
+
+    // The fence covers the timestamps too, so the results are available without waiting
+    if (frame.timestampsWritten) {
+        uint64_t timestamps[2];
+        VkResult queryResult = vkGetQueryPoolResults(this->device, frame.timestampPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (queryResult == VK_SUCCESS) {
+            this->gpuFrameTime = (timestamps[1] - timestamps[0]) * this->physicalProperties.limits.timestampPeriod / 1000000.0;
+        }
+        frame.timestampsWritten = false;
+    }
+
+    vkResetFences(this->device, 1, &frame.inFlightFence);
+    vkResetCommandPool(this->device, frame.commandPool, 0);
+    for (auto& worker : frame.workers) {
+        vkResetCommandPool(this->device, worker.commandPool, 0);
+        worker.used = 0;
+    }
+
+    return imageIndex;
+}
+
+void Context::EndFrame(uint32_t imageIndex) {
+    PROFILE_FUNCTION();
+    Frame& frame = this->GetFrame();
+    this->gpuProfiler.MarkSubmit(this->currentFrame);
+
+    // Only the swapchain pass touches the acquired image, earlier passes can run before it's available
+    VkSubmitInfo submitInfo{};
+    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = this->headless ? 0 : 1;
+    submitInfo.pWaitSemaphores = &frame.imageAvailableSemaphore;
+    submitInfo.pWaitDstStageMask = waitStages;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &frame.commandBuffer;
+    submitInfo.signalSemaphoreCount = this->headless ? 0 : 1;
+    submitInfo.pSignalSemaphores = this->headless ? nullptr : &this->renderFinishedSemaphores[imageIndex];
+
+    VkResult submitResult = vkQueueSubmit(this->graphics, 1, &submitInfo, frame.inFlightFence);
+    if (submitResult != VK_SUCCESS) {
+        CRITICAL("Failed to submit draw command buffer with error code: {}", submitResult);
+    }
+
+    if (!this->headless) {
+        VkPresentInfoKHR presentInfo{};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = &this->renderFinishedSemaphores[imageIndex];
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = &this->swapchain;
+        presentInfo.pImageIndices = &imageIndex;
+        VkResult presentResult = vkQueuePresentKHR(this->present, &presentInfo);
+        if (presentResult != VK_SUCCESS) {
+            CRITICAL("Vulkan presentation failed with error code: {}", presentResult);
+        }
+    }
+
+    this->AdvanceFrame();
 }
 
-void Context::StartCommandBuffer(VkCommandBuffer buffer, uint32_t imageIndex) {
+void Context::BeginFrameQueries(VkCommandBuffer buffer) {
+    Frame& frame = this->GetFrame();
+    this->gpuProfiler.Reset(buffer, this->currentFrame);
+    this->pipelineStatistics.Reset(buffer, this->currentFrame);
+    if (!frame.timestampPool) return;
+    vkCmdResetQueryPool(buffer, frame.timestampPool, 0, 2);
+    vkCmdWriteTimestamp(buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestampPool, 0);
+}
+
+void Context::EndFrameQueries(VkCommandBuffer buffer) {
+    Frame& frame = this->GetFrame();
+    if (!frame.timestampPool) return;
+    vkCmdWriteTimestamp(buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.timestampPool, 1);
+    frame.timestampsWritten = true;
+}
+
+void Context::CreateWorkerCommandPools(uint32_t workerCount) {
+    for (auto& frame : this->frames) {
+        frame.workers.resize(workerCount);
+        for (auto& worker : frame.workers) {
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            poolInfo.queueFamilyIndex = this->queueFamilies.graphics.value();
+
+            VkResult poolResult = vkCreateCommandPool(this->device, &poolInfo, nullptr, &worker.commandPool);
+            if (poolResult != VK_SUCCESS) {
+                CRITICAL("Worker command pool creation failed with error code: {}", poolResult);
+            }
+        }
+    }
+}
+
+VkCommandBuffer Context::GetSecondaryCommandBuffer(uint32_t worker) {
+    WorkerCommands& commands = this->GetFrame().workers[worker];
+    if (commands.used == commands.secondaries.size()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commands.commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer buffer;
+        VkResult allocResult = vkAllocateCommandBuffers(this->device, &allocInfo, &buffer);
+        if (allocResult != VK_SUCCESS) {
+            CRITICAL("Secondary command buffer allocation failed with error code: {}", allocResult);
+        }
+        commands.secondaries.push_back(buffer);
+    }
+
+    return commands.secondaries[commands.used++];
+}
+
+void Context::StartCommandBuffer(VkCommandBuffer buffer) {
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     VkResult beginResult = vkBeginCommandBuffer(buffer, &beginInfo);
     if (beginResult != VK_SUCCESS) {
         CRITICAL("Failed to begin command buffer with error code: {}", beginResult);
     }
+}
 
+void Context::StartRenderPass(VkCommandBuffer buffer, uint32_t imageIndex) {
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = this->pipeline->renderPass;
@@ -371,11 +704,14 @@ void Context::StartCommandBuffer(VkCommandBuffer buffer, uint32_t imageIndex) {
     renderPassInfo.pClearValues = clearValues.data();
     vkCmdBeginRenderPass(buffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
     vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline->pipeline);
-    //vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipelineLayout, 1, 1, &this->descriptorSet, 0, nullptr);
+    RenderStats::Get().CountPipelineBind();
 }
 
-void Context::EndCommandBuffer(VkCommandBuffer buffer) {
+void Context::EndRenderPass(VkCommandBuffer buffer) {
     vkCmdEndRenderPass(buffer);
+}
+
+void Context::EndCommandBuffer(VkCommandBuffer buffer) {
     VkResult endResult = vkEndCommandBuffer(buffer);
     if (endResult != VK_SUCCESS) {
         CRITICAL("Failed to end command buffer with error code: {}", endResult);
@@ -383,63 +719,29 @@ void Context::EndCommandBuffer(VkCommandBuffer buffer) {
 }
 
 void Context::CreateUniformBuffer() {
+    // One slice per frame in flight so the CPU never writes uniforms the GPU is still reading
     VkDeviceSize size = sizeof(UniformBufferObject);
-    CreateBuffer(this, this->uniformBuffer, this->uniformBufferMemory, size, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+    this->uniformStride = Pad((uint32_t)size, (uint32_t)this->physicalProperties.limits.minUniformBufferOffsetAlignment);
+    CreateBuffer(this, this->uniformBuffer, this->uniformBufferMemory, this->uniformStride * this->framesInFlight, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+    vkMapMemory(this->device, this->uniformBufferMemory, 0, VK_WHOLE_SIZE, 0, &this->uniformMapping);
+}
 
-    VkDescriptorPoolSize poolSizes[] =
-    {
-        { VK_DESCRIPTOR_TYPE_SAMPLER, 1000 },
-        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000 },
-        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1000 },
-        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1000 },
-        { VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1000 },
-        { VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1000 },
-        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000 },
-        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1000 },
-        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1000 },
-        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1000 },
-        { VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1000 }
-    }; // Make descriptor allocator better so this doesn't overallocate
+void Context::CreateDescriptorPools() {
+    this->descriptorCache.Init(this);
 
+    // The font atlas and the viewport texture, with room for a few panels
+    VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 16 };
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = std::size(poolSizes);
-    poolInfo.pPoolSizes = poolSizes;
-    poolInfo.maxSets = 1000;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 16;
 
-    VkResult poolResult = vkCreateDescriptorPool(this->device, &poolInfo, nullptr, &this->descriptorPool);
+    VkResult poolResult = vkCreateDescriptorPool(this->device, &poolInfo, nullptr, &this->uiDescriptorPool);
     if (poolResult != VK_SUCCESS) {
-        CRITICAL("Descriptor pool creation failed with error code: {}", poolResult);
+        CRITICAL("UI descriptor pool creation failed with error code: {}", poolResult);
     }
-
-    /*
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = this->descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &this->descriptorSetLayouts[1]; // Set to second set which is the view and projection matrices, model matrix is handled in the model class
-
-    VkResult allocResult = vkAllocateDescriptorSets(this->device, &allocInfo, &this->descriptorSet);
-    if (allocResult != VK_SUCCESS) {
-        CRITICAL("Descriptor set allocation failed with error code: {}", allocResult);
-    }
-
-    VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = this->uniformBuffer;
-    bufferInfo.offset = 0;
-    bufferInfo.range = size;
-
-    VkWriteDescriptorSet descriptorWrite{};
-    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet = this->descriptorSet;
-    descriptorWrite.dstBinding = 0;
-    descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptorWrite.descriptorCount = 1;
-    descriptorWrite.pBufferInfo = &bufferInfo;
-
-    vkUpdateDescriptorSets(this->device, 1, &descriptorWrite, 0, nullptr);
-    */
 }
 
 void Context::StartAndSubmitCommandBuffer(VkQueue queue, const std::function<void(VkCommandBuffer)>& body) const {
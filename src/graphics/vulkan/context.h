@@ -7,57 +7,130 @@
 #include "shader.h"
 #include "vma.h"
 #include "descriptor.h"
+#include "sampler.h"
+#include "pipelinecache.h"
+#include "layoutcache.h"
+#include "bindless.h"
+#include "gpuprofiler.h"
+#include "stats.h"
+#include "core/arena.h"
 
 class Image;
-class DescriptorAllocator;
 struct Pipeline;
+class TextureStreamer;
+
+// Secondary command buffers recorded by one worker thread, its pool is only ever touched by that thread
+struct WorkerCommands {
+    VkCommandPool commandPool;
+    std::vector<VkCommandBuffer> secondaries;
+    uint32_t used = 0;
+};
+
+// Everything the CPU touches while recording a frame, duplicated so it can get ahead of the GPU by framesInFlight - 1 frames
+struct Frame {
+    VkCommandPool commandPool;
+    VkCommandBuffer commandBuffer;
+    VkFence inFlightFence;
+    VkSemaphore imageAvailableSemaphore;
+    VkDeviceSize uniformOffset;
+    std::vector<WorkerCommands> workers;
+    // Start and end of the frame's command buffer, read back once the fence has signalled
+    VkQueryPool timestampPool{};
+    bool timestampsWritten = false;
+    // CPU memory that only lives for this frame (draw lists, pass callbacks), rewound once the fence has signalled.
+    // Only the thread recording the frame may use it
+    LinearArena arena;
+};
 
 struct Context {
-    Context(Window* window);
+    Context(Window* window, uint32_t framesInFlight = 2);
+    // Headless, renders into offscreen targets of the given size instead of a window's swapchain
+    Context(uint32_t width, uint32_t height, uint32_t framesInFlight = 2);
     ~Context();
 
     void CreateDevice();
     void CreateSwapchain();
     void CreatePipeline();
     void CreateUniformBuffer();
+    void CreateDescriptorPools();
+    void CreateFrames();
+    void CreateWorkerCommandPools(uint32_t workerCount);
+
+    inline Frame& GetFrame() { return this->frames[this->currentFrame]; }
+    inline LinearArena& GetFrameArena() { return this->GetFrame().arena; }
+    inline void* GetFrameUniforms() { return (char*)this->uniformMapping + this->GetFrame().uniformOffset; }
+    // Waits until the GPU is done with the current frame's resources and acquires the next swapchain image for it
+    uint32_t BeginFrame();
+    // Submits the frame's command buffer and presents the image unless headless
+    void EndFrame(uint32_t imageIndex);
+    // Brackets the frame's GPU work and resets its query pools, the duration ends up in gpuFrameTime framesInFlight frames later
+    void BeginFrameQueries(VkCommandBuffer buffer);
+    void EndFrameQueries(VkCommandBuffer buffer);
+    // Must only be called from the worker thread with the given index
+    VkCommandBuffer GetSecondaryCommandBuffer(uint32_t worker);
+    void AdvanceFrame() {
+        this->currentFrame = (this->currentFrame + 1) % this->framesInFlight;
+        this->frameNumber++;
+    }
 
-    void StartCommandBuffer(VkCommandBuffer buffer, uint32_t imageIndex);
+    void StartCommandBuffer(VkCommandBuffer buffer);
+    void StartRenderPass(VkCommandBuffer buffer, uint32_t imageIndex);
+    void EndRenderPass(VkCommandBuffer buffer);
     void EndCommandBuffer(VkCommandBuffer buffer);
     void StartAndSubmitCommandBuffer(VkQueue queue, const std::function<void(VkCommandBuffer)>& body) const;
 
     VkInstance instance;
     VkPhysicalDevice physical;
     VkPhysicalDeviceProperties physicalProperties;
+    VkPhysicalDeviceFeatures enabledFeatures{};
+    uint32_t maxBindlessTextures = 0;
     QueueFamilies queueFamilies;
     VkDevice device;
     VkQueue graphics;
     VkQueue present;
     VmaAllocator allocator;
+    SamplerCache samplerCache;
+    PipelineCache pipelineCache;
+    LayoutCache layoutCache;
     
     Window* window;
-    VkSurfaceKHR surface;
+    bool headless = false;
+    VkSurfaceKHR surface{};
     VkSurfaceFormatKHR format;
     VkExtent2D extent;
     VkSwapchainKHR swapchain;
     std::vector<VkImage> images;
     std::vector<VkImageView> imageViews;
     std::vector<VkFramebuffer> framebuffers;
+    std::vector<std::unique_ptr<Image>> targets;
 
     Pipeline *pipeline;
 
     VkCommandPool commandPool;
-    VkCommandBuffer commandBuffer;
 
-    VkSemaphore imageAvailableSemaphore;
-    VkSemaphore renderFinishedSemaphore;
-    VkFence inFlightFence;
+    uint32_t framesInFlight;
+    uint32_t currentFrame = 0;
+    uint64_t frameNumber = 0;
+    std::vector<Frame> frames;
+    // Indexed by swapchain image, a semaphore can't be reused until the presentation waiting on it is done
+    std::vector<VkSemaphore> renderFinishedSemaphores;
+    std::vector<VkFence> imagesInFlight;
+    bool timestampsSupported = false;
+    // Milliseconds the GPU spent on the last frame whose results came back
+    double gpuFrameTime = 0.0;
+    GpuProfiler gpuProfiler;
+    PipelineStatistics pipelineStatistics;
 
-    std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
     VkBuffer uniformBuffer;
     VkDeviceMemory uniformBufferMemory;
-    VkDescriptorPool descriptorPool;
-    VkDescriptorSet descriptorSet;
-    DescriptorAllocator *descriptorAllocator;
+    VkDeviceSize uniformStride;
+    void* uniformMapping;
+    DescriptorCache descriptorCache;
+    BindlessTable bindless;
+    // Set by renderers that stream textures, models hand their textures to it instead of uploading them whole
+    TextureStreamer* textureStreamer = nullptr;
+    // ImGui frees its texture sets individually, so it gets a small pool of its own
+    VkDescriptorPool uiDescriptorPool{};
 
     VkSampleCountFlagBits msaaSamples{};
 
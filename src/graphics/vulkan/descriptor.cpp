@@ -0,0 +1,233 @@
+#include "descriptor.h"
+#include "context.h"
+#include "core/hash.h"
+#include "stats.h"
+
+void DescriptorAllocator::Init(VkDevice device, uint32_t initialSets, const std::vector<DescriptorPoolRatio>& ratios) {
+    this->device = device;
+    this->ratios = ratios;
+    this->setsPerPool = initialSets;
+    this->readyPools.push_back(this->CreatePool(initialSets));
+}
+
+void DescriptorAllocator::Destroy() {
+    for (VkDescriptorPool pool : this->fullPools) vkDestroyDescriptorPool(this->device, pool, nullptr);
+    for (VkDescriptorPool pool : this->readyPools) vkDestroyDescriptorPool(this->device, pool, nullptr);
+    this->fullPools.clear();
+    this->readyPools.clear();
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout) {
+    VkDescriptorPool pool = this->GetPool();
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    VkDescriptorSet set;
+    VkResult result = vkAllocateDescriptorSets(this->device, &allocInfo, &set);
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+        // Retire the pool and try once more with a fresh one, a second failure means the layout doesn't fit any pool
+        this->fullPools.push_back(pool);
+        allocInfo.descriptorPool = this->GetPool();
+        result = vkAllocateDescriptorSets(this->device, &allocInfo, &set);
+    }
+    if (result != VK_SUCCESS) {
+        CRITICAL("Descriptor set allocation failed with error code: {}", result);
+    }
+    this->readyPools.push_back(allocInfo.descriptorPool);
+
+    return set;
+}
+
+VkDescriptorPool DescriptorAllocator::GetPool() {
+    if (!this->readyPools.empty()) {
+        VkDescriptorPool pool = this->readyPools.back();
+        this->readyPools.pop_back();
+        return pool;
+    }
+
+    this->setsPerPool = std::min(this->setsPerPool + this->setsPerPool / 2, maxSetsPerPool);
+    return this->CreatePool(this->setsPerPool);
+}
+
+VkDescriptorPool DescriptorAllocator::CreatePool(uint32_t setCount) {
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (const auto& ratio : this->ratios) {
+        poolSizes.push_back({ ratio.type, std::max(1u, (uint32_t)(ratio.ratio * setCount)) });
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = setCount;
+    poolInfo.poolSizeCount = poolSizes.size();
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    VkDescriptorPool pool;
+    VkResult result = vkCreateDescriptorPool(this->device, &poolInfo, nullptr, &pool);
+    if (result != VK_SUCCESS) {
+        CRITICAL("Descriptor pool creation failed with error code: {}", result);
+    }
+    DEBUG("Created descriptor pool for {} sets", setCount);
+
+    return pool;
+}
+
+DescriptorWriter& DescriptorWriter::WriteBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, VkDescriptorType type) {
+    this->Add() = { binding, type, { buffer, offset, range }, {} };
+    return *this;
+}
+
+DescriptorWriter& DescriptorWriter::WriteImage(uint32_t binding, VkImageView view, VkSampler sampler, VkImageLayout layout, VkDescriptorType type) {
+    this->Add() = { binding, type, {}, { sampler, view, layout } };
+    return *this;
+}
+
+DescriptorWriter::Write& DescriptorWriter::Add() {
+    if (this->count == maxWrites) {
+        CRITICAL("Descriptor writer only holds {} writes", maxWrites);
+    }
+    return this->writes[this->count++];
+}
+
+void DescriptorWriter::Update(VkDevice device, VkDescriptorSet set) const {
+    std::array<VkWriteDescriptorSet, maxWrites> descriptorWrites{};
+    for (uint32_t i = 0; i < this->count; i++) {
+        const Write& write = this->writes[i];
+        VkWriteDescriptorSet& descriptorWrite = descriptorWrites[i];
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = set;
+        descriptorWrite.dstBinding = write.binding;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.descriptorType = write.type;
+        if (write.image.imageView || write.image.sampler) descriptorWrite.pImageInfo = &write.image;
+        else descriptorWrite.pBufferInfo = &write.buffer;
+    }
+    vkUpdateDescriptorSets(device, this->count, descriptorWrites.data(), 0, nullptr);
+    RenderStats::Get().CountDescriptorWrites(this->count);
+}
+
+bool DescriptorWriter::UsesBuffer(VkBuffer buffer) const {
+    return std::any_of(this->writes.begin(), this->writes.begin() + this->count, [&](const Write& write) { return write.buffer.buffer == buffer; });
+}
+
+bool DescriptorWriter::UsesImageView(VkImageView view) const {
+    return std::any_of(this->writes.begin(), this->writes.begin() + this->count, [&](const Write& write) { return write.image.imageView == view; });
+}
+
+size_t DescriptorWriter::Hash() const {
+    size_t seed = this->count;
+    for (uint32_t i = 0; i < this->count; i++) {
+        const Write& write = this->writes[i];
+        HashCombine(seed, write.binding);
+        HashCombine(seed, (uint32_t)write.type);
+        HashCombine(seed, write.buffer.buffer);
+        HashCombine(seed, write.buffer.offset);
+        HashCombine(seed, write.buffer.range);
+        HashCombine(seed, write.image.imageView);
+        HashCombine(seed, write.image.sampler);
+        HashCombine(seed, (uint32_t)write.image.imageLayout);
+    }
+    return seed;
+}
+
+bool DescriptorWriter::operator==(const DescriptorWriter& other) const {
+    auto end = this->writes.begin() + this->count;
+    auto otherEnd = other.writes.begin() + other.count;
+    return std::equal(this->writes.begin(), end, other.writes.begin(), otherEnd, [](const Write& a, const Write& b) {
+        return a.binding == b.binding &&
+            a.type == b.type &&
+            a.buffer.buffer == b.buffer.buffer &&
+            a.buffer.offset == b.buffer.offset &&
+            a.buffer.range == b.buffer.range &&
+            a.image.imageView == b.image.imageView &&
+            a.image.sampler == b.image.sampler &&
+            a.image.imageLayout == b.image.imageLayout;
+    });
+}
+
+size_t DescriptorCache::KeyHash::operator()(const Key& key) const {
+    size_t seed = key.writer.Hash();
+    HashCombine(seed, key.layout);
+    return seed;
+}
+
+void DescriptorCache::Init(Context* context) {
+    this->context = context;
+    // Long lived sets are mostly materials, a uniform block and a handful of textures each
+    this->allocator.Init(context->device, 64, {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0.5f },
+    });
+}
+
+void DescriptorCache::Destroy() {
+    size_t freeSets = 0;
+    for (const auto& [layout, layoutSets] : this->free) freeSets += layoutSets.size();
+    if (this->sets.size() + this->retired.size() + freeSets != this->allocatedSets) {
+        WARN("Descriptor cache lost track of {} sets", this->allocatedSets - this->sets.size() - this->retired.size() - freeSets);
+    }
+
+    this->sets.clear();
+    this->retired.clear();
+    this->free.clear();
+    this->allocator.Destroy();
+}
+
+VkDescriptorSet DescriptorCache::Get(VkDescriptorSetLayout layout, const DescriptorWriter& writer) {
+    Key key{ layout, writer };
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto it = this->sets.find(key);
+    if (it != this->sets.end()) {
+        return it->second;
+    }
+
+    // A forgotten set with the same layout is rewritten rather than allocating a new one
+    VkDescriptorSet set;
+    std::vector<VkDescriptorSet>& freeSets = this->free[layout];
+    if (!freeSets.empty()) {
+        set = freeSets.back();
+        freeSets.pop_back();
+    }
+    else {
+        set = this->allocator.Allocate(layout);
+        this->allocatedSets++;
+    }
+    writer.Update(this->context->device, set);
+    this->sets.emplace(std::move(key), set);
+
+    return set;
+}
+
+template<typename Predicate>
+void DescriptorCache::Retire(Predicate uses) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::erase_if(this->sets, [&](const auto& entry) {
+        if (!uses(entry.first.writer)) return false;
+        this->retired.push_back({ entry.first.layout, entry.second, this->context->frameNumber });
+        return true;
+    });
+}
+
+void DescriptorCache::ForgetBuffer(VkBuffer buffer) {
+    if (buffer == VK_NULL_HANDLE) return;
+    this->Retire([&](const DescriptorWriter& writer) { return writer.UsesBuffer(buffer); });
+}
+
+void DescriptorCache::ForgetImageView(VkImageView view) {
+    if (view == VK_NULL_HANDLE) return;
+    this->Retire([&](const DescriptorWriter& writer) { return writer.UsesImageView(view); });
+}
+
+void DescriptorCache::Collect(uint64_t frameNumber) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto done = std::partition(this->retired.begin(), this->retired.end(), [&](const Retired& retired) {
+        return retired.frameNumber + this->context->framesInFlight > frameNumber;
+    });
+    for (auto it = done; it != this->retired.end(); it++) this->free[it->layout].push_back(it->set);
+    this->retired.erase(done, this->retired.end());
+}
@@ -2,26 +2,109 @@
 
 #include "core/core.h"
 #include "vulkan/vulkan.h"
+#include "mutex"
 
 struct Context;
 
+// How many descriptors of a type a pool gets per set it can hold
+struct DescriptorPoolRatio {
+	VkDescriptorType type;
+	float ratio;
+};
+
+// Hands out sets from a chain of pools. When the current pool runs out a new one is created, each bigger than the last
+// up to a cap, so allocation cost stops growing once the chain has settled. Sets are never freed, owners recycle them
 class DescriptorAllocator {
 public:
-	DescriptorAllocator();
-	~DescriptorAllocator();
+	void Init(VkDevice device, uint32_t initialSets, const std::vector<DescriptorPoolRatio>& ratios);
+	void Destroy();
+
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+
+	size_t GetPoolCount() const { return this->fullPools.size() + this->readyPools.size(); }
+private:
+	static constexpr uint32_t maxSetsPerPool = 4096;
+
+	VkDescriptorPool GetPool();
+	VkDescriptorPool CreatePool(uint32_t setCount);
+
+	VkDevice device{};
+	std::vector<DescriptorPoolRatio> ratios;
+	uint32_t setsPerPool = 0;
+	std::vector<VkDescriptorPool> fullPools;
+	std::vector<VkDescriptorPool> readyPools;
+};
+
+// Collects the contents of one descriptor set, also what the descriptor cache keys on
+class DescriptorWriter {
+public:
+	DescriptorWriter& WriteBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, VkDescriptorType type);
+	DescriptorWriter& WriteImage(uint32_t binding, VkImageView view, VkSampler sampler, VkImageLayout layout, VkDescriptorType type);
+
+	void Update(VkDevice device, VkDescriptorSet set) const;
+	bool UsesBuffer(VkBuffer buffer) const;
+	bool UsesImageView(VkImageView view) const;
+	size_t Hash() const;
+	bool operator==(const DescriptorWriter& other) const;
 private:
-	typedef PoolSizes = std::unordered_map<VkDescriptorType, uint32_t>;
+	// Writers are built on every bind, the writes live inline so that never allocates
+	static constexpr uint32_t maxWrites = 8;
 
-	struct DescriptorPool {
-		VkDescriptorPool pool;
-		PoolSizes remaining;
-		std::vector<VkDescriptorSet> allocated;
+	struct Write {
+		uint32_t binding;
+		VkDescriptorType type;
+		VkDescriptorBufferInfo buffer;
+		VkDescriptorImageInfo image;
 	};
 
-	struct DescriptorSet {
-		VkDescriptorSet set;
+	Write& Add();
+
+	std::array<Write, maxWrites> writes;
+	uint32_t count = 0;
+};
+
+// Sets with identical layout and contents are written once and reused, so a steady scene issues no descriptor writes.
+// Entries hold raw handles, buffers and images forget theirs when they're destroyed so a reused handle never hits
+class DescriptorCache {
+public:
+	void Init(Context* context);
+	void Destroy();
+
+	VkDescriptorSet Get(VkDescriptorSetLayout layout, const DescriptorWriter& writer);
+	// Drops the entries pointing at a resource about to be destroyed. Frames in flight may still have their sets bound,
+	// so the sets are only rewritten for new entries framesInFlight frames later
+	void ForgetBuffer(VkBuffer buffer);
+	void ForgetImageView(VkImageView view);
+	// Hands sets forgotten long enough ago to the free lists, once the frame's fence has signalled
+	void Collect(uint64_t frameNumber);
+
+	size_t Size() const { return this->sets.size(); }
+private:
+	struct Key {
 		VkDescriptorSetLayout layout;
+		DescriptorWriter writer;
+
+		bool operator==(const Key& other) const { return this->layout == other.layout && this->writer == other.writer; }
+	};
+	struct KeyHash {
+		size_t operator()(const Key& key) const;
 	};
 
-	std::vector<DescriptorPools> pools;
-};
\ No newline at end of file
+	struct Retired {
+		VkDescriptorSetLayout layout;
+		VkDescriptorSet set;
+		uint64_t frameNumber;
+	};
+
+	template<typename Predicate>
+	void Retire(Predicate uses);
+
+	Context* context = nullptr;
+	std::mutex mutex;
+	DescriptorAllocator allocator;
+	std::unordered_map<Key, VkDescriptorSet, KeyHash> sets;
+	std::vector<Retired> retired;
+	std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> free;
+	// Every set the allocator handed out, each one is cached, retired or free
+	size_t allocatedSets = 0;
+};
@@ -0,0 +1,89 @@
+#include "gpuprofiler.h"
+
+#include "context.h"
+#include "core/arena.h"
+
+void GpuProfiler::Init(Context* context) {
+    this->context = context;
+    this->frames.resize(context->framesInFlight);
+#ifdef FENRIR_PROFILING
+    if (!context->timestampsSupported) {
+        WARN("Graphics queue doesn't support timestamps, GPU zones are disabled");
+        return;
+    }
+
+    for (auto& frame : this->frames) {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = maxZones * 2;
+
+        VkResult queryPoolResult = vkCreateQueryPool(context->device, &queryPoolInfo, nullptr, &frame.pool);
+        if (queryPoolResult != VK_SUCCESS) {
+            CRITICAL("GPU profiler query pool creation failed with error code: {}", queryPoolResult);
+        }
+    }
+#endif
+}
+
+void GpuProfiler::Destroy() {
+    for (auto& frame : this->frames) {
+        if (frame.pool) vkDestroyQueryPool(this->context->device, frame.pool, nullptr);
+    }
+    this->frames.clear();
+}
+
+void GpuProfiler::Collect(uint32_t frameIndex, uint64_t frameNumber) {
+    this->currentFrame = frameIndex;
+    FrameQueries& frame = this->frames[frameIndex];
+    if (!frame.pool || !frame.pending || frame.zones.empty()) return;
+    frame.pending = false;
+
+    ScratchScope scratch;
+    std::pmr::vector<uint64_t> timestamps(frame.zones.size() * 2, scratch.Get());
+    VkResult queryResult = vkGetQueryPoolResults(this->context->device, frame.pool, 0, (uint32_t)timestamps.size(), timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (queryResult != VK_SUCCESS) return;
+
+    // GPU ticks have their own origin, line the first zone up with the submission, which is close enough to read a timeline
+    double period = this->context->physicalProperties.limits.timestampPeriod;
+    uint64_t origin = timestamps[0];
+    std::pmr::vector<GpuProfileEvent> events(scratch.Get());
+    events.reserve(frame.zones.size());
+    for (uint32_t i = 0; i < frame.zones.size(); i++) {
+        uint64_t start = frame.submitTime + (uint64_t)((timestamps[i * 2] - origin) * period);
+        uint64_t end = frame.submitTime + (uint64_t)((timestamps[i * 2 + 1] - origin) * period);
+        events.push_back({ frame.zones[i].name, start, end, frame.zones[i].depth, frameNumber - this->frames.size() });
+    }
+    Profiler::Get().AddGpuEvents(events);
+}
+
+void GpuProfiler::Reset(VkCommandBuffer buffer, uint32_t frameIndex) {
+    FrameQueries& frame = this->frames[frameIndex];
+    frame.zones.clear();
+    frame.depth = 0;
+    if (!frame.pool) return;
+    vkCmdResetQueryPool(buffer, frame.pool, 0, maxZones * 2);
+}
+
+void GpuProfiler::MarkSubmit(uint32_t frameIndex) {
+    FrameQueries& frame = this->frames[frameIndex];
+    frame.submitTime = Profiler::Now();
+    frame.pending = true;
+}
+
+uint32_t GpuProfiler::BeginZone(VkCommandBuffer buffer, const std::string& name) {
+    FrameQueries& frame = this->frames[this->currentFrame];
+    if (!frame.pool || frame.zones.size() == maxZones) return UINT32_MAX;
+
+    uint32_t zone = (uint32_t)frame.zones.size();
+    frame.zones.push_back({ name, frame.depth++ });
+    vkCmdWriteTimestamp(buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.pool, zone * 2);
+    return zone;
+}
+
+void GpuProfiler::EndZone(VkCommandBuffer buffer, uint32_t zone) {
+    if (zone == UINT32_MAX) return;
+    FrameQueries& frame = this->frames[this->currentFrame];
+    frame.depth--;
+    vkCmdWriteTimestamp(buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.pool, zone * 2 + 1);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/profiler.h"
+#include "vulkan/vulkan.h"
+
+struct Context;
+
+// Timestamp queries around zones of a frame's primary command buffer, results are picked up once the frame's fence has
+// signalled and handed to the CPU profiler so both end up on one timeline
+class GpuProfiler {
+public:
+    void Init(Context* context);
+    void Destroy();
+
+    // Called by the context at the points in the frame they're named after
+    void Collect(uint32_t frameIndex, uint64_t frameNumber);
+    void Reset(VkCommandBuffer buffer, uint32_t frameIndex);
+    void MarkSubmit(uint32_t frameIndex);
+
+    // Only from the thread recording the frame's primary command buffer
+    uint32_t BeginZone(VkCommandBuffer buffer, const std::string& name);
+    void EndZone(VkCommandBuffer buffer, uint32_t zone);
+private:
+    static constexpr uint32_t maxZones = 128;
+
+    struct Zone {
+        std::string name;
+        uint32_t depth;
+    };
+
+    struct FrameQueries {
+        VkQueryPool pool{};
+        std::vector<Zone> zones;
+        uint32_t depth = 0;
+        uint64_t submitTime = 0;
+        bool pending = false;
+    };
+
+    Context* context{};
+    uint32_t currentFrame = 0;
+    std::vector<FrameQueries> frames;
+};
+
+class GpuProfileScope {
+public:
+    GpuProfileScope(GpuProfiler& profiler, VkCommandBuffer buffer, const std::string& name) : profiler(profiler), buffer(buffer), zone(profiler.BeginZone(buffer, name)) {}
+    ~GpuProfileScope() { this->profiler.EndZone(this->buffer, this->zone); }
+private:
+    GpuProfiler& profiler;
+    VkCommandBuffer buffer;
+    uint32_t zone;
+};
+
+#ifdef FENRIR_PROFILING
+#define PROFILE_GPU_SCOPE(context, buffer, name) GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)((context)->gpuProfiler, buffer, name)
+#else
+#define PROFILE_GPU_SCOPE(context, buffer, name)
+#endif
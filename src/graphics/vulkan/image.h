@@ -1,9 +1,11 @@
 #pragma once
 
 #include "core/core.h"
+#include "core/vfs.h"
 #include "vulkan/vulkan.h"
 #include "vma.h"
 #include "stb_image.h"
+#include "stb_image_write.h"
 #include "buffer.h"
 #include "context.h"
 #include <vulkan/vulkan_core.h>
@@ -16,6 +18,8 @@ public:
     VmaAllocation allocation{};
     VkFormat format{};
     VkImageLayout currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags currentStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    VkAccessFlags currentAccess = 0;
 
     uint32_t width = 0;
     uint32_t height = 0;
@@ -28,26 +32,7 @@ public:
     }
 
     void Init(Context *context, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT, uint32_t mipLevels = 1) {
-        this->context = context;
-        this->format = format;
-        this->width = width;
-        this->height = height;
-        this->mipLevels = mipLevels;
-        this->samples = samples;
-
-        VkImageCreateInfo imageInfo = {};
-        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        imageInfo.imageType = VK_IMAGE_TYPE_2D;
-        imageInfo.extent.width = this->width;
-        imageInfo.extent.height = this->height;
-        imageInfo.extent.depth = 1;
-        imageInfo.mipLevels = this->mipLevels;
-        imageInfo.arrayLayers = 1;
-        imageInfo.format = this->format;
-        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imageInfo.usage = usage;
-        imageInfo.samples = samples;
+        VkImageCreateInfo imageInfo = this->SetupCreateInfo(context, width, height, format, usage, samples, mipLevels);
 
         VmaAllocationCreateInfo allocInfo = {};
         allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
@@ -58,24 +43,100 @@ public:
         }
     }
 
-    static std::unique_ptr<Image> LoadImage(Context* context, const std::string& filePath) {
+    // Creates the image without backing memory, the caller binds it into memory it owns (used for aliasing transient attachments)
+    void InitUnbound(Context *context, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT, uint32_t mipLevels = 1) {
+        VkImageCreateInfo imageInfo = this->SetupCreateInfo(context, width, height, format, usage, samples, mipLevels);
+        this->ownsMemory = false;
+
+        VkResult result = vkCreateImage(context->device, &imageInfo, nullptr, &this->image);
+        if (result != VK_SUCCESS) {
+            CRITICAL("Image creation failed with error code: {}", result);
+        }
+    }
+
+    VkImageAspectFlags GetAspect() const {
+        switch (this->format) {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_D32_SFLOAT:
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+            return VK_IMAGE_ASPECT_DEPTH_BIT;
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        default:
+            return VK_IMAGE_ASPECT_COLOR_BIT;
+        }
+    }
+
+    struct Pixels {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> data;
+    };
+
+    // Decodes to RGBA8 on the CPU only, so it's safe to run on any thread
+    static Pixels DecodeImage(const std::string& filePath) {
+        std::vector<char> bytes;
+        if (!FileSystem::Get().ReadFile(filePath, bytes)) {
+            CRITICAL("Failed to load image: {}", filePath);
+        }
         int width, height, channels;
-        stbi_uc* pixels = stbi_load(filePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        stbi_uc* pixels = stbi_load_from_memory((const stbi_uc*)bytes.data(), (int)bytes.size(), &width, &height, &channels, STBI_rgb_alpha);
         if (!pixels) {
             CRITICAL("Failed to load image: {}", filePath);
         }
-        uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
-        std::vector<uint8_t> pixelData(width * height * 4);
-        memcpy(pixelData.data(), pixels, width * height * 4);
+        Pixels decoded{ (uint32_t)width, (uint32_t)height, std::vector<uint8_t>(width * height * 4) };
+        memcpy(decoded.data.data(), pixels, width * height * 4);
         stbi_image_free(pixels);
+        return decoded;
+    }
 
-        Buffer<uint8_t> stagingBuffer(context, pixelData, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-        std::unique_ptr<Image> image = std::make_unique<Image>(context, width, height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_SAMPLE_COUNT_1_BIT, mipLevels);
-        context->StartAndSubmitCommandBuffer(context->graphics, [&image, &stagingBuffer](VkCommandBuffer commandBuffer) {
-            image->TransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-            image->CopyFrom(commandBuffer, stagingBuffer);
-            image->GenerateMipmaps(commandBuffer);
+    // Averages each 2x2 square, clamped at odd edges, which is what the loader's linear blits to half size come down to
+    static Pixels Downsample(const Pixels& source) {
+        Pixels mip{ std::max(1u, source.width / 2), std::max(1u, source.height / 2) };
+        mip.data.resize((size_t)mip.width * mip.height * 4);
+        for (uint32_t y = 0; y < mip.height; y++) {
+            const uint8_t* row0 = &source.data[(size_t)std::min(y * 2, source.height - 1) * source.width * 4];
+            const uint8_t* row1 = &source.data[(size_t)std::min(y * 2 + 1, source.height - 1) * source.width * 4];
+            for (uint32_t x = 0; x < mip.width; x++) {
+                uint32_t x0 = std::min(x * 2, source.width - 1) * 4;
+                uint32_t x1 = std::min(x * 2 + 1, source.width - 1) * 4;
+                uint8_t* pixel = &mip.data[((size_t)y * mip.width + x) * 4];
+                for (uint32_t channel = 0; channel < 4; channel++) {
+                    pixel[channel] = (uint8_t)((row0[x0 + channel] + row0[x1 + channel] + row1[x0 + channel] + row1[x1 + channel] + 2) / 4);
+                }
+            }
+        }
+        return mip;
+    }
+
+    // Uploads every mip before returning, textures drawn by the editor stream in through TextureStreamer instead
+    static std::unique_ptr<Image> LoadImage(Context* context, const std::string& filePath) {
+        return CreateFromPixels(context, DecodeImage(filePath));
+    }
+
+    // Uploads through the graphics queue and builds the mip chain, waits for the queue to go idle so main thread only
+    static std::unique_ptr<Image> CreateFromPixels(Context* context, const Pixels& pixels) {
+        std::unique_ptr<Image> image;
+        std::unique_ptr<Buffer<uint8_t>> staging;
+        context->StartAndSubmitCommandBuffer(context->graphics, [&](VkCommandBuffer commandBuffer) {
+            image = CreateFromPixels(context, pixels, commandBuffer, staging);
         });
+        return image;
+    }
+
+    // Records the upload and the mip chain into commandBuffer instead, staging has to live until it has executed
+    static std::unique_ptr<Image> CreateFromPixels(Context* context, const Pixels& pixels, VkCommandBuffer commandBuffer, std::unique_ptr<Buffer<uint8_t>>& staging) {
+        uint32_t width = pixels.width;
+        uint32_t height = pixels.height;
+        uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+
+        staging = std::make_unique<Buffer<uint8_t>>(context, pixels.data, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+        std::unique_ptr<Image> image = std::make_unique<Image>(context, width, height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_SAMPLE_COUNT_1_BIT, mipLevels);
+        image->TransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        image->CopyFrom(commandBuffer, *staging);
+        image->GenerateMipmaps(commandBuffer);
 
         return image;
     }
@@ -101,7 +162,113 @@ public:
         vkCmdCopyBufferToImage(commandBuffer, src.buffer, this->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
     }
 
+    // Reads the image back and writes it out as a PNG, blocks until the GPU is done with it
+    void Save(const std::string& filePath) {
+        VkDeviceSize size = (VkDeviceSize)this->width * this->height * 4;
+
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+
+        VkBuffer buffer;
+        VmaAllocation allocation;
+        VkResult allocResult = vmaCreateBuffer(context->allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr);
+        if (allocResult != VK_SUCCESS) {
+            CRITICAL("Readback buffer allocation failed with error code: {}", allocResult);
+        }
+
+        context->StartAndSubmitCommandBuffer(context->graphics, [this, buffer](VkCommandBuffer commandBuffer) {
+            this->TransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+            VkBufferImageCopy region{};
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = 0;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageExtent = { this->width, this->height, 1 };
+            vkCmdCopyImageToBuffer(commandBuffer, this->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+        });
+
+        std::vector<uint8_t> pixels(size);
+        void* mapping;
+        vmaMapMemory(context->allocator, allocation, &mapping);
+        vmaInvalidateAllocation(context->allocator, allocation, 0, VK_WHOLE_SIZE);
+        memcpy(pixels.data(), mapping, size);
+        vmaUnmapMemory(context->allocator, allocation);
+        vmaDestroyBuffer(context->allocator, buffer, allocation);
+
+        if (this->format == VK_FORMAT_B8G8R8A8_SRGB || this->format == VK_FORMAT_B8G8R8A8_UNORM) {
+            for (VkDeviceSize i = 0; i < size; i += 4) std::swap(pixels[i], pixels[i + 2]);
+        }
+
+        if (!stbi_write_png(filePath.c_str(), this->width, this->height, 4, pixels.data(), this->width * 4)) {
+            CRITICAL("Failed to write image: {}", filePath);
+        }
+        INFO("Saved {}x{} image to {}", this->width, this->height, filePath);
+    }
+
+    // The pipeline stages and accesses an image in a given layout is expected to be used with
+    static void GetLayoutUsage(VkImageLayout layout, VkPipelineStageFlags& stage, VkAccessFlags& access) {
+        switch (layout) {
+        case VK_IMAGE_LAYOUT_UNDEFINED:
+        case VK_IMAGE_LAYOUT_PREINITIALIZED:
+            stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            access = 0;
+            break;
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+            stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            access = VK_ACCESS_TRANSFER_WRITE_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+            stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            access = VK_ACCESS_TRANSFER_READ_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+            stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+            access = VK_ACCESS_SHADER_READ_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+            stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+            stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+            stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+            access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+            stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+            access = 0;
+            break;
+        case VK_IMAGE_LAYOUT_GENERAL:
+            stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            access = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+            break;
+        default:
+            CRITICAL("Layout {} is not supported", layout);
+        }
+    }
+
     void TransitionLayout(VkCommandBuffer commandBuffer, VkImageLayout to) {
+        VkPipelineStageFlags destinationStage;
+        VkAccessFlags destinationAccess;
+        GetLayoutUsage(to, destinationStage, destinationAccess);
+
+        // GetBarrier moves the tracked stage on to the destination
+        VkPipelineStageFlags sourceStage = this->currentStage;
+        VkImageMemoryBarrier barrier = this->GetBarrier(to, destinationStage, destinationAccess);
+        vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    // Builds a barrier from the tracked state to the given one and updates the tracked state, the caller records (and can batch) it
+    VkImageMemoryBarrier GetBarrier(VkImageLayout to, VkPipelineStageFlags stage, VkAccessFlags access) {
         VkImageMemoryBarrier barrier = {};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         barrier.oldLayout = this->currentLayout;
@@ -109,33 +276,19 @@ public:
         barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.image = this->image;
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.aspectMask = this->GetAspect();
         barrier.subresourceRange.baseMipLevel = 0;
         barrier.subresourceRange.levelCount = this->mipLevels;
         barrier.subresourceRange.baseArrayLayer = 0;
         barrier.subresourceRange.layerCount = 1;
+        barrier.srcAccessMask = this->currentAccess;
+        barrier.dstAccessMask = access;
 
-        VkPipelineStageFlags sourceStage;
-        VkPipelineStageFlags destinationStage;
-
-        if (this->currentLayout == VK_IMAGE_LAYOUT_UNDEFINED && to == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        } else if (this->currentLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && to == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        } else {
-            CRITICAL("Layout transition from {} to {} is not supported", this->currentLayout, to);
-        }
-
-        vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
         this->currentLayout = to;
+        this->currentStage = stage;
+        this->currentAccess = access;
+
+        return barrier;
     }
 
     void GenerateMipmaps(VkCommandBuffer commandBuffer) {
@@ -218,37 +371,44 @@ public:
             0, nullptr,
             0, nullptr,
             1, &barrier);
+
+        this->currentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        this->currentStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        this->currentAccess = VK_ACCESS_SHADER_READ_BIT;
     }
 
-    VkImageView GetImageView(VkImageAspectFlagBits aspect) {
-        if (this->imageView != nullptr) {
-            return this->imageView;
+    VkImageView GetImageView(VkImageAspectFlags aspect, uint32_t baseMipLevel = 0, uint32_t levelCount = VK_REMAINING_MIP_LEVELS, uint32_t baseArrayLayer = 0, uint32_t layerCount = 1) {
+        if (levelCount == VK_REMAINING_MIP_LEVELS) levelCount = this->mipLevels - baseMipLevel;
+
+        ImageViewKey key{ aspect, baseMipLevel, levelCount, baseArrayLayer, layerCount };
+        for (const auto& [cachedKey, cachedView] : this->imageViews) {
+            if (cachedKey == key) return cachedView;
         }
 
         VkImageViewCreateInfo viewInfo = {};
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         viewInfo.image = this->image;
-        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.viewType = layerCount > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
         viewInfo.format = this->format;
         viewInfo.subresourceRange.aspectMask = aspect;
-        viewInfo.subresourceRange.baseMipLevel = 0;
-        viewInfo.subresourceRange.levelCount = this->mipLevels;
-        viewInfo.subresourceRange.baseArrayLayer = 0;
-        viewInfo.subresourceRange.layerCount = 1;
+        viewInfo.subresourceRange.baseMipLevel = baseMipLevel;
+        viewInfo.subresourceRange.levelCount = levelCount;
+        viewInfo.subresourceRange.baseArrayLayer = baseArrayLayer;
+        viewInfo.subresourceRange.layerCount = layerCount;
 
-        VkResult result = vkCreateImageView(context->device, &viewInfo, nullptr, &this->imageView);
+        VkImageView imageView;
+        VkResult result = vkCreateImageView(context->device, &viewInfo, nullptr, &imageView);
         if (result != VK_SUCCESS) {
             CRITICAL("Image view creation failed with error code: {}", result);
         }
+        this->imageViews.emplace_back(key, imageView);
 
-        return this->imageView;
+        return imageView;
     }
 
-    VkSampler GetSampler(VkFilter magFilter = VK_FILTER_LINEAR, VkFilter minFilter = VK_FILTER_LINEAR, VkSamplerAddressMode wrapU = VK_SAMPLER_ADDRESS_MODE_REPEAT, VkSamplerAddressMode wrapV = VK_SAMPLER_ADDRESS_MODE_REPEAT) {
-        if (this->sampler != nullptr) {
-            return this->sampler;
-        }
-
+    // Samplers are shared through the context's cache, so maxLod is left unclamped rather than tied to this image's mip
+    // count. minLod keeps sampling off the finer mips, for images whose finer mips aren't uploaded yet
+    VkSampler GetSampler(VkFilter magFilter = VK_FILTER_LINEAR, VkFilter minFilter = VK_FILTER_LINEAR, VkSamplerAddressMode wrapU = VK_SAMPLER_ADDRESS_MODE_REPEAT, VkSamplerAddressMode wrapV = VK_SAMPLER_ADDRESS_MODE_REPEAT, float minLod = 0.0f) {
         VkSamplerCreateInfo samplerInfo{};
         samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
         samplerInfo.magFilter = magFilter;
@@ -264,25 +424,23 @@ public:
         samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.mipLodBias = 0.0f;
-        samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = static_cast<float>(this->mipLevels);
-
-        VkResult result = vkCreateSampler(context->device, &samplerInfo, nullptr, &this->sampler);
-        if (result != VK_SUCCESS) {
-            CRITICAL("Sampler creation failed with error code: {}", result);
-        }
+        samplerInfo.minLod = minLod;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
-        return this->sampler;
+        return context->samplerCache.Get(samplerInfo);
     }
 
     void Destroy() {
-        if (this->sampler != nullptr) {
-            vkDestroySampler(context->device, this->sampler, nullptr);
+        for (const auto& [key, imageView] : this->imageViews) {
+            context->descriptorCache.ForgetImageView(imageView);
+            vkDestroyImageView(context->device, imageView, nullptr);
         }
-        if (this->imageView != nullptr) {
-            vkDestroyImageView(context->device, this->imageView, nullptr);
+        this->imageViews.clear();
+        if (this->ownsMemory) {
+            vmaDestroyImage(context->allocator, this->image, this->allocation);
+        } else {
+            vkDestroyImage(context->device, this->image, nullptr);
         }
-        vmaDestroyImage(context->allocator, this->image, this->allocation);
         this->isDestroyed = true;
     }
 
@@ -290,7 +448,43 @@ public:
         if (!this->isDestroyed) this->Destroy();
     }
 private:
-    VkImageView imageView = nullptr;
-    VkSampler sampler = nullptr;
+    struct ImageViewKey {
+        VkImageAspectFlags aspect;
+        uint32_t baseMipLevel;
+        uint32_t levelCount;
+        uint32_t baseArrayLayer;
+        uint32_t layerCount;
+
+        bool operator==(const ImageViewKey& other) const = default;
+    };
+
+    // Images rarely have more than a handful of views, a linear scan beats hashing here
+    std::vector<std::pair<ImageViewKey, VkImageView>> imageViews;
+    bool ownsMemory = true;
     bool isDestroyed = false;
+
+    VkImageCreateInfo SetupCreateInfo(Context *context, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkSampleCountFlagBits samples, uint32_t mipLevels) {
+        this->context = context;
+        this->format = format;
+        this->width = width;
+        this->height = height;
+        this->mipLevels = mipLevels;
+        this->samples = samples;
+
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = this->width;
+        imageInfo.extent.height = this->height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = this->mipLevels;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = this->format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = usage;
+        imageInfo.samples = samples;
+
+        return imageInfo;
+    }
 };
\ No newline at end of file
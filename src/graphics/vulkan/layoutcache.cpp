@@ -0,0 +1,111 @@
+#include "layoutcache.h"
+#include "core/hash.h"
+
+bool DescriptorSetLayoutKey::operator==(const DescriptorSetLayoutKey& other) const {
+    return std::equal(this->bindings.begin(), this->bindings.end(), other.bindings.begin(), other.bindings.end(), [](const auto& a, const auto& b) {
+        return a.binding == b.binding &&
+            a.descriptorType == b.descriptorType &&
+            a.descriptorCount == b.descriptorCount &&
+            a.stageFlags == b.stageFlags;
+    });
+}
+
+size_t DescriptorSetLayoutKeyHash::operator()(const DescriptorSetLayoutKey& key) const {
+    size_t seed = key.bindings.size();
+    for (const auto& binding : key.bindings) {
+        HashCombine(seed, binding.binding);
+        HashCombine(seed, (uint32_t)binding.descriptorType);
+        HashCombine(seed, binding.descriptorCount);
+        HashCombine(seed, binding.stageFlags);
+    }
+    return seed;
+}
+
+bool PipelineLayoutKey::operator==(const PipelineLayoutKey& other) const {
+    return this->setLayouts == other.setLayouts &&
+        std::equal(this->pushConstants.begin(), this->pushConstants.end(), other.pushConstants.begin(), other.pushConstants.end(), [](const auto& a, const auto& b) {
+            return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+        });
+}
+
+size_t PipelineLayoutKeyHash::operator()(const PipelineLayoutKey& key) const {
+    size_t seed = key.setLayouts.size();
+    for (VkDescriptorSetLayout setLayout : key.setLayouts) {
+        HashCombine(seed, setLayout);
+    }
+    for (const auto& range : key.pushConstants) {
+        HashCombine(seed, range.stageFlags);
+        HashCombine(seed, range.offset);
+        HashCombine(seed, range.size);
+    }
+    return seed;
+}
+
+void LayoutCache::Init(VkDevice device) {
+    this->device = device;
+}
+
+void LayoutCache::Destroy() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (auto& [key, layout] : this->pipelineLayouts) {
+        vkDestroyPipelineLayout(this->device, layout, nullptr);
+    }
+    for (auto& [key, layout] : this->setLayouts) {
+        vkDestroyDescriptorSetLayout(this->device, layout, nullptr);
+    }
+    this->pipelineLayouts.clear();
+    this->setLayouts.clear();
+}
+
+VkDescriptorSetLayout LayoutCache::GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+    DescriptorSetLayoutKey key{ bindings };
+    for (auto& binding : key.bindings) binding.pImmutableSamplers = nullptr;
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto it = this->setLayouts.find(key);
+    if (it != this->setLayouts.end()) {
+        return it->second;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = key.bindings.size();
+    layoutInfo.pBindings = key.bindings.data();
+
+    VkDescriptorSetLayout layout;
+    VkResult result = vkCreateDescriptorSetLayout(this->device, &layoutInfo, nullptr, &layout);
+    if (result != VK_SUCCESS) {
+        CRITICAL("Descriptor set layout creation failed with error code: {}", result);
+    }
+    this->setLayouts.emplace(std::move(key), layout);
+    DEBUG("Created descriptor set layout #{} with {} bindings", this->setLayouts.size(), bindings.size());
+
+    return layout;
+}
+
+VkPipelineLayout LayoutCache::GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants) {
+    PipelineLayoutKey key{ setLayouts, pushConstants };
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto it = this->pipelineLayouts.find(key);
+    if (it != this->pipelineLayouts.end()) {
+        return it->second;
+    }
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = setLayouts.size();
+    layoutInfo.pSetLayouts = setLayouts.data();
+    layoutInfo.pushConstantRangeCount = pushConstants.size();
+    layoutInfo.pPushConstantRanges = pushConstants.data();
+
+    VkPipelineLayout layout;
+    VkResult result = vkCreatePipelineLayout(this->device, &layoutInfo, nullptr, &layout);
+    if (result != VK_SUCCESS) {
+        CRITICAL("Vulkan pipeline layout creation failed with error code: {}", result);
+    }
+    this->pipelineLayouts.emplace(std::move(key), layout);
+    DEBUG("Created pipeline layout #{} with {} sets and {} push constant ranges", this->pipelineLayouts.size(), setLayouts.size(), pushConstants.size());
+
+    return layout;
+}
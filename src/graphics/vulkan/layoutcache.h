@@ -0,0 +1,45 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+#include "mutex"
+
+struct DescriptorSetLayoutKey {
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+    bool operator==(const DescriptorSetLayoutKey& other) const;
+};
+
+struct DescriptorSetLayoutKeyHash {
+    size_t operator()(const DescriptorSetLayoutKey& key) const;
+};
+
+struct PipelineLayoutKey {
+    std::vector<VkDescriptorSetLayout> setLayouts;
+    std::vector<VkPushConstantRange> pushConstants;
+
+    bool operator==(const PipelineLayoutKey& other) const;
+};
+
+struct PipelineLayoutKeyHash {
+    size_t operator()(const PipelineLayoutKey& key) const;
+};
+
+// Pipelines built from the same reflected interface share their layouts, which also keeps their descriptor sets
+// compatible with each other. Layouts live until the context is destroyed
+class LayoutCache {
+public:
+    void Init(VkDevice device);
+    void Destroy();
+
+    // Bindings must be sorted by binding number, immutable samplers aren't supported
+    VkDescriptorSetLayout GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+    VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants);
+
+    size_t Size() const { return this->setLayouts.size() + this->pipelineLayouts.size(); }
+private:
+    VkDevice device{};
+    std::mutex mutex;
+    std::unordered_map<DescriptorSetLayoutKey, VkDescriptorSetLayout, DescriptorSetLayoutKeyHash> setLayouts;
+    std::unordered_map<PipelineLayoutKey, VkPipelineLayout, PipelineLayoutKeyHash> pipelineLayouts;
+};
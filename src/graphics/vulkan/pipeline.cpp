@@ -57,79 +57,103 @@ PipelineBuilder PipelineBuilder::SetResolveLayout(VkImageLayout layout)
 }
 
 Pipeline* PipelineBuilder::Build() {
+    this->Validate();
+    this->CreateLayoutAndRenderPass();
+    this->CreatePipeline();
+    return pipeline;
+}
+
+Pipeline* PipelineBuilder::BuildAsync(JobSystem& jobs, Pipeline* fallback) {
+    this->Validate();
+    this->CreateLayoutAndRenderPass();
+    pipeline->fallback = fallback;
+    pipeline->ready.store(false, std::memory_order_relaxed);
+    std::shared_ptr<std::atomic<bool>> compiled = std::make_shared<std::atomic<bool>>(false);
+    pipeline->compiled = compiled;
+
+    // The caller's shaders usually go out of scope before the job runs, the job keeps its own copies of the modules
+    auto shaderCopies = std::make_shared<std::unordered_map<ShaderType, Shader>>();
+    for (auto& [type, shader] : this->shaders) {
+        shaderCopies->emplace(type, *shader);
+    }
+
+    PipelineBuilder builder = *this;
+    jobs.Submit([builder, shaderCopies, compiled](uint32_t) mutable {
+        PROFILE_SCOPE("Compile pipeline");
+        for (auto& [type, shader] : *shaderCopies) {
+            builder.shaders[type] = &shader;
+        }
+        try {
+            builder.CreatePipeline();
+        }
+        catch (const std::exception&) {
+            // Already logged, draws keep using the fallback
+            for (auto& [type, shader] : *shaderCopies) shader.Destroy();
+        }
+        // Last touch of the pipeline from this thread, Destroy may free it as soon as compiled is set
+        builder.pipeline->ready.store(true, std::memory_order_release);
+        compiled->store(true, std::memory_order_release);
+        compiled->notify_all();
+    });
+
+    return pipeline;
+}
+
+void PipelineBuilder::Validate() {
     if (!this->shaders[VERTEX]) {
         CRITICAL("Pipeline missing vertex shader");
     }
     if (!this->shaders[FRAGMENT]) {
         CRITICAL("Pipeline missing fragment shader");
     }
-    VkPipelineShaderStageCreateInfo shaderStages[2] = { this->shaders[VERTEX]->GetStageInfo(), this->shaders[FRAGMENT]->GetStageInfo() };
-
-    auto bindingDescription = Vertex::GetBindingDescription();
-    auto attributeDescriptions = Vertex::GetAttributeDescriptions();
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputInfo.vertexAttributeDescriptionCount = attributeDescriptions.size();
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-    VkPipelineViewportStateCreateInfo viewportState{};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.pViewports = &pipeline->viewport;
-    viewportState.scissorCount = 1;
-    viewportState.pScissors = &pipeline->scissor;
-
-    VkPipelineRasterizationStateCreateInfo rasterizer{};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
-
-    VkPipelineMultisampleStateCreateInfo multisampling{};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = pipeline->msaaSamples;
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-
-    VkPipelineColorBlendStateCreateInfo colorBlending{};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
+}
 
-    VkPipelineDepthStencilStateCreateInfo depthStencil{};
-    if (this->depthTesting) {
-        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-        depthStencil.depthTestEnable = VK_TRUE;
-        depthStencil.depthWriteEnable = VK_TRUE;
-        depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-        depthStencil.depthBoundsTestEnable = VK_FALSE;
-        depthStencil.depthBoundsTestEnable = VK_FALSE;
-        depthStencil.stencilTestEnable = VK_FALSE;
+void PipelineBuilder::CreateLayout() {
+    // Bindings and push constants seen by several stages are merged into one entry visible to all of them
+    std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> sets;
+    std::vector<VkPushConstantRange> pushConstants;
+    for (auto& [type, shader] : this->shaders) {
+        for (const auto& [set, bindings] : shader->reflection.sets) {
+            auto& merged = sets[set];
+            for (const auto& binding : bindings) {
+                auto it = std::find_if(merged.begin(), merged.end(), [&](const auto& other) { return other.binding == binding.binding; });
+                if (it == merged.end()) {
+                    merged.push_back(binding);
+                    continue;
+                }
+                if (it->descriptorType != binding.descriptorType || it->descriptorCount != binding.descriptorCount) {
+                    CRITICAL("Shader stages disagree on the type of set {} binding {}", set, binding.binding);
+                }
+                it->stageFlags |= binding.stageFlags;
+            }
+            std::sort(merged.begin(), merged.end(), [](const auto& a, const auto& b) { return a.binding < b.binding; });
+        }
+        for (const auto& range : shader->reflection.pushConstants) {
+            auto it = std::find_if(pushConstants.begin(), pushConstants.end(), [&](const auto& other) { return other.offset == range.offset && other.size == range.size; });
+            if (it == pushConstants.end()) pushConstants.push_back(range);
+            else it->stageFlags |= range.stageFlags;
+        }
     }
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 0;
-
-    VkResult layoutResult = vkCreatePipelineLayout(context->device, &pipelineLayoutInfo, nullptr, &pipeline->layout);
-    if (layoutResult != VK_SUCCESS) {
-        CRITICAL("Vulkan pipeline layout creation failed with error code: {}", layoutResult);
+    // Set numbers are positions in the layout, so gaps get an empty set layout
+    uint32_t setCount = sets.empty() ? 0 : sets.rbegin()->first + 1;
+    pipeline->setLayouts.resize(setCount);
+    for (uint32_t set = 0; set < setCount; set++) {
+        auto it = sets.find(set);
+        // An unsized array can only be the bindless table, its layout needs flags reflection can't express
+        bool bindless = it != sets.end() && std::any_of(it->second.begin(), it->second.end(), [](const auto& binding) { return binding.descriptorCount == 0; });
+        if (bindless) {
+            pipeline->setLayouts[set] = context->bindless.GetLayout();
+            pipeline->bindlessSet = set;
+            continue;
+        }
+        pipeline->setLayouts[set] = context->layoutCache.GetDescriptorSetLayout(it != sets.end() ? it->second : std::vector<VkDescriptorSetLayoutBinding>{});
     }
+    pipeline->layout = context->layoutCache.GetPipelineLayout(pipeline->setLayouts, pushConstants);
+}
+
+void PipelineBuilder::CreateLayoutAndRenderPass() {
+    this->CreateLayout();
 
     VkSubpassDescription subpass{};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
@@ -148,7 +172,10 @@ Pipeline* PipelineBuilder::Build() {
     colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
     attachments.push_back(colorAttachment);
 
+    // Referenced by the subpass until the render pass is created, so they can't live inside the branches below
     VkAttachmentReference colorAttachmentRef{};
+    VkAttachmentReference depthAttachmentRef{};
+    VkAttachmentReference colorAttachmentResolveRef{};
     colorAttachmentRef.attachment = 0;
     colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
     subpass.pColorAttachments = &colorAttachmentRef;
@@ -165,7 +192,6 @@ Pipeline* PipelineBuilder::Build() {
         depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
         attachments.push_back(depthAttachment);
 
-        VkAttachmentReference depthAttachmentRef{};
         depthAttachmentRef.attachment = 1;
         depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
         subpass.pDepthStencilAttachment = &depthAttachmentRef;
@@ -183,23 +209,109 @@ Pipeline* PipelineBuilder::Build() {
         colorAttachmentResolve.finalLayout = pipeline->imageLayout;
         attachments.push_back(colorAttachmentResolve);
 
-        VkAttachmentReference colorAttachmentResolveRef{};
         colorAttachmentResolveRef.attachment = 2;
         colorAttachmentResolveRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
         subpass.pResolveAttachments = &colorAttachmentResolveRef;
     }
 
+    // Attachments are shared between frames in flight and the swapchain image is only guaranteed to be acquired by the
+    // colour output stage, so the initial layout transitions have to wait for earlier attachment writes
+    VkSubpassDependency dependency{};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
     renderPassInfo.attachmentCount = attachments.size();
     renderPassInfo.pAttachments = attachments.data();
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 1;
+    renderPassInfo.pDependencies = &dependency;
 
     VkResult renderPassResult = vkCreateRenderPass(context->device, &renderPassInfo, nullptr, &pipeline->renderPass);
     if (renderPassResult != VK_SUCCESS) {
         CRITICAL("Vulkan render pass creation failed with error code: {}", renderPassResult);
     }
+}
+
+void PipelineBuilder::CreatePipeline() {
+    VkPipelineShaderStageCreateInfo shaderStages[2] = { this->shaders[VERTEX]->GetStageInfo(), this->shaders[FRAGMENT]->GetStageInfo() };
+
+    // Only the attributes the vertex shader actually reads, every one it reads has to exist in Vertex or InstanceData
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions = { Vertex::GetBindingDescription() };
+    std::vector<VkVertexInputAttributeDescription> available;
+    for (const auto& attribute : Vertex::GetAttributeDescriptions()) available.push_back(attribute);
+    for (const auto& attribute : InstanceData::GetAttributeDescriptions()) available.push_back(attribute);
+
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+    for (uint32_t location : this->shaders[VERTEX]->reflection.inputLocations) {
+        auto it = std::find_if(available.begin(), available.end(), [&](const auto& attribute) { return attribute.location == location; });
+        if (it == available.end()) {
+            CRITICAL("Vertex shader reads input location {} which neither Vertex nor InstanceData provide", location);
+        }
+        attributeDescriptions.push_back(*it);
+    }
+    bool instanced = std::any_of(attributeDescriptions.begin(), attributeDescriptions.end(), [](const auto& attribute) { return attribute.binding == 1; });
+    if (instanced) bindingDescriptions.push_back(InstanceData::GetBindingDescription());
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = bindingDescriptions.size();
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = attributeDescriptions.size();
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.pViewports = &pipeline->viewport;
+    viewportState.scissorCount = 1;
+    viewportState.pScissors = &pipeline->scissor;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = pipeline->msaaSamples;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    if (this->depthTesting) {
+        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencil.depthTestEnable = VK_TRUE;
+        depthStencil.depthWriteEnable = VK_TRUE;
+        depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+        depthStencil.depthBoundsTestEnable = VK_FALSE;
+        depthStencil.depthBoundsTestEnable = VK_FALSE;
+        depthStencil.stencilTestEnable = VK_FALSE;
+    }
 
     std::vector<VkDynamicState> dynamicState;
     if (this->usingDynamicViewports) {
@@ -227,20 +339,23 @@ Pipeline* PipelineBuilder::Build() {
     pipelineInfo.renderPass = pipeline->renderPass;
     pipelineInfo.subpass = 0;
 
-    VkResult pipelineResult = vkCreateGraphicsPipelines(context->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline->pipeline);
+    VkResult pipelineResult = vkCreateGraphicsPipelines(context->device, context->pipelineCache.Get(), 1, &pipelineInfo, nullptr, &pipeline->pipeline);
     if (pipelineResult != VK_SUCCESS) {
         CRITICAL("Vulkan pipeline creation failed with error code: {}", pipelineResult);
     }
 
     for (auto& shader : this->shaders) shader.second->Destroy();
+}
 
-    return pipeline;
+VkPipeline Pipeline::GetHandle() const {
+    if (this->IsReady() && this->pipeline) return this->pipeline;
+    return this->fallback ? this->fallback->GetHandle() : VK_NULL_HANDLE;
 }
 
 void Pipeline::Destroy() {
+    if (this->compiled) this->compiled->wait(false, std::memory_order_acquire);
     vkDestroyPipeline(context->device, this->pipeline, nullptr);
     vkDestroyRenderPass(context->device, this->renderPass, nullptr);
-    vkDestroyPipelineLayout(context->device, this->layout, nullptr);
 
     delete this;
 }
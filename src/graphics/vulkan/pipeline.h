@@ -3,6 +3,8 @@
 #include "vulkan/vulkan.h"
 
 #include "core/core.h"
+#include "core/jobsystem.h"
+#include "atomic"
 
 #include "shader.h"
 #include "image.h"
@@ -13,15 +15,32 @@ struct Pipeline {
 
 	Context* context;
 
-	VkPipeline pipeline;
-	VkRenderPass renderPass;
-	VkPipelineLayout layout;
+	VkPipeline pipeline{};
+	VkRenderPass renderPass{};
+	// Owned by the context's layout cache and shared with every pipeline that has the same interface
+	VkPipelineLayout layout{};
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	// Set the context's bindless table goes in, UINT32_MAX if the shaders don't use it
+	uint32_t bindlessSet = UINT32_MAX;
 	VkImageLayout imageLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	VkViewport viewport{};
 	VkRect2D scissor{};
 	VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
 
+	// Pipelines built asynchronously have their render pass and layout straight away, the VkPipeline is published
+	// through ready once a worker has compiled it
+	std::atomic<bool> ready = true;
+	// What Destroy sleeps on until the compile is done. Shared with the job, which notifies after Destroy may have freed
+	// the pipeline
+	std::shared_ptr<std::atomic<bool>> compiled;
+	// Drawn with instead while this one compiles or if it failed to, must use a compatible render pass
+	Pipeline* fallback = nullptr;
+
+	// Null while neither this nor the fallback can be drawn with, callers skip their draws then
+	VkPipeline GetHandle() const;
+	bool IsReady() const { return this->ready.load(std::memory_order_acquire); }
+	// Waits for a pending compile first
 	void Destroy();
 };
 
@@ -37,7 +56,14 @@ public:
 	PipelineBuilder SetResolveLayout(VkImageLayout layout);
 
 	Pipeline* Build();
+	// Returns immediately, the pipeline is compiled on the workers and swapped in once done
+	Pipeline* BuildAsync(JobSystem& jobs, Pipeline* fallback = nullptr);
 private:
+	void Validate();
+	void CreateLayout();
+	void CreateLayoutAndRenderPass();
+	void CreatePipeline();
+
 	Context* context;
 	Pipeline* pipeline = new Pipeline();
 
@@ -0,0 +1,124 @@
+#include "pipelinecache.h"
+#include "core/hash.h"
+
+#include "filesystem"
+
+void PipelineCache::Init(VkDevice device, const VkPhysicalDeviceProperties& properties, const std::string& filePath) {
+    this->device = device;
+    this->properties = properties;
+    this->filePath = filePath;
+
+    std::vector<char> data = this->Load();
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    VkResult result = vkCreatePipelineCache(device, &cacheInfo, nullptr, &this->cache);
+    if (result != VK_SUCCESS && !data.empty()) {
+        // The driver gets the final say on whether the data is usable
+        WARN("Pipeline cache data was rejected with error code: {}, starting empty", result);
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        result = vkCreatePipelineCache(device, &cacheInfo, nullptr, &this->cache);
+    }
+    if (result != VK_SUCCESS) {
+        CRITICAL("Pipeline cache creation failed with error code: {}", result);
+    }
+}
+
+void PipelineCache::Destroy() {
+    if (!this->cache) return;
+    this->Save();
+    vkDestroyPipelineCache(this->device, this->cache, nullptr);
+    this->cache = VK_NULL_HANDLE;
+}
+
+PipelineCache::FileHeader PipelineCache::MakeHeader() const {
+    FileHeader header{};
+    header.magic = magic;
+    header.version = version;
+    header.vendorID = this->properties.vendorID;
+    header.deviceID = this->properties.deviceID;
+    header.driverVersion = this->properties.driverVersion;
+    memcpy(header.pipelineCacheUUID, this->properties.pipelineCacheUUID, VK_UUID_SIZE);
+    return header;
+}
+
+std::vector<char> PipelineCache::Load() {
+    std::ifstream file(this->filePath, std::ios::binary);
+    if (!file.is_open()) {
+        INFO("No pipeline cache at {}, starting empty", this->filePath);
+        return {};
+    }
+
+    FileHeader header{};
+    FileHeader expected = this->MakeHeader();
+    file.read((char*)&header, sizeof(header));
+    if (!file || header.magic != expected.magic || header.version != expected.version) {
+        WARN("{} isn't a pipeline cache, ignoring it", this->filePath);
+        return {};
+    }
+    if (header.vendorID != expected.vendorID || header.deviceID != expected.deviceID || header.driverVersion != expected.driverVersion ||
+        memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        INFO("Pipeline cache was written by a different device or driver, ignoring it");
+        return {};
+    }
+
+    // A truncated or damaged size would otherwise be allocated as is
+    std::streamoff dataStart = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff remaining = file.tellg() - dataStart;
+    file.seekg(dataStart);
+    if (!file || remaining < 0 || header.dataSize != (uint64_t)remaining) {
+        WARN("Pipeline cache at {} is corrupt, ignoring it", this->filePath);
+        return {};
+    }
+
+    std::vector<char> data(header.dataSize);
+    file.read(data.data(), data.size());
+    if (!file || HashBytes(data.data(), data.size()) != header.dataHash) {
+        WARN("Pipeline cache at {} is corrupt, ignoring it", this->filePath);
+        return {};
+    }
+
+    INFO("Loaded {} bytes of pipeline cache from {}", data.size(), this->filePath);
+    return data;
+}
+
+void PipelineCache::Save() {
+    size_t size = 0;
+    vkGetPipelineCacheData(this->device, this->cache, &size, nullptr);
+    std::vector<char> data(size);
+    VkResult result = vkGetPipelineCacheData(this->device, this->cache, &size, data.data());
+    if (result != VK_SUCCESS) {
+        WARN("Couldn't read back the pipeline cache, error code: {}", result);
+        return;
+    }
+    data.resize(size);
+
+    FileHeader header = this->MakeHeader();
+    header.dataSize = data.size();
+    header.dataHash = HashBytes(data.data(), data.size());
+
+    // Written next to the real file and moved over it, so a crash mid-write never leaves a half written cache behind
+    std::string tempPath = this->filePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            WARN("Couldn't open {} to save the pipeline cache", tempPath);
+            return;
+        }
+        file.write((const char*)&header, sizeof(header));
+        file.write(data.data(), data.size());
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, this->filePath, error);
+    if (error) {
+        WARN("Couldn't replace {}: {}", this->filePath, error.message());
+        return;
+    }
+    INFO("Saved {} bytes of pipeline cache to {}", data.size(), this->filePath);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+
+// Driver pipeline cache persisted between runs. The file is only trusted if it was written by the same device and
+// driver and hasn't been truncated, anything else starts from an empty cache
+class PipelineCache {
+public:
+    void Init(VkDevice device, const VkPhysicalDeviceProperties& properties, const std::string& filePath);
+    // Saves the cache back to disk before destroying it
+    void Destroy();
+
+    void Save();
+    VkPipelineCache Get() const { return this->cache; }
+private:
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    static constexpr uint32_t magic = 0x43505246; // "FRPC"
+    static constexpr uint32_t version = 1;
+
+    std::vector<char> Load();
+    FileHeader MakeHeader() const;
+
+    VkDevice device{};
+    VkPhysicalDeviceProperties properties{};
+    std::string filePath;
+    VkPipelineCache cache{};
+};
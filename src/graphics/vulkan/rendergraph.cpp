@@ -0,0 +1,389 @@
+#include "rendergraph.h"
+#include "context.h"
+#include "image.h"
+
+void RenderPassBuilder::Read(RenderGraphResource resource, ResourceUsage usage) {
+    this->graph->accesses.push_back({ resource, usage, false, VK_IMAGE_LAYOUT_UNDEFINED });
+    this->graph->passes[this->pass].accessCount++;
+}
+
+void RenderPassBuilder::Write(RenderGraphResource resource, ResourceUsage usage, VkImageLayout finalLayout) {
+    this->graph->accesses.push_back({ resource, usage, true, finalLayout });
+    this->graph->passes[this->pass].accessCount++;
+}
+
+void RenderPassBuilder::SetSideEffects() {
+    this->graph->passes[this->pass].sideEffects = true;
+}
+
+RenderGraph::RenderGraph(Context* context) : context(context) {}
+
+RenderGraph::~RenderGraph() {
+    this->Destroy();
+}
+
+RenderGraphResource RenderGraph::CreateImage(const std::string& name, const TransientImageDesc& desc) {
+    Resource resource{};
+    resource.name = name;
+    resource.transient = true;
+    resource.desc = desc;
+    resource.image = nullptr;
+    this->resources.push_back(resource);
+    return (RenderGraphResource)(this->resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::ImportImage(const std::string& name, Image* image) {
+    Resource resource{};
+    resource.name = name;
+    resource.transient = false;
+    resource.image = image;
+    this->resources.push_back(resource);
+    return (RenderGraphResource)(this->resources.size() - 1);
+}
+
+void RenderGraph::Export(RenderGraphResource resource, ResourceUsage usage) {
+    this->resources[resource].exported = true;
+    this->resources[resource].exportUsage = usage;
+}
+
+void* RenderGraph::AllocateFrameData(size_t size, size_t alignment) {
+    return this->context->GetFrameArena().Allocate(size, alignment);
+}
+
+uint32_t RenderGraph::BeginPass(const std::string& name, ExecuteFunction execute) {
+    Pass& pass = this->passes.emplace_back();
+    pass.name = name;
+    pass.execute = execute;
+    pass.firstAccess = (uint32_t)this->accesses.size();
+    return (uint32_t)(this->passes.size() - 1);
+}
+
+void RenderGraph::GetUsageState(ResourceUsage usage, VkImageLayout& layout, VkPipelineStageFlags& stage, VkAccessFlags& access) {
+    switch (usage) {
+    case ResourceUsage::ColorAttachment:
+    case ResourceUsage::ResolveAttachment:
+        layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        break;
+    case ResourceUsage::DepthAttachment:
+        layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        break;
+    case ResourceUsage::Sampled:
+        layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        break;
+    case ResourceUsage::TransferSrc:
+        layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        break;
+    case ResourceUsage::TransferDst:
+        layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        break;
+    case ResourceUsage::Present:
+        layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        break;
+    }
+    Image::GetLayoutUsage(layout, stage, access);
+}
+
+void RenderGraph::Compile() {
+    ScratchScope scratch;
+    // Walk backwards from the exported resources, a pass survives if something downstream needs what it writes
+    std::pmr::vector<bool> needed(this->resources.size(), false, scratch.Get());
+    for (uint32_t i = 0; i < this->resources.size(); i++) {
+        needed[i] = this->resources[i].exported;
+    }
+
+    this->culledPasses = 0;
+    for (int64_t i = (int64_t)this->passes.size() - 1; i >= 0; i--) {
+        Pass& pass = this->passes[i];
+        bool contributes = pass.sideEffects;
+        for (const auto& access : this->GetAccesses(pass)) {
+            if (access.write && needed[access.resource]) contributes = true;
+        }
+
+        pass.culled = !contributes;
+        if (pass.culled) {
+            this->culledPasses++;
+            continue;
+        }
+
+        for (const auto& access : this->GetAccesses(pass)) {
+            needed[access.resource] = true;
+        }
+    }
+
+    std::pmr::vector<TransientLifetime> lifetimes(scratch.Get());
+    for (uint32_t i = 0; i < this->passes.size(); i++) {
+        if (this->passes[i].culled) continue;
+        for (const auto& access : this->GetAccesses(this->passes[i])) {
+            Resource& resource = this->resources[access.resource];
+            resource.firstPass = std::min(resource.firstPass, i);
+            resource.lastPass = std::max(resource.lastPass, i);
+        }
+    }
+    for (auto& resource : this->resources) {
+        if (!resource.transient || resource.firstPass == UINT32_MAX) continue;
+        resource.transientIndex = (uint32_t)lifetimes.size();
+        lifetimes.push_back({ resource.desc, resource.firstPass, resource.lastPass });
+    }
+
+    if (!std::equal(lifetimes.begin(), lifetimes.end(), this->transientLifetimes.begin(), this->transientLifetimes.end())) {
+        this->AllocateTransients(lifetimes);
+    }
+
+    for (auto& resource : this->resources) {
+        if (resource.transientIndex != UINT32_MAX) {
+            resource.image = this->transientImages[resource.transientIndex].get();
+        }
+    }
+}
+
+void RenderGraph::AllocateTransients(std::span<const TransientLifetime> lifetimes) {
+    // Only happens when the frame's shape changes (e.g. the viewport is resized), so a full idle is acceptable
+    vkDeviceWaitIdle(this->context->device);
+    this->FreeTransients();
+    this->InvalidateFramebuffers();
+
+    this->transientLifetimes.assign(lifetimes.begin(), lifetimes.end());
+    this->transientImages.resize(lifetimes.size());
+    this->transientSlots.resize(lifetimes.size());
+
+    std::vector<VkMemoryRequirements> requirements(lifetimes.size());
+    for (uint32_t i = 0; i < lifetimes.size(); i++) {
+        const TransientImageDesc& desc = lifetimes[i].desc;
+        this->transientImages[i] = std::make_unique<Image>();
+        this->transientImages[i]->InitUnbound(this->context, desc.width, desc.height, desc.format, desc.usage, desc.samples);
+        vkGetImageMemoryRequirements(this->context->device, this->transientImages[i]->image, &requirements[i]);
+    }
+
+    // Largest first, each image goes into the first slot whose occupants are all dead or not yet alive while it's in use
+    std::vector<uint32_t> order(lifetimes.size());
+    for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&requirements](uint32_t a, uint32_t b) {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    for (uint32_t index : order) {
+        const TransientLifetime& lifetime = lifetimes[index];
+        uint32_t chosen = UINT32_MAX;
+        for (uint32_t s = 0; s < this->slots.size() && chosen == UINT32_MAX; s++) {
+            MemorySlot& slot = this->slots[s];
+            if (!(slot.requirements.memoryTypeBits & requirements[index].memoryTypeBits)) continue;
+
+            bool overlaps = false;
+            for (const auto& [first, last] : slot.lifetimes) {
+                if (lifetime.firstPass <= last && first <= lifetime.lastPass) overlaps = true;
+            }
+            if (!overlaps) chosen = s;
+        }
+
+        if (chosen == UINT32_MAX) {
+            this->slots.push_back({});
+            chosen = (uint32_t)(this->slots.size() - 1);
+            this->slots[chosen].requirements = requirements[index];
+        } else {
+            VkMemoryRequirements& slotRequirements = this->slots[chosen].requirements;
+            slotRequirements.size = std::max(slotRequirements.size, requirements[index].size);
+            slotRequirements.alignment = std::max(slotRequirements.alignment, requirements[index].alignment);
+            slotRequirements.memoryTypeBits &= requirements[index].memoryTypeBits;
+        }
+        this->slots[chosen].lifetimes.emplace_back(lifetime.firstPass, lifetime.lastPass);
+        this->transientSlots[index] = chosen;
+    }
+
+    VmaAllocationCreateInfo allocInfo{};
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    for (auto& slot : this->slots) {
+        VkResult result = vmaAllocateMemory(this->context->allocator, &slot.requirements, &allocInfo, &slot.allocation, nullptr);
+        if (result != VK_SUCCESS) {
+            CRITICAL("Transient memory allocation failed with error code: {}", result);
+        }
+    }
+
+    for (uint32_t i = 0; i < this->transientImages.size(); i++) {
+        VkResult result = vmaBindImageMemory(this->context->allocator, this->slots[this->transientSlots[i]].allocation, this->transientImages[i]->image);
+        if (result != VK_SUCCESS) {
+            CRITICAL("Binding transient image memory failed with error code: {}", result);
+        }
+    }
+
+    DEBUG("Render graph placed {} transient images in {} allocations ({} bytes)", this->transientImages.size(), this->slots.size(), this->GetTransientMemorySize());
+}
+
+void RenderGraph::FreeTransients() {
+    for (auto& image : this->transientImages) {
+        image->Destroy();
+    }
+    this->transientImages.clear();
+    this->transientSlots.clear();
+    for (auto& slot : this->slots) {
+        vmaFreeMemory(this->context->allocator, slot.allocation);
+    }
+    this->slots.clear();
+    this->transientLifetimes.clear();
+}
+
+void RenderGraph::Execute(VkCommandBuffer commandBuffer) {
+    this->barrierBatches = 0;
+    ScratchScope scratch;
+    std::pmr::vector<VkImageMemoryBarrier> barriers(scratch.Get());
+    barriers.reserve(this->accesses.size() + this->resources.size());
+
+    auto flush = [this, commandBuffer, &barriers](VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage) {
+        if (barriers.empty()) return;
+        vkCmdPipelineBarrier(commandBuffer, srcStage ? srcStage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0, 0, nullptr, 0, nullptr, (uint32_t)barriers.size(), barriers.data());
+        barriers.clear();
+        this->barrierBatches++;
+    };
+
+    for (uint32_t i = 0; i < this->passes.size(); i++) {
+        Pass& pass = this->passes[i];
+        if (pass.culled) continue;
+        PROFILE_SCOPE("Execute pass");
+        PROFILE_GPU_SCOPE(this->context, commandBuffer, pass.name);
+        uint32_t statisticsQuery = this->context->pipelineStatistics.BeginPass(commandBuffer, pass.name);
+
+        // Every transition the pass needs goes into a single barrier call
+        VkPipelineStageFlags srcStage = 0;
+        VkPipelineStageFlags dstStage = 0;
+        for (const auto& access : this->GetAccesses(pass)) {
+            Resource& resource = this->resources[access.resource];
+            Image* image = resource.image;
+
+            VkImageLayout layout;
+            VkPipelineStageFlags stage;
+            VkAccessFlags accessMask;
+            GetUsageState(access.usage, layout, stage, accessMask);
+
+            if (resource.transient && resource.firstPass == i) {
+                // Contents of transients are never carried over, wait on whoever used the memory last instead
+                MemorySlot& slot = this->slots[this->transientSlots[resource.transientIndex]];
+                image->currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                image->currentStage = slot.lastStage;
+                image->currentAccess = slot.lastAccess;
+            }
+
+            const VkAccessFlags writeAccesses = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+            bool hazard = access.write || image->currentLayout != layout || (image->currentAccess & writeAccesses);
+            if (!hazard) {
+                // Read after read in the same layout, later writers just need to wait on this stage as well
+                image->currentStage |= stage;
+                image->currentAccess |= accessMask;
+                continue;
+            }
+
+            srcStage |= image->currentStage;
+            dstStage |= stage;
+            barriers.push_back(image->GetBarrier(layout, stage, accessMask));
+        }
+        flush(srcStage, dstStage);
+
+        pass.execute.invoke(pass.execute.object, commandBuffer);
+        this->context->pipelineStatistics.EndPass(commandBuffer, statisticsQuery);
+
+        for (const auto& access : this->GetAccesses(pass)) {
+            Resource& resource = this->resources[access.resource];
+            if (access.write && access.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED) {
+                resource.image->currentLayout = access.finalLayout;
+            }
+            if (resource.transient && resource.lastPass == i) {
+                MemorySlot& slot = this->slots[this->transientSlots[resource.transientIndex]];
+                slot.lastStage = resource.image->currentStage;
+                slot.lastAccess = resource.image->currentAccess;
+            }
+        }
+    }
+
+    VkPipelineStageFlags srcStage = 0;
+    VkPipelineStageFlags dstStage = 0;
+    for (auto& resource : this->resources) {
+        if (!resource.exported || resource.image == nullptr) continue;
+
+        VkImageLayout layout;
+        VkPipelineStageFlags stage;
+        VkAccessFlags accessMask;
+        GetUsageState(resource.exportUsage, layout, stage, accessMask);
+
+        srcStage |= resource.image->currentStage;
+        dstStage |= stage;
+        barriers.push_back(resource.image->GetBarrier(layout, stage, accessMask));
+    }
+    flush(srcStage, dstStage);
+    this->ReleaseCallbacks();
+}
+
+void RenderGraph::ReleaseCallbacks() {
+    for (auto& pass : this->passes) {
+        if (!pass.execute.object) continue;
+        pass.execute.destroy(pass.execute.object);
+        pass.execute.object = nullptr;
+    }
+}
+
+void RenderGraph::Reset() {
+    this->ReleaseCallbacks();
+    this->passes.clear();
+    this->accesses.clear();
+    this->resources.clear();
+}
+
+void RenderGraph::Destroy() {
+    this->Reset();
+    if (this->transientImages.empty() && this->framebuffers.empty()) return;
+
+    vkDeviceWaitIdle(this->context->device);
+    this->InvalidateFramebuffers();
+    this->FreeTransients();
+}
+
+Image* RenderGraph::GetImage(RenderGraphResource resource) {
+    return this->resources[resource].image;
+}
+
+VkFramebuffer RenderGraph::GetFramebuffer(VkRenderPass renderPass, std::initializer_list<RenderGraphResource> attachments) {
+    ScratchScope scratch;
+    std::pmr::vector<VkImageView> views(scratch.Get());
+    views.reserve(attachments.size());
+    uint32_t width = 0, height = 0;
+    for (RenderGraphResource attachment : attachments) {
+        Image* image = this->resources[attachment].image;
+        views.push_back(image->GetImageView(image->GetAspect()));
+        width = image->width;
+        height = image->height;
+    }
+
+    for (const auto& cached : this->framebuffers) {
+        if (cached.renderPass == renderPass && std::equal(views.begin(), views.end(), cached.attachments.begin(), cached.attachments.end())) return cached.framebuffer;
+    }
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.width = width;
+    framebufferInfo.height = height;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = (uint32_t)views.size();
+    framebufferInfo.pAttachments = views.data();
+    framebufferInfo.layers = 1;
+
+    VkFramebuffer framebuffer;
+    VkResult framebufferResult = vkCreateFramebuffer(this->context->device, &framebufferInfo, nullptr, &framebuffer);
+    if (framebufferResult != VK_SUCCESS) {
+        CRITICAL("Framebuffer creation failed with error code: {}", framebufferResult);
+    }
+    this->framebuffers.push_back({ renderPass, { views.begin(), views.end() }, framebuffer });
+
+    return framebuffer;
+}
+
+void RenderGraph::InvalidateFramebuffers() {
+    for (const auto& cached : this->framebuffers) {
+        vkDestroyFramebuffer(this->context->device, cached.framebuffer, nullptr);
+    }
+    this->framebuffers.clear();
+}
+
+VkDeviceSize RenderGraph::GetTransientMemorySize() const {
+    VkDeviceSize size = 0;
+    for (const auto& slot : this->slots) {
+        size += slot.requirements.size;
+    }
+    return size;
+}
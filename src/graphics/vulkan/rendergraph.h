@@ -0,0 +1,175 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+#include "vma.h"
+#include "core/arena.h"
+#include "span"
+
+struct Context;
+class Image;
+
+enum class ResourceUsage {
+    ColorAttachment,
+    DepthAttachment,
+    ResolveAttachment,
+    Sampled,
+    TransferSrc,
+    TransferDst,
+    Present
+};
+
+struct TransientImageDesc {
+    uint32_t width;
+    uint32_t height;
+    VkFormat format;
+    VkImageUsageFlags usage;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+    bool operator==(const TransientImageDesc& other) const = default;
+};
+
+typedef uint32_t RenderGraphResource;
+
+class RenderGraph;
+
+class RenderPassBuilder {
+public:
+    void Read(RenderGraphResource resource, ResourceUsage usage);
+    // finalLayout is the layout the pass leaves the image in, for render passes that transition attachments themselves
+    void Write(RenderGraphResource resource, ResourceUsage usage, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+    // Passes with side effects (presenting, readbacks) are never culled
+    void SetSideEffects();
+private:
+    friend class RenderGraph;
+    RenderPassBuilder(RenderGraph* graph, uint32_t pass) : graph(graph), pass(pass) {}
+
+    RenderGraph* graph;
+    uint32_t pass;
+};
+
+// Passes are declared in submission order every frame, the graph derives the layout transitions between them, culls
+// passes that don't contribute to an exported resource and places transient images with disjoint lifetimes in the same memory
+class RenderGraph {
+public:
+    RenderGraph(Context* context);
+    ~RenderGraph();
+
+    RenderGraphResource CreateImage(const std::string& name, const TransientImageDesc& desc);
+    RenderGraphResource ImportImage(const std::string& name, Image* image);
+    // Leaves the resource ready for the given usage outside of the graph once executed
+    void Export(RenderGraphResource resource, ResourceUsage usage);
+
+    // setup declares the pass's accesses straight away, execute is kept in the frame arena until the graph has run.
+    // Neither goes through std::function so declaring a pass never touches the heap
+    template<typename Setup, typename Execute>
+    void AddPass(const std::string& name, Setup&& setup, Execute&& execute) {
+        using Callable = std::decay_t<Execute>;
+        void* storage = this->AllocateFrameData(sizeof(Callable), alignof(Callable));
+        ExecuteFunction function{};
+        function.object = new (storage) Callable(std::forward<Execute>(execute));
+        function.invoke = [](void* object, VkCommandBuffer commandBuffer) { (*(Callable*)object)(commandBuffer); };
+        function.destroy = [](void* object) { ((Callable*)object)->~Callable(); };
+
+        RenderPassBuilder builder(this, this->BeginPass(name, function));
+        setup(builder);
+    }
+
+    void Compile();
+    void Execute(VkCommandBuffer commandBuffer);
+    // Clears the declared passes and resources for the next frame, transient memory is kept for reuse
+    void Reset();
+    void Destroy();
+
+    Image* GetImage(RenderGraphResource resource);
+    VkFramebuffer GetFramebuffer(VkRenderPass renderPass, std::initializer_list<RenderGraphResource> attachments);
+    // Imported images whose views were used for framebuffers have been recreated
+    void InvalidateFramebuffers();
+
+    uint32_t GetCulledPassCount() const { return this->culledPasses; }
+    uint32_t GetBarrierBatchCount() const { return this->barrierBatches; }
+    VkDeviceSize GetTransientMemorySize() const;
+private:
+    friend class RenderPassBuilder;
+
+    struct Access {
+        RenderGraphResource resource;
+        ResourceUsage usage;
+        bool write;
+        VkImageLayout finalLayout;
+    };
+
+    // Type erased execute callback living in the frame arena
+    struct ExecuteFunction {
+        void* object;
+        void (*invoke)(void* object, VkCommandBuffer commandBuffer);
+        void (*destroy)(void* object);
+    };
+
+    // A pass's accesses are declared together, so they're one contiguous range of the graph's access list
+    struct Pass {
+        std::string name;
+        ExecuteFunction execute;
+        uint32_t firstAccess = 0;
+        uint32_t accessCount = 0;
+        bool sideEffects = false;
+        bool culled = false;
+    };
+
+    struct Resource {
+        std::string name;
+        bool transient;
+        TransientImageDesc desc;
+        Image* image;
+        bool exported = false;
+        ResourceUsage exportUsage;
+        uint32_t firstPass = UINT32_MAX;
+        uint32_t lastPass = 0;
+        uint32_t transientIndex = UINT32_MAX;
+    };
+
+    struct TransientLifetime {
+        TransientImageDesc desc;
+        uint32_t firstPass;
+        uint32_t lastPass;
+
+        bool operator==(const TransientLifetime& other) const = default;
+    };
+
+    struct MemorySlot {
+        VmaAllocation allocation{};
+        VkMemoryRequirements requirements{};
+        std::vector<std::pair<uint32_t, uint32_t>> lifetimes;
+        VkPipelineStageFlags lastStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        VkAccessFlags lastAccess = 0;
+    };
+
+    struct Framebuffer {
+        VkRenderPass renderPass;
+        std::vector<VkImageView> attachments;
+        VkFramebuffer framebuffer;
+    };
+
+    static void GetUsageState(ResourceUsage usage, VkImageLayout& layout, VkPipelineStageFlags& stage, VkAccessFlags& access);
+    void* AllocateFrameData(size_t size, size_t alignment);
+    uint32_t BeginPass(const std::string& name, ExecuteFunction execute);
+    std::span<const Access> GetAccesses(const Pass& pass) const { return { this->accesses.data() + pass.firstAccess, pass.accessCount }; }
+    // Runs the destructors of the execute callbacks still alive, their memory goes with the frame arena
+    void ReleaseCallbacks();
+    void AllocateTransients(std::span<const TransientLifetime> lifetimes);
+    void FreeTransients();
+
+    Context* context;
+    std::vector<Pass> passes;
+    std::vector<Access> accesses;
+    std::vector<Resource> resources;
+
+    std::vector<TransientLifetime> transientLifetimes;
+    std::vector<std::unique_ptr<Image>> transientImages;
+    std::vector<uint32_t> transientSlots;
+    std::vector<MemorySlot> slots;
+    std::vector<Framebuffer> framebuffers;
+
+    uint32_t culledPasses = 0;
+    uint32_t barrierBatches = 0;
+};
@@ -0,0 +1,78 @@
+#include "sampler.h"
+#include "core/hash.h"
+
+bool SamplerKey::operator==(const SamplerKey& other) const {
+    const VkSamplerCreateInfo& a = this->info;
+    const VkSamplerCreateInfo& b = other.info;
+    return a.flags == b.flags &&
+        a.magFilter == b.magFilter &&
+        a.minFilter == b.minFilter &&
+        a.mipmapMode == b.mipmapMode &&
+        a.addressModeU == b.addressModeU &&
+        a.addressModeV == b.addressModeV &&
+        a.addressModeW == b.addressModeW &&
+        a.mipLodBias == b.mipLodBias &&
+        a.anisotropyEnable == b.anisotropyEnable &&
+        a.maxAnisotropy == b.maxAnisotropy &&
+        a.compareEnable == b.compareEnable &&
+        a.compareOp == b.compareOp &&
+        a.minLod == b.minLod &&
+        a.maxLod == b.maxLod &&
+        a.borderColor == b.borderColor &&
+        a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+}
+
+size_t SamplerKeyHash::operator()(const SamplerKey& key) const {
+    const VkSamplerCreateInfo& info = key.info;
+    size_t seed = 0;
+    HashCombine(seed, info.flags);
+    HashCombine(seed, (uint32_t)info.magFilter);
+    HashCombine(seed, (uint32_t)info.minFilter);
+    HashCombine(seed, (uint32_t)info.mipmapMode);
+    HashCombine(seed, (uint32_t)info.addressModeU);
+    HashCombine(seed, (uint32_t)info.addressModeV);
+    HashCombine(seed, (uint32_t)info.addressModeW);
+    HashCombine(seed, info.mipLodBias);
+    HashCombine(seed, info.anisotropyEnable);
+    HashCombine(seed, info.maxAnisotropy);
+    HashCombine(seed, info.compareEnable);
+    HashCombine(seed, (uint32_t)info.compareOp);
+    HashCombine(seed, info.minLod);
+    HashCombine(seed, info.maxLod);
+    HashCombine(seed, (uint32_t)info.borderColor);
+    HashCombine(seed, info.unnormalizedCoordinates);
+    return seed;
+}
+
+void SamplerCache::Init(VkDevice device) {
+    this->device = device;
+}
+
+void SamplerCache::Destroy() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (auto& [key, sampler] : this->samplers) {
+        vkDestroySampler(this->device, sampler, nullptr);
+    }
+    this->samplers.clear();
+}
+
+VkSampler SamplerCache::Get(const VkSamplerCreateInfo& info) {
+    SamplerKey key{ info };
+    key.info.pNext = nullptr; // Extension structs aren't part of the key
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto it = this->samplers.find(key);
+    if (it != this->samplers.end()) {
+        return it->second;
+    }
+
+    VkSampler sampler;
+    VkResult result = vkCreateSampler(this->device, &info, nullptr, &sampler);
+    if (result != VK_SUCCESS) {
+        CRITICAL("Sampler creation failed with error code: {}", result);
+    }
+    this->samplers.emplace(key, sampler);
+    DEBUG("Created sampler #{}", this->samplers.size());
+
+    return sampler;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+#include "mutex"
+
+// Samplers are immutable, so identical create infos can share one VkSampler across every texture
+struct SamplerKey {
+    VkSamplerCreateInfo info;
+
+    bool operator==(const SamplerKey& other) const;
+};
+
+struct SamplerKeyHash {
+    size_t operator()(const SamplerKey& key) const;
+};
+
+class SamplerCache {
+public:
+    void Init(VkDevice device);
+    void Destroy();
+
+    VkSampler Get(const VkSamplerCreateInfo& info);
+    size_t Size() const { return this->samplers.size(); }
+private:
+    VkDevice device{};
+    std::mutex mutex;
+    std::unordered_map<SamplerKey, VkSampler, SamplerKeyHash> samplers;
+};
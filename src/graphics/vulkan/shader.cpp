@@ -1,15 +1,13 @@
 #include "shader.h"
 
+#include "spirv_reflect.h"
+#include "core/vfs.h"
+
 Shader::Shader(VkDevice device, const char* fileName, ShaderType type) : device(device), type(type) {
-    std::ifstream file(fileName, std::ios::ate | std::ios::binary);
-    if (!file.is_open()) {
+    std::vector<char> buffer;
+    if (!FileSystem::Get().ReadFile(fileName, buffer)) {
         CRITICAL("Opening shader file {} failed", fileName);
     }
-    size_t fileSize = file.tellg();
-    std::vector<char> buffer(fileSize);
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
 
     VkShaderModuleCreateInfo moduleInfo{};
     moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -20,6 +18,63 @@ Shader::Shader(VkDevice device, const char* fileName, ShaderType type) : device(
     if (result != VK_SUCCESS) {
         CRITICAL("Failed to create shader module with error code: {}", result);
     }
+
+    this->Reflect(buffer, fileName);
+}
+
+void Shader::Reflect(const std::vector<char>& code, const char* fileName) {
+    SpvReflectShaderModule reflectModule;
+    SpvReflectResult result = spvReflectCreateShaderModule(code.size(), code.data(), &reflectModule);
+    if (result != SPV_REFLECT_RESULT_SUCCESS) {
+        CRITICAL("Reflecting shader {} failed with error code: {}", fileName, (int)result);
+    }
+
+    uint32_t count = 0;
+    spvReflectEnumerateDescriptorSets(&reflectModule, &count, nullptr);
+    std::vector<SpvReflectDescriptorSet*> sets(count);
+    spvReflectEnumerateDescriptorSets(&reflectModule, &count, sets.data());
+    for (const SpvReflectDescriptorSet* set : sets) {
+        auto& bindings = this->reflection.sets[set->set];
+        for (uint32_t i = 0; i < set->binding_count; i++) {
+            const SpvReflectDescriptorBinding* reflected = set->bindings[i];
+            VkDescriptorSetLayoutBinding binding{};
+            binding.binding = reflected->binding;
+            binding.descriptorType = (VkDescriptorType)reflected->descriptor_type;
+            binding.descriptorCount = 1;
+            for (uint32_t dim = 0; dim < reflected->array.dims_count; dim++) {
+                binding.descriptorCount *= reflected->array.dims[dim];
+            }
+            binding.stageFlags = this->type;
+            bindings.push_back(binding);
+        }
+        std::sort(bindings.begin(), bindings.end(), [](const auto& a, const auto& b) { return a.binding < b.binding; });
+    }
+
+    count = 0;
+    spvReflectEnumeratePushConstantBlocks(&reflectModule, &count, nullptr);
+    std::vector<SpvReflectBlockVariable*> blocks(count);
+    spvReflectEnumeratePushConstantBlocks(&reflectModule, &count, blocks.data());
+    for (const SpvReflectBlockVariable* block : blocks) {
+        this->reflection.pushConstants.push_back({ (VkShaderStageFlags)this->type, block->offset, block->size });
+    }
+
+    if (this->type == VERTEX) {
+        count = 0;
+        spvReflectEnumerateInputVariables(&reflectModule, &count, nullptr);
+        std::vector<SpvReflectInterfaceVariable*> inputs(count);
+        spvReflectEnumerateInputVariables(&reflectModule, &count, inputs.data());
+        for (const SpvReflectInterfaceVariable* input : inputs) {
+            if (input->decoration_flags & SPV_REFLECT_DECORATION_BUILT_IN) continue;
+            // Matrices take one location per column
+            uint32_t locations = std::max(1u, input->numeric.matrix.column_count);
+            for (uint32_t i = 0; i < locations; i++) {
+                this->reflection.inputLocations.push_back(input->location + i);
+            }
+        }
+        std::sort(this->reflection.inputLocations.begin(), this->reflection.inputLocations.end());
+    }
+
+    spvReflectDestroyShaderModule(&reflectModule);
 }
 
 VkPipelineShaderStageCreateInfo Shader::GetStageInfo() {
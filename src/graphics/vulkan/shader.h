@@ -2,12 +2,22 @@
 
 #include "core/core.h"
 #include "vulkan/vulkan.h"
+#include "map"
 
 enum ShaderType {
     VERTEX = VK_SHADER_STAGE_VERTEX_BIT,
     FRAGMENT = VK_SHADER_STAGE_FRAGMENT_BIT
 };
 
+// What the SPIR-V declares, pipeline layouts and vertex input are derived from this instead of being written by hand
+struct ShaderReflection {
+    // Keyed by set index, bindings are sorted and carry this shader's stage only
+    std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> sets;
+    std::vector<VkPushConstantRange> pushConstants;
+    // Locations of the non built-in inputs, only meaningful for vertex shaders
+    std::vector<uint32_t> inputLocations;
+};
+
 struct Shader {
     Shader(VkDevice device, const char* fileName, ShaderType type);
     ~Shader() = default;
@@ -18,4 +28,7 @@ struct Shader {
     VkDevice device;
     VkShaderModule module;
     ShaderType type;
-};
\ No newline at end of file
+    ShaderReflection reflection;
+private:
+    void Reflect(const std::vector<char>& code, const char* fileName);
+};
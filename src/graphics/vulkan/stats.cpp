@@ -0,0 +1,104 @@
+#include "stats.h"
+
+#include "context.h"
+#include "core/memory.h"
+#include "core/arena.h"
+
+RenderStats& RenderStats::Get() {
+    static RenderStats stats;
+    return stats;
+}
+
+void RenderStats::EndFrame() {
+    this->lastFrame.draws = this->draws.Take();
+    this->lastFrame.triangles = this->triangles.Take();
+    this->lastFrame.pipelineBinds = this->pipelineBinds.Take();
+    this->lastFrame.bufferBinds = this->bufferBinds.Take();
+    this->lastFrame.descriptorBinds = this->descriptorBinds.Take();
+    this->lastFrame.descriptorWrites = this->descriptorWrites.Take();
+    this->lastFrame.uploadedBytes = this->uploadedBytes.Take();
+    uint64_t heapAllocations = GetHeapCounters().allocations;
+    this->lastFrame.heapAllocations = heapAllocations - this->heapAllocations;
+    this->heapAllocations = heapAllocations;
+}
+
+void PipelineStatistics::Init(Context* context) {
+    this->context = context;
+    this->frames.resize(context->framesInFlight);
+    this->enabled = context->enabledFeatures.pipelineStatisticsQuery && context->enabledFeatures.inheritedQueries;
+    if (!this->enabled) {
+        WARN("Pipeline statistics queries aren't supported, per pass GPU statistics are disabled");
+        return;
+    }
+
+    for (auto& frame : this->frames) {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        queryPoolInfo.queryCount = maxPasses;
+        queryPoolInfo.pipelineStatistics = flags;
+
+        VkResult queryPoolResult = vkCreateQueryPool(context->device, &queryPoolInfo, nullptr, &frame.pool);
+        if (queryPoolResult != VK_SUCCESS) {
+            CRITICAL("Pipeline statistics query pool creation failed with error code: {}", queryPoolResult);
+        }
+    }
+}
+
+void PipelineStatistics::Destroy() {
+    for (auto& frame : this->frames) {
+        if (frame.pool) vkDestroyQueryPool(this->context->device, frame.pool, nullptr);
+    }
+    this->frames.clear();
+}
+
+void PipelineStatistics::Collect(uint32_t frameIndex) {
+    this->currentFrame = frameIndex;
+    FrameQueries& frame = this->frames[frameIndex];
+    if (!frame.pool || frame.passes.empty()) return;
+
+    // One value per enabled statistic, in bit order
+    const uint32_t valuesPerQuery = 7;
+    ScratchScope scratch;
+    std::pmr::vector<uint64_t> values(frame.passes.size() * valuesPerQuery, scratch.Get());
+    VkResult queryResult = vkGetQueryPoolResults(this->context->device, frame.pool, 0, (uint32_t)frame.passes.size(), values.size() * sizeof(uint64_t), values.data(), valuesPerQuery * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (queryResult != VK_SUCCESS) return;
+
+    this->lastFrame.clear();
+    for (uint32_t i = 0; i < frame.passes.size(); i++) {
+        const uint64_t* pass = values.data() + i * valuesPerQuery;
+        PassStatistics statistics;
+        statistics.name = frame.passes[i];
+        statistics.inputVertices = pass[0];
+        statistics.inputPrimitives = pass[1];
+        statistics.vertexInvocations = pass[2];
+        statistics.clippingInvocations = pass[3];
+        statistics.clippingPrimitives = pass[4];
+        statistics.fragmentInvocations = pass[5];
+        statistics.computeInvocations = pass[6];
+        this->lastFrame.push_back(std::move(statistics));
+    }
+    frame.passes.clear();
+}
+
+void PipelineStatistics::Reset(VkCommandBuffer buffer, uint32_t frameIndex) {
+    FrameQueries& frame = this->frames[frameIndex];
+    frame.passes.clear();
+    if (!frame.pool) return;
+    vkCmdResetQueryPool(buffer, frame.pool, 0, maxPasses);
+}
+
+uint32_t PipelineStatistics::BeginPass(VkCommandBuffer buffer, const std::string& name) {
+    FrameQueries& frame = this->frames[this->currentFrame];
+    if (!frame.pool || frame.passes.size() == maxPasses) return UINT32_MAX;
+
+    uint32_t pass = (uint32_t)frame.passes.size();
+    frame.passes.push_back(name);
+    vkCmdBeginQuery(buffer, frame.pool, pass, 0);
+    return pass;
+}
+
+void PipelineStatistics::EndPass(VkCommandBuffer buffer, uint32_t pass) {
+    if (pass == UINT32_MAX) return;
+    vkCmdEndQuery(buffer, this->frames[this->currentFrame].pool, pass);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+#include "atomic"
+
+struct Context;
+
+struct FrameStats {
+    uint64_t draws = 0;
+    uint64_t triangles = 0;
+    uint64_t pipelineBinds = 0;
+    uint64_t bufferBinds = 0;
+    uint64_t descriptorBinds = 0;
+    uint64_t descriptorWrites = 0;
+    uint64_t uploadedBytes = 0;
+    // Process wide, zero in steady frames. Always zero without FENRIR_ALLOCATION_TRACKING
+    uint64_t heapAllocations = 0;
+};
+
+// Counted on whichever thread records the command, each counter sits on its own cache line so workers don't contend
+class RenderStats {
+public:
+    static RenderStats& Get();
+
+    void CountDraw(uint32_t indexCount, uint32_t instanceCount = 1) {
+        this->draws.value.fetch_add(1, std::memory_order_relaxed);
+        this->triangles.value.fetch_add((uint64_t)indexCount / 3 * instanceCount, std::memory_order_relaxed);
+    }
+    void CountPipelineBind() { this->pipelineBinds.value.fetch_add(1, std::memory_order_relaxed); }
+    void CountBufferBinds(uint32_t count) { this->bufferBinds.value.fetch_add(count, std::memory_order_relaxed); }
+    void CountDescriptorBinds(uint32_t count) { this->descriptorBinds.value.fetch_add(count, std::memory_order_relaxed); }
+    void CountDescriptorWrites(uint32_t count) { this->descriptorWrites.value.fetch_add(count, std::memory_order_relaxed); }
+    void CountUpload(uint64_t bytes) { this->uploadedBytes.value.fetch_add(bytes, std::memory_order_relaxed); }
+
+    // Publishes the counts since the last call as the last frame's and starts over
+    void EndFrame();
+    const FrameStats& GetLastFrame() const { return this->lastFrame; }
+private:
+    struct alignas(64) Counter {
+        std::atomic<uint64_t> value = 0;
+
+        uint64_t Take() { return this->value.exchange(0, std::memory_order_relaxed); }
+    };
+
+    Counter draws;
+    Counter triangles;
+    Counter pipelineBinds;
+    Counter bufferBinds;
+    Counter descriptorBinds;
+    Counter descriptorWrites;
+    Counter uploadedBytes;
+    uint64_t heapAllocations = 0;
+    FrameStats lastFrame;
+};
+
+struct PassStatistics {
+    std::string name;
+    uint64_t inputVertices = 0;
+    uint64_t inputPrimitives = 0;
+    uint64_t vertexInvocations = 0;
+    uint64_t clippingInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentInvocations = 0;
+    uint64_t computeInvocations = 0;
+};
+
+// One pipeline statistics query per render graph pass, read back once the frame's fence has signalled. Needs the
+// pipelineStatisticsQuery and inheritedQueries features since the scene is drawn from secondary command buffers
+class PipelineStatistics {
+public:
+    void Init(Context* context);
+    void Destroy();
+
+    void Collect(uint32_t frameIndex);
+    void Reset(VkCommandBuffer buffer, uint32_t frameIndex);
+
+    uint32_t BeginPass(VkCommandBuffer buffer, const std::string& name);
+    void EndPass(VkCommandBuffer buffer, uint32_t pass);
+
+    // What secondary command buffers executed inside a pass have to declare in their inheritance info
+    VkQueryPipelineStatisticFlags GetInheritedFlags() const { return this->enabled ? flags : 0; }
+    bool IsEnabled() const { return this->enabled; }
+    const std::vector<PassStatistics>& GetLastFrame() const { return this->lastFrame; }
+
+    static constexpr VkQueryPipelineStatisticFlags flags =
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+private:
+    static constexpr uint32_t maxPasses = 32;
+
+    struct FrameQueries {
+        VkQueryPool pool{};
+        std::vector<std::string> passes;
+    };
+
+    Context* context{};
+    bool enabled = false;
+    uint32_t currentFrame = 0;
+    std::vector<FrameQueries> frames;
+    std::vector<PassStatistics> lastFrame;
+};
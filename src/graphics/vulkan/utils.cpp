@@ -15,10 +15,15 @@ QueueFamilies FindQueueFamilies(const Context *context, const VkPhysicalDevice p
         if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
             families.graphics = i;
         }
-        VkBool32 supportsPresent = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(physical, i, context->surface, &supportsPresent);
-        if (supportsPresent) {
-            families.present = i;
+        if (context->surface == VK_NULL_HANDLE) {
+            // Headless, nothing is presented so the graphics queue stands in for the present queue
+            if (families.graphics.has_value()) families.present = families.graphics;
+        } else {
+            VkBool32 supportsPresent = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(physical, i, context->surface, &supportsPresent);
+            if (supportsPresent) {
+                families.present = i;
+            }
         }
 
         if (families.Complete()) return families;
@@ -71,8 +76,11 @@ VkPhysicalDevice PickPhysicalDevice(const Context* context, const std::vector<Vk
         }
 
         // Check swapchain support
-        SwapchainDetails details = GetSwapchainDetails(context, physical);
-        bool swapChainSupported = !details.formats.empty() && !details.presentModes.empty();
+        bool swapChainSupported = true;
+        if (context->surface != VK_NULL_HANDLE) {
+            SwapchainDetails details = GetSwapchainDetails(context, physical);
+            swapChainSupported = !details.formats.empty() && !details.presentModes.empty();
+        }
 
         VkPhysicalDeviceFeatures features;
         vkGetPhysicalDeviceFeatures(physical, &features);
@@ -8,7 +8,7 @@ struct Vertex {
     glm::vec3 pos;
     glm::vec3 color;
     //glm::vec3 normal;
-    //glm::vec2 uv;
+    glm::vec2 uv;
 
     static VkVertexInputBindingDescription GetBindingDescription() {
         VkVertexInputBindingDescription bindingDescription{};
@@ -19,8 +19,8 @@ struct Vertex {
         return bindingDescription;
     }
 
-    static std::array<VkVertexInputAttributeDescription, 2> GetAttributeDescriptions() {
-        std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
+    static std::array<VkVertexInputAttributeDescription, 3> GetAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
 
         attributeDescriptions[0].binding = 0;
         attributeDescriptions[0].location = 0;
@@ -32,16 +32,50 @@ struct Vertex {
         attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
         attributeDescriptions[1].offset = offsetof(Vertex, color);
 
-        /*attributeDescriptions[2].binding = 0;
-        attributeDescriptions[2].location = 2;
-        attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[2].offset = offsetof(Vertex, normal);
+        attributeDescriptions[2].binding = 0;
+        attributeDescriptions[2].location = 3;
+        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
+        attributeDescriptions[2].offset = offsetof(Vertex, uv);
 
-        attributeDescriptions[3].binding = 0;
-        attributeDescriptions[3].location = 3;
-        attributeDescriptions[3].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[3].offset = offsetof(Vertex, uv);*/
+        /*attributeDescriptions[3].binding = 0;
+        attributeDescriptions[3].location = 2;
+        attributeDescriptions[3].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[3].offset = offsetof(Vertex, normal);*/
 
         return attributeDescriptions;
     }
-};
\ No newline at end of file
+};
+
+// Per instance stream at binding 1, written by the render queue. Draws point firstInstance at their first record
+struct InstanceData {
+    glm::mat4 transform;
+    uint32_t material;
+
+    static VkVertexInputBindingDescription GetBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(InstanceData);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        return bindingDescription;
+    }
+
+    // A mat4 takes four consecutive locations, one per column
+    static std::array<VkVertexInputAttributeDescription, 5> GetAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions{};
+
+        for (uint32_t column = 0; column < 4; column++) {
+            attributeDescriptions[column].binding = 1;
+            attributeDescriptions[column].location = 4 + column;
+            attributeDescriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[column].offset = offsetof(InstanceData, transform) + sizeof(glm::vec4) * column;
+        }
+
+        attributeDescriptions[4].binding = 1;
+        attributeDescriptions[4].location = 8;
+        attributeDescriptions[4].format = VK_FORMAT_R32_UINT;
+        attributeDescriptions[4].offset = offsetof(InstanceData, material);
+
+        return attributeDescriptions;
+    }
+};
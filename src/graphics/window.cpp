@@ -1,9 +1,8 @@
 #include "window.h"
 #define GLFW_INCLUDE_VULKAN
 #include "GLFW/glfw3.h"
-#include "windowevents.h"
 
-Window::Window(std::vector<Event*>* eventBus) {
+Window::Window(EventQueue* events) : events(events) {
     if (!glfwInit()) {
         CRITICAL("GLFW failed to initialise, all downhill from here...");
     }
@@ -27,15 +26,15 @@ Window::Window(std::vector<Event*>* eventBus) {
         CRITICAL("Window creation failed, explosion imminent");
     }
 
-    glfwSetWindowUserPointer(this->window, eventBus);
+    glfwSetWindowUserPointer(this->window, events);
     glfwSetWindowCloseCallback(this->window, [](GLFWwindow* window) {
-        auto* eventBus = (std::vector<Event*>*)glfwGetWindowUserPointer(window);
-        eventBus->push_back(new WindowCloseEvent());
+        auto* events = (EventQueue*)glfwGetWindowUserPointer(window);
+        events->Push(WindowCloseEvent{});
     });
 
     glfwSetKeyCallback(this->window, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
-        auto* eventBus = (std::vector<Event*>*)glfwGetWindowUserPointer(window);
-        eventBus->push_back(new KeyEvent(key, action));
+        auto* events = (EventQueue*)glfwGetWindowUserPointer(window);
+        events->Push(KeyEvent{ key, action });
     });
 }
 
@@ -44,17 +43,22 @@ Window::~Window() {
     glfwTerminate();
 }
 
-void Window::OnTick() {
+void Window::PollEvents() {
     glfwPollEvents();
 }
 
-void Window::OnEvent(Event* event) {
-    if (event->GetType() == EventType::WINDOW_CLOSE) glfwSetWindowShouldClose(this->window, true);
-    if (event->GetType() == EventType::KEY) {
-        auto* keyEvent = (KeyEvent*)event;
-        if (keyEvent->key == GLFW_KEY_ESCAPE) {
-            glfwSetWindowShouldClose(this->window, true);
-        }
+void Window::OnAttach(EventDispatcher& dispatcher) {
+    dispatcher.Subscribe<WindowCloseEvent, &Window::OnWindowClose>(this);
+    dispatcher.Subscribe<KeyEvent, &Window::OnKey>(this);
+}
+
+void Window::OnWindowClose(const WindowCloseEvent& event) {
+    glfwSetWindowShouldClose(this->window, true);
+}
+
+void Window::OnKey(const KeyEvent& event) {
+    if (event.key == GLFW_KEY_ESCAPE) {
+        glfwSetWindowShouldClose(this->window, true);
     }
 }
 
@@ -8,7 +8,7 @@ struct GLFWwindow;
 
 class Window : public Layer {
 public:
-    Window(std::vector<Event*>* eventBus);
+    Window(EventQueue* events);
     ~Window();
 
     bool ShouldClose();
@@ -17,11 +17,14 @@ public:
         return this->window;
     }
 
-    virtual void OnTick();
-    virtual void OnEvent(Event* event);
+    virtual void OnAttach(EventDispatcher& dispatcher);
+    // Main thread only, GLFW requires it
+    void PollEvents();
 private:
     GLFWwindow* window;
-    std::vector<Event*>* eventBus;
+    EventQueue* events;
 
+    void OnWindowClose(const WindowCloseEvent& event);
+    void OnKey(const KeyEvent& event);
     void ErrorCallback(int error, const char* description);
 };
\ No newline at end of file
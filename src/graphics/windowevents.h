@@ -1,26 +1,10 @@
 #pragma once
 
-#include "core/event.h"
+// Plain payloads, copied by value into the event queue so they mustn't own anything
 
-class WindowCloseEvent : public Event {
-public:
-    WindowCloseEvent() {};
-    ~WindowCloseEvent() {};
-
-    virtual EventType GetType() {
-        return EventType::WINDOW_CLOSE;
-    }
-};
-
-class KeyEvent : public Event {
-public:
-    KeyEvent(int key, int action): key(key), action(action) {}
-    ~KeyEvent() {}
-
-    virtual EventType GetType() {
-        return EventType::KEY;
-    }
+struct WindowCloseEvent {};
 
+struct KeyEvent {
     int key;
     int action;
-};
\ No newline at end of file
+};
@@ -2,17 +2,51 @@
 
 #include "spdlog/spdlog.h"
 #include "core/application.h"
+#include "core/vfs.h"
 #include "graphics/vulkan/utils.h"
 
-int main() {
-    spdlog::set_level(spdlog::level::debug);
+// Renders a fixed number of frames without opening a window and saves the last one, for CI and regression captures
+int RunHeadless(uint32_t frames, const std::string& output) {
+    Renderer renderer(1280, 720);
+    renderer.WaitForPipelines();
+    // One fixed step per frame so every run renders the same frames
+    for (uint32_t i = 0; i < frames; i++) {
+        renderer.OnFixedUpdate(fixedTimestep);
+        renderer.OnTick(1.0f);
+    }
+    renderer.Capture(output);
+    return 0;
+}
 
+int Run(int argc, char** argv) {
     INFO("{}", Pad(256, 256));
     INFO("{}", Pad(1000, 256));
+    // --pack path reads assets out of a pack built with fenrir_cook --pack, they're read from loose files otherwise
+    if (argc >= 3 && std::string(argv[1]) == "--pack") {
+        if (!FileSystem::Get().Mount(argv[2])) {
+            CRITICAL("Couldn't mount {}", argv[2]);
+        }
+        argc -= 2;
+        argv += 2;
+    }
 
-    Application app;
-    app.Run();
-
+    if (argc >= 3 && std::string(argv[1]) == "--headless") {
+        return RunHeadless((uint32_t)std::stoul(argv[2]), argc >= 4 ? argv[3] : "frame.png");
+    }
 
+    Application app(argc >= 3 && std::string(argv[1]) == "--world" ? argv[2] : "");
+    app.Run();
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char** argv) {
+    // The level is fixed at build time (FENRIR_LOG_LEVEL), the session drains the log queue however main exits
+    LogSession logging;
+    PROFILE_THREAD("Main");
+    try {
+        return Run(argc, argv);
+    } catch (const std::exception& exception) {
+        spdlog::error("Exiting after an unhandled exception: {}", exception.what());
+        return 1;
+    }
+}
@@ -0,0 +1,362 @@
+#include "chrono"
+#include "filesystem"
+#include "numeric"
+
+#include "spdlog/spdlog.h"
+#include "nlohmann/json.hpp"
+#include "graphics/renderer.h"
+#include "core/jobsystem.h"
+#include "core/memory.h"
+#include "core/vfs.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include "windows.h"
+#include "psapi.h"
+#else
+#include "sys/resource.h"
+#endif
+
+using namespace nlohmann;
+
+// Flies a fixed camera path around each model headlessly and writes frame times and memory peaks to a JSON report,
+// so runs on the same machine can be compared between releases
+struct BenchmarkOptions {
+    uint32_t frames = 500;
+    uint32_t warmupFrames = 10;
+    uint32_t width = 1920;
+    uint32_t height = 1080;
+    std::string output = "benchmark.json";
+    // Chrome trace of the whole run, written when set and profiling is compiled in
+    std::string trace;
+    // Measures job system scaling instead of rendering models
+    bool jobs = false;
+    // Pack built by fenrir_cook --pack to read assets from, loose files are read when unset
+    std::string pack;
+    std::vector<std::string> models;
+};
+
+size_t GetPeakProcessMemory() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+VkDeviceSize GetDeviceMemoryUsage(Context& context) {
+    const VkPhysicalDeviceMemoryProperties* memoryProperties;
+    vmaGetMemoryProperties(context.allocator, &memoryProperties);
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets;
+    vmaGetHeapBudgets(context.allocator, budgets.data());
+
+    VkDeviceSize usage = 0;
+    for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; i++) {
+        if (memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            usage += budgets[i].statistics.blockBytes;
+        }
+    }
+    return usage;
+}
+
+json Summarize(std::vector<double> samples) {
+    json summary = json::object();
+    if (samples.empty()) return summary;
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&](double p) {
+        size_t index = (size_t)std::ceil(p / 100.0 * samples.size());
+        return samples[std::clamp<size_t>(index, 1, samples.size()) - 1];
+    };
+    summary["min"] = samples.front();
+    summary["max"] = samples.back();
+    summary["mean"] = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    summary["p50"] = percentile(50);
+    summary["p90"] = percentile(90);
+    summary["p95"] = percentile(95);
+    summary["p99"] = percentile(99);
+    return summary;
+}
+
+json RunModel(Renderer& renderer, const BenchmarkOptions& options, const std::string& path) {
+    json result;
+    result["path"] = path;
+
+    Context& context = renderer.GetContext();
+    auto loadStart = std::chrono::high_resolution_clock::now();
+    try {
+        renderer.LoadModel(path);
+    }
+    catch (const std::exception& exception) {
+        WARN("Skipping {}: {}", path, exception.what());
+        result["error"] = exception.what();
+        return result;
+    }
+    auto loadEnd = std::chrono::high_resolution_clock::now();
+    result["loadTimeMs"] = std::chrono::duration<double, std::milli>(loadEnd - loadStart).count();
+
+    Model* model = renderer.GetModel();
+    std::vector<const Geometry*> draws;
+    model->CollectDraws(draws);
+    result["vertices"] = model->context.vertices.size();
+    result["indices"] = model->context.indices.size();
+    result["draws"] = draws.size();
+
+    glm::vec3 min, max;
+    model->GetBounds(min, max);
+    CameraPath path = CameraPath::Orbit(min, max);
+
+    // Reserved up front, the measured frames are checked for heap allocations and this loop counts towards them
+    std::vector<double> cpuFrameTimes;
+    std::vector<double> gpuFrameTimes;
+    cpuFrameTimes.reserve(options.frames);
+    gpuFrameTimes.reserve(options.frames);
+    VkDeviceSize deviceMemoryPeak = 0;
+    FrameStats totals;
+    uint32_t totalFrames = options.warmupFrames + options.frames;
+    for (uint32_t i = 0; i < totalFrames; i++) {
+        // Warmup frames sit at the start of the path so the measured frames always cover the whole loop
+        uint32_t pathFrame = i < options.warmupFrames ? 0 : i - options.warmupFrames;
+        renderer.SetCamera(path.Sample(pathFrame / (float)std::max(options.frames - 1, 1u)));
+
+        auto frameStart = std::chrono::high_resolution_clock::now();
+        renderer.OnFixedUpdate(fixedTimestep);
+        renderer.OnTick(1.0f);
+        auto frameEnd = std::chrono::high_resolution_clock::now();
+
+        deviceMemoryPeak = std::max(deviceMemoryPeak, GetDeviceMemoryUsage(context));
+        if (i < options.warmupFrames) continue;
+        cpuFrameTimes.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+        const FrameStats& stats = RenderStats::Get().GetLastFrame();
+        totals.draws += stats.draws;
+        totals.triangles += stats.triangles;
+        totals.pipelineBinds += stats.pipelineBinds;
+        totals.bufferBinds += stats.bufferBinds;
+        totals.descriptorBinds += stats.descriptorBinds;
+        totals.descriptorWrites += stats.descriptorWrites;
+        totals.uploadedBytes += stats.uploadedBytes;
+        totals.heapAllocations += stats.heapAllocations;
+        // GPU results trail by the frames in flight, so these are from frames that started inside the measured range
+        if (i >= options.warmupFrames + context.framesInFlight && context.timestampsSupported) {
+            gpuFrameTimes.push_back(context.gpuFrameTime);
+        }
+    }
+    vkDeviceWaitIdle(context.device);
+
+    result["cpuFrameMs"] = Summarize(cpuFrameTimes);
+    result["gpuFrameMs"] = Summarize(gpuFrameTimes);
+    result["deviceMemoryPeakBytes"] = deviceMemoryPeak;
+
+    // Per frame averages, the path is fixed so these only move when the renderer changes
+    double frames = std::max(options.frames, 1u);
+    result["stats"] = {
+        {"draws", totals.draws / frames},
+        {"triangles", totals.triangles / frames},
+        {"pipelineBinds", totals.pipelineBinds / frames},
+        {"bufferBinds", totals.bufferBinds / frames},
+        {"descriptorBinds", totals.descriptorBinds / frames},
+        {"descriptorWrites", totals.descriptorWrites / frames},
+        {"uploadedBytes", totals.uploadedBytes / frames}
+    };
+    // A total rather than an average, anything but zero means some thread went to the heap during steady frames
+    if (IsHeapTrackingEnabled()) {
+        result["processHeapAllocations"] = totals.heapAllocations;
+        if (totals.heapAllocations != 0) {
+            WARN("{}: {} process wide heap allocations over {} measured frames", path, totals.heapAllocations, options.frames);
+        }
+    }
+    json passes = json::array();
+    for (const auto& pass : context.pipelineStatistics.GetLastFrame()) {
+        passes.push_back({
+            {"name", pass.name},
+            {"inputVertices", pass.inputVertices},
+            {"inputPrimitives", pass.inputPrimitives},
+            {"vertexInvocations", pass.vertexInvocations},
+            {"clippingInvocations", pass.clippingInvocations},
+            {"clippingPrimitives", pass.clippingPrimitives},
+            {"fragmentInvocations", pass.fragmentInvocations},
+            {"computeInvocations", pass.computeInvocations}
+        });
+    }
+    result["passes"] = passes;
+    INFO("{}: load {:.1f} ms, cpu p50 {:.2f} ms, gpu p50 {:.2f} ms", path, result["loadTimeMs"].get<double>(),
+        result["cpuFrameMs"].value("p50", 0.0), result["gpuFrameMs"].value("p50", 0.0));
+    return result;
+}
+
+double MedianTime(uint32_t repeats, const std::function<void()>& run) {
+    std::vector<double> times;
+    for (uint32_t i = 0; i < repeats; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        run();
+        auto end = std::chrono::high_resolution_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Runs the same CPU workloads through the job system with 1 to N threads, speedups are against the single thread run
+json RunJobScaling() {
+    const uint32_t repeats = 7;
+    const uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    // Cheap uniform items, measures how well batching hides the scheduling cost
+    const uint32_t uniformCount = 1 << 22;
+    std::vector<float> uniformResults(uniformCount);
+    auto uniform = [&](JobSystem& jobs) {
+        jobs.ParallelFor(uniformCount, [&](uint32_t i, uint32_t) { uniformResults[i] = std::sqrt((float)i) * 0.5f; }, 4096);
+    };
+    // A few expensive items of very different cost, only stealing keeps every thread busy until the end
+    const uint32_t unevenCount = 4096;
+    std::vector<float> unevenResults(unevenCount);
+    auto uneven = [&](JobSystem& jobs) {
+        jobs.ParallelFor(unevenCount, [&](uint32_t i, uint32_t) {
+            float value = (float)i;
+            for (uint32_t j = 0; j < (i % 64) * 16; j++) value = std::sin(value) + 1.0f;
+            unevenResults[i] = value;
+        });
+    };
+    // One job per item with nothing in it, the pure cost of Run, stealing and the counter
+    const uint32_t tinyCount = 1 << 16;
+    auto tiny = [&](JobSystem& jobs) {
+        JobCounter counter;
+        for (uint32_t i = 0; i < tinyCount; i++) {
+            jobs.Run([](uint32_t) {}, &counter);
+        }
+        jobs.Wait(counter);
+    };
+
+    json results = json::array();
+    double uniformBase = 0, unevenBase = 0, tinyBase = 0;
+    for (uint32_t threads : threadCounts) {
+        JobSystem jobs(threads - 1);
+        double uniformMs = MedianTime(repeats, [&]() { uniform(jobs); });
+        double unevenMs = MedianTime(repeats, [&]() { uneven(jobs); });
+        double tinyMs = MedianTime(repeats, [&]() { tiny(jobs); });
+        if (threads == 1) {
+            uniformBase = uniformMs;
+            unevenBase = unevenMs;
+            tinyBase = tinyMs;
+        }
+        results.push_back({
+            {"threads", threads},
+            {"uniformParallelForMs", uniformMs},
+            {"uniformSpeedup", uniformBase / uniformMs},
+            {"unevenParallelForMs", unevenMs},
+            {"unevenSpeedup", unevenBase / unevenMs},
+            {"tinyJobsMs", tinyMs},
+            {"tinyJobNs", tinyMs * 1e6 / tinyCount},
+            {"tinyJobsSpeedup", tinyBase / tinyMs}
+        });
+        INFO("{} threads: uniform {:.2f} ms ({:.2f}x), uneven {:.2f} ms ({:.2f}x), {:.0f} ns per tiny job", threads,
+            uniformMs, uniformBase / uniformMs, unevenMs, unevenBase / unevenMs, tinyMs * 1e6 / tinyCount);
+    }
+    return results;
+}
+
+// Every glTF sample in models/samples, in a stable order so reports line up between runs
+std::vector<std::string> FindSampleModels() {
+    std::vector<std::string> models;
+    std::filesystem::path root = "models/samples";
+    if (!std::filesystem::exists(root)) return models;
+
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(root)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".gltf" && entry.path().parent_path().filename() == "glTF") {
+            models.push_back(entry.path().generic_string());
+        }
+    }
+    std::sort(models.begin(), models.end());
+    return models;
+}
+
+int Run(int argc, char** argv) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--frames" && hasValue) options.frames = (uint32_t)std::stoul(argv[++i]);
+        else if (argument == "--warmup" && hasValue) options.warmupFrames = (uint32_t)std::stoul(argv[++i]);
+        else if (argument == "--width" && hasValue) options.width = (uint32_t)std::stoul(argv[++i]);
+        else if (argument == "--height" && hasValue) options.height = (uint32_t)std::stoul(argv[++i]);
+        else if (argument == "--output" && hasValue) options.output = argv[++i];
+        else if (argument == "--trace" && hasValue) options.trace = argv[++i];
+        else if (argument == "--jobs") options.jobs = true;
+        else if (argument == "--pack" && hasValue) options.pack = argv[++i];
+        else if (argument.rfind("--", 0) == 0) {
+            std::cerr << "Usage: fenrir_benchmark [--frames N] [--warmup N] [--width W] [--height H] [--output report.json] [--trace trace.json] [--jobs] [--pack assets.fpack] [model.gltf...]" << std::endl;
+            return 1;
+        }
+        else options.models.push_back(argument);
+    }
+
+    if (options.jobs) {
+        json report;
+        report["hardwareThreads"] = std::thread::hardware_concurrency();
+        report["jobScaling"] = RunJobScaling();
+        std::ofstream file(options.output);
+        if (!file.is_open()) {
+            CRITICAL("Couldn't open {} for writing", options.output);
+        }
+        file << report.dump(4);
+        INFO("Wrote job scaling report to {}", options.output);
+        return 0;
+    }
+    if (!options.pack.empty() && !FileSystem::Get().Mount(options.pack)) {
+        CRITICAL("Couldn't mount {}", options.pack);
+    }
+    if (options.models.empty()) options.models = FindSampleModels();
+    if (options.models.empty()) {
+        CRITICAL("No models given and none found in models/samples");
+    }
+
+    json report;
+    report["frames"] = options.frames;
+    report["warmupFrames"] = options.warmupFrames;
+    report["width"] = options.width;
+    report["height"] = options.height;
+
+    {
+        Renderer renderer(options.width, options.height, "");
+        renderer.WaitForPipelines();
+        Context& context = renderer.GetContext();
+        report["device"] = context.physicalProperties.deviceName;
+        report["driverVersion"] = context.physicalProperties.driverVersion;
+        report["framesInFlight"] = context.framesInFlight;
+
+        for (const auto& model : options.models) {
+            report["models"].push_back(RunModel(renderer, options, model));
+        }
+    }
+    report["processMemoryPeakBytes"] = GetPeakProcessMemory();
+    if (!options.trace.empty()) {
+        Profiler::Get().ExportChromeTrace(options.trace);
+    }
+
+    std::ofstream file(options.output);
+    if (!file.is_open()) {
+        CRITICAL("Couldn't open {} for writing", options.output);
+    }
+    file << report.dump(4);
+    INFO("Wrote benchmark report for {} models to {}", options.models.size(), options.output);
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    LogSession logging;
+    PROFILE_THREAD("Main");
+    try {
+        return Run(argc, argv);
+    } catch (const std::exception& exception) {
+        spdlog::error("Exiting after an unhandled exception: {}", exception.what());
+        return 1;
+    }
+}
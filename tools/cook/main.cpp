@@ -0,0 +1,260 @@
+#include "cctype"
+#include "chrono"
+#include "filesystem"
+#include "unordered_set"
+
+#include "spdlog/spdlog.h"
+#include "core/jobsystem.h"
+#include "core/profiler.h"
+#include "core/pack.h"
+#include "graphics/cooked.h"
+#include "manifest.h"
+#include "meshcooker.h"
+#include "texturecooker.h"
+
+// Converts a tree of glTF models and images into runtime assets, mirroring the source layout under the output
+// directory: a .fmesh per model and a .ftex per image. Assets are cooked in parallel on the job system and the
+// manifest keeps every output that's still up to date from being cooked again
+struct CookOptions {
+    std::string source = cookSourceDirectory;
+    std::string output = cookOutputDirectory;
+    // Cooks everything again whatever the manifest says
+    bool force = false;
+    // Keeps textures as RGBA8 instead of block compressing them
+    bool uncompressed = false;
+    // When set, the source tree, the cooked tree and the shaders are also written into this pack for the runtime to
+    // mount
+    std::string pack;
+};
+
+enum class AssetType {
+    Mesh,
+    Texture,
+};
+
+struct CookItem {
+    AssetType type;
+    std::filesystem::path source;
+    // Relative to the output directory, also its key in the manifest
+    std::string output;
+    uint64_t sourceSize = 0;
+};
+
+struct CookResult {
+    enum class Status {
+        Skipped,
+        Cooked,
+        Failed,
+    };
+
+    Status status = Status::Failed;
+    ManifestEntry entry;
+};
+
+bool IsImage(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp";
+}
+
+// Where a source relative to the source directory ends up, relative to the output directory. Images keep their
+// extension in the name so a.png and a.jpg next to each other don't collide
+std::string GetOutputName(AssetType type, std::filesystem::path relative) {
+    if (type == AssetType::Mesh) relative.replace_extension(".fmesh");
+    else relative += ".ftex";
+    return relative.generic_string();
+}
+
+std::vector<CookItem> FindItems(const CookOptions& options) {
+    std::vector<CookItem> items;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(options.source)) {
+        if (!entry.is_regular_file()) continue;
+        std::filesystem::path relative = std::filesystem::relative(entry.path(), options.source);
+        if (entry.path().extension() == ".gltf") {
+            items.push_back({ AssetType::Mesh, entry.path(), GetOutputName(AssetType::Mesh, relative), entry.file_size() });
+        }
+        else if (IsImage(entry.path())) {
+            items.push_back({ AssetType::Texture, entry.path(), GetOutputName(AssetType::Texture, relative), entry.file_size() });
+        }
+    }
+
+    // Biggest first, so the slow ones start early instead of being the tail everything else waits on
+    std::sort(items.begin(), items.end(), [](const CookItem& a, const CookItem& b) { return a.sourceSize > b.sourceSize; });
+    return items;
+}
+
+// Through a temporary file, so an interrupted cook never leaves a truncated output that looks finished
+void WriteOutput(const std::filesystem::path& path, const std::vector<char>& bytes) {
+    std::filesystem::create_directories(path.parent_path());
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        if (!file.is_open()) {
+            CRITICAL("Couldn't open {} for writing", temporary.string());
+        }
+        file.write(bytes.data(), bytes.size());
+        if (!file) {
+            CRITICAL("Couldn't write {}", temporary.string());
+        }
+    }
+    std::filesystem::rename(temporary, path);
+}
+
+// The options that change what an item cooks to, meshes come out the same whatever the texture format
+std::string GetCookOptions(const CookItem& item, const CookOptions& options) {
+    if (item.type == AssetType::Mesh) return "";
+    return options.uncompressed ? "rgba8" : "compressed";
+}
+
+// The output exists, was cooked by this version of the formats with the same options and every dependency still
+// hashes the same. current gets the dependencies as they are now, so a touched file is only hashed once
+bool IsUpToDate(const ManifestEntry* previous, const std::filesystem::path& output, const std::string& options, ManifestEntry& current) {
+    if (!previous || previous->version != cookedFormatVersion || previous->options != options || !std::filesystem::exists(output)) return false;
+
+    current.version = cookedFormatVersion;
+    current.options = options;
+    for (const auto& dependency : previous->dependencies) {
+        SourceFile source;
+        if (!DescribeSource(dependency.path, &dependency, source) || source.hash != dependency.hash) return false;
+        current.dependencies.push_back(std::move(source));
+    }
+    return true;
+}
+
+CookResult Cook(const CookItem& item, const CookOptions& options, const Manifest& manifest) {
+    CookResult result;
+    std::filesystem::path output = std::filesystem::path(options.output) / item.output;
+    const ManifestEntry* previous = manifest.Find(item.output);
+    std::string cookOptions = GetCookOptions(item, options);
+    if (!options.force && IsUpToDate(previous, output, cookOptions, result.entry)) {
+        result.status = CookResult::Status::Skipped;
+        return result;
+    }
+
+    try {
+        std::vector<std::string> dependencies = item.type == AssetType::Mesh ? GetMeshDependencies(item.source) : std::vector<std::string>{ item.source.generic_string() };
+        // Described before cooking, a source that changes underneath is then cooked again next run instead of missed
+        result.entry = { cookedFormatVersion, cookOptions };
+        for (const auto& dependency : dependencies) {
+            const SourceFile* previousSource = nullptr;
+            if (previous) {
+                auto found = std::find_if(previous->dependencies.begin(), previous->dependencies.end(), [&](const SourceFile& source) { return source.path == dependency; });
+                if (found != previous->dependencies.end()) previousSource = &*found;
+            }
+            SourceFile& source = result.entry.dependencies.emplace_back();
+            if (!DescribeSource(dependency, previousSource, source)) {
+                CRITICAL("Couldn't read {}, a dependency of {}", dependency, item.source.string());
+            }
+        }
+
+        std::vector<char> bytes;
+        if (item.type == AssetType::Mesh) {
+            MeshCookStats stats;
+            bytes = CookMesh(item.source, [&](const std::string& imagePath) {
+                return GetOutputName(AssetType::Texture, std::filesystem::relative(imagePath, options.source));
+            }, stats);
+            INFO("Cooked {}: {} vertices, {} indices, ACMR {:.3f} -> {:.3f}", item.output, stats.vertices, stats.indices, stats.acmrBefore, stats.acmrAfter);
+        }
+        else {
+            TextureCookStats stats;
+            bytes = CookTexture(item.source, !options.uncompressed, stats);
+            INFO("Cooked {}: {}x{} with {} mips{}", item.output, stats.width, stats.height, stats.mipCount, stats.hasAlpha ? " and alpha" : "");
+        }
+        WriteOutput(output, bytes);
+        result.status = CookResult::Status::Cooked;
+    }
+    catch (const std::exception& exception) {
+        spdlog::error("Failed to cook {}: {}", item.source.string(), exception.what());
+        result.status = CookResult::Status::Failed;
+    }
+    return result;
+}
+
+// Everything the runtime reads, under the paths it reads them by
+std::vector<std::string> FindPackFiles(const CookOptions& options) {
+    std::vector<std::string> files;
+    for (const auto& root : { options.source, options.output, std::string("shaders") }) {
+        if (!std::filesystem::is_directory(root)) continue;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(root)) {
+            if (!entry.is_regular_file() || entry.path().filename() == "manifest.json" || entry.path().extension() == ".tmp") continue;
+            files.push_back(NormalizePackPath(entry.path().generic_string()));
+        }
+    }
+    // Sorted so the same tree always packs the same, and in case the roots overlap
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+    return files;
+}
+
+int Run(int argc, char** argv) {
+    CookOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--source" && hasValue) options.source = argv[++i];
+        else if (argument == "--output" && hasValue) options.output = argv[++i];
+        else if (argument == "--force") options.force = true;
+        else if (argument == "--uncompressed") options.uncompressed = true;
+        else if (argument == "--pack" && hasValue) options.pack = argv[++i];
+        else {
+            std::cerr << "Usage: fenrir_cook [--source models/samples] [--output cooked] [--force] [--uncompressed] [--pack assets.fpack]" << std::endl;
+            return 1;
+        }
+    }
+    if (!std::filesystem::is_directory(options.source)) {
+        CRITICAL("Source directory {} doesn't exist", options.source);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::filesystem::create_directories(options.output);
+    std::filesystem::path manifestPath = std::filesystem::path(options.output) / "manifest.json";
+    Manifest manifest;
+    manifest.Load(manifestPath);
+
+    std::vector<CookItem> items = FindItems(options);
+    std::vector<CookResult> results(items.size());
+    JobSystem& jobs = JobSystem::Get();
+    jobs.ParallelFor((uint32_t)items.size(), [&](uint32_t i, uint32_t) {
+        PROFILE_SCOPE("Cook asset");
+        results[i] = Cook(items[i], options, manifest);
+    });
+
+    // Failed outputs are left out so they're retried next run, ones whose source is gone are deleted
+    Manifest updated;
+    uint32_t cooked = 0, skipped = 0, failed = 0, removed = 0;
+    std::unordered_set<std::string> outputs;
+    for (uint32_t i = 0; i < items.size(); i++) {
+        outputs.insert(items[i].output);
+        switch (results[i].status) {
+        case CookResult::Status::Cooked: cooked++; break;
+        case CookResult::Status::Skipped: skipped++; break;
+        case CookResult::Status::Failed: failed++; continue;
+        }
+        updated.Set(items[i].output, std::move(results[i].entry));
+    }
+    for (const auto& [output, entry] : manifest.GetEntries()) {
+        if (outputs.contains(output)) continue;
+        std::error_code error;
+        if (std::filesystem::remove(std::filesystem::path(options.output) / output, error)) removed++;
+    }
+    updated.Save(manifestPath);
+    if (!options.pack.empty()) {
+        WritePack(options.pack, FindPackFiles(options));
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    INFO("Cooked {} assets, skipped {} unchanged, removed {} stale and {} failed in {:.2f} s on {} threads", cooked, skipped, removed, failed, seconds, jobs.GetWorkerCount() + 1);
+    return failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    LogSession logging;
+    PROFILE_THREAD("Main");
+    try {
+        return Run(argc, argv);
+    } catch (const std::exception& exception) {
+        spdlog::error("Exiting after an unhandled exception: {}", exception.what());
+        return 1;
+    }
+}
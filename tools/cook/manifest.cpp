@@ -0,0 +1,95 @@
+#include "manifest.h"
+
+#include "nlohmann/json.hpp"
+#include "core/hash.h"
+
+using namespace nlohmann;
+
+bool DescribeSource(const std::string& path, const SourceFile* previous, SourceFile& source) {
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(path, error);
+    if (error) return false;
+    std::filesystem::file_time_type modified = std::filesystem::last_write_time(path, error);
+    if (error) return false;
+
+    source.path = path;
+    source.size = size;
+    source.modified = (int64_t)modified.time_since_epoch().count();
+    if (previous && previous->path == path && previous->size == source.size && previous->modified == source.modified) {
+        source.hash = previous->hash;
+        return true;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    // In chunks so hashing a large texture doesn't need it in memory twice
+    std::vector<char> chunk(1 << 20);
+    source.hash = HashBytes(nullptr, 0);
+    while (file) {
+        file.read(chunk.data(), chunk.size());
+        source.hash = HashBytes(chunk.data(), (size_t)file.gcount(), source.hash);
+    }
+    return true;
+}
+
+void Manifest::Load(const std::filesystem::path& path) {
+    this->entries.clear();
+    std::ifstream file(path);
+    if (!file.is_open()) return;
+
+    json data = json::parse(file, nullptr, false);
+    if (data.is_discarded() || !data.contains("outputs")) {
+        WARN("Ignoring unreadable manifest {}, everything will be cooked again", path.string());
+        return;
+    }
+
+    for (auto& [output, value] : data["outputs"].items()) {
+        ManifestEntry entry;
+        entry.version = value.value("version", 0u);
+        entry.options = value.value("options", "");
+        for (auto& dependency : value["dependencies"]) {
+            entry.dependencies.push_back({ dependency["path"].get<std::string>(), dependency["size"].get<uint64_t>(), dependency["modified"].get<int64_t>(), dependency["hash"].get<uint64_t>() });
+        }
+        this->entries[output] = std::move(entry);
+    }
+}
+
+void Manifest::Save(const std::filesystem::path& path) const {
+    json data;
+    data["outputs"] = json::object();
+    for (const auto& [output, entry] : this->entries) {
+        json value;
+        value["version"] = entry.version;
+        value["options"] = entry.options;
+        value["dependencies"] = json::array();
+        for (const auto& dependency : entry.dependencies) {
+            value["dependencies"].push_back({ { "path", dependency.path }, { "size", dependency.size }, { "modified", dependency.modified }, { "hash", dependency.hash } });
+        }
+        data["outputs"][output] = std::move(value);
+    }
+
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary);
+        if (!file.is_open()) {
+            CRITICAL("Couldn't open {} for writing", temporary.string());
+        }
+        file << data.dump(4);
+    }
+    std::filesystem::rename(temporary, path);
+}
+
+const ManifestEntry* Manifest::Find(const std::string& output) const {
+    auto entry = this->entries.find(output);
+    return entry == this->entries.end() ? nullptr : &entry->second;
+}
+
+void Manifest::Set(const std::string& output, ManifestEntry entry) {
+    this->entries[output] = std::move(entry);
+}
+
+void Manifest::Remove(const std::string& output) {
+    this->entries.erase(output);
+}
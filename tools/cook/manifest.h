@@ -0,0 +1,41 @@
+#pragma once
+
+#include "filesystem"
+
+#include "core/core.h"
+
+// A file some output was cooked from, as it was at the time
+struct SourceFile {
+    std::string path;
+    uint64_t size = 0;
+    int64_t modified = 0;
+    uint64_t hash = 0;
+};
+
+// Describes the file at path now. When previous is the same file and its size and modification time still match, its
+// hash is taken as is instead of reading the whole file again. False if the file can't be read
+bool DescribeSource(const std::string& path, const SourceFile* previous, SourceFile& source);
+
+struct ManifestEntry {
+    uint32_t version = 0;
+    // The cook options the output depends on, a change cooks it again
+    std::string options;
+    std::vector<SourceFile> dependencies;
+};
+
+// What every output in the cooked tree was made from, kept next to it as manifest.json. An output is only cooked again
+// once a dependency's content hash changes, so touching files or checking them out again costs a hash, not a cook
+class Manifest {
+public:
+    void Load(const std::filesystem::path& path);
+    // Through a temporary file, an interrupted write leaves the previous manifest behind rather than half of one
+    void Save(const std::filesystem::path& path) const;
+
+    const ManifestEntry* Find(const std::string& output) const;
+    void Set(const std::string& output, ManifestEntry entry);
+    void Remove(const std::string& output);
+
+    inline const std::unordered_map<std::string, ManifestEntry>& GetEntries() const { return this->entries; }
+private:
+    std::unordered_map<std::string, ManifestEntry> entries;
+};
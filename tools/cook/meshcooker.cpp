@@ -0,0 +1,297 @@
+#include "meshcooker.h"
+
+#include "cmath"
+#include "numeric"
+
+#include "nlohmann/json.hpp"
+#include "graphics/model.h"
+#include "graphics/cooked.h"
+#include "core/hash.h"
+
+using namespace nlohmann;
+
+std::vector<std::string> GetMeshDependencies(const std::filesystem::path& source) {
+    std::vector<std::string> dependencies = { source.generic_string() };
+    std::ifstream file(source);
+    if (!file.is_open()) {
+        CRITICAL("Couldn't open file {}", source.string());
+    }
+
+    json data;
+    file >> data;
+    for (auto& buffer : data.value("buffers", json::array())) {
+        if (!buffer.contains("uri")) continue;
+        std::filesystem::path bufferPath = source;
+        bufferPath.replace_filename((std::string)buffer["uri"]);
+        dependencies.push_back(bufferPath.generic_string());
+    }
+    return dependencies;
+}
+
+static uint32_t CountCacheMisses(const std::vector<uint32_t>& indices, uint32_t vertexCount) {
+    constexpr uint32_t cacheSize = 16;
+    // A vertex is still cached while fewer than cacheSize others went in after it
+    std::vector<uint32_t> insertedAt(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    uint32_t misses = 0;
+    for (uint32_t index : indices) {
+        if (time - insertedAt[index] > cacheSize) {
+            insertedAt[index] = time++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+struct VertexKey {
+    const Vertex* vertex;
+    bool operator==(const VertexKey& other) const { return memcmp(this->vertex, other.vertex, sizeof(Vertex)) == 0; }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey& key) const { return (size_t)HashBytes(key.vertex, sizeof(Vertex)); }
+};
+
+// Points every index at the first of any bitwise identical vertices, the copies are dropped by OptimizeVertexFetch
+static void DeduplicateVertices(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    std::unordered_map<VertexKey, uint32_t, VertexKeyHash> unique;
+    unique.reserve(vertices.size());
+    std::vector<uint32_t> remap(vertices.size());
+    for (uint32_t i = 0; i < vertices.size(); i++) {
+        remap[i] = unique.try_emplace(VertexKey{ &vertices[i] }, i).first->second;
+    }
+    for (auto& index : indices) index = remap[index];
+}
+
+// Tom Forsyth's linear speed vertex cache optimisation. Greedily emits the triangle whose vertices score highest in a
+// simulated LRU cache, where vertices score for being recently used and for having few triangles left, so the last
+// triangles around a vertex get emitted before it falls out instead of being stranded
+static void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount) {
+    constexpr uint32_t cacheSize = 32;
+    constexpr uint32_t maxValence = 32;
+    uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+    if (triangleCount == 0) return;
+
+    std::array<float, cacheSize> cacheScores;
+    for (uint32_t i = 0; i < cacheSize; i++) {
+        // The last triangle's vertices score the same whatever their order, it's used next either way
+        cacheScores[i] = i < 3 ? 0.75f : std::pow(1.0f - (float)(i - 3) / (cacheSize - 3), 1.5f);
+    }
+    std::array<float, maxValence + 1> valenceScores;
+    valenceScores[0] = 0.0f;
+    for (uint32_t i = 1; i <= maxValence; i++) valenceScores[i] = 2.0f / std::sqrt((float)i);
+
+    // Triangles around each vertex, the ones still to be emitted are kept at the front of its range
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (uint32_t index : indices) remaining[index]++;
+    std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+    std::inclusive_scan(remaining.begin(), remaining.end(), firstTriangle.begin() + 1);
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> cursor(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (uint32_t i = 0; i < indices.size(); i++) adjacency[cursor[indices[i]]++] = i / 3;
+    }
+
+    std::vector<int32_t> cachePosition(vertexCount, -1);
+    auto scoreVertex = [&](uint32_t vertex) {
+        if (remaining[vertex] == 0) return -1.0f;
+        float score = cachePosition[vertex] < 0 ? 0.0f : cacheScores[cachePosition[vertex]];
+        return score + valenceScores[std::min(remaining[vertex], maxValence)];
+    };
+    std::vector<float> vertexScores(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; i++) vertexScores[i] = scoreVertex(i);
+
+    auto scoreTriangle = [&](uint32_t triangle) {
+        return vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+    };
+    std::vector<bool> emitted(triangleCount, false);
+    uint32_t best = 0;
+    float bestScore = scoreTriangle(0);
+    for (uint32_t i = 1; i < triangleCount; i++) {
+        float score = scoreTriangle(i);
+        if (score > bestScore) {
+            bestScore = score;
+            best = i;
+        }
+    }
+
+    std::vector<uint32_t> optimized;
+    optimized.reserve(indices.size());
+    std::array<uint32_t, cacheSize + 3> cache;
+    std::array<uint32_t, cacheSize + 3> nextCache;
+    uint32_t cacheCount = 0;
+    uint32_t scanCursor = 0;
+    while (best != UINT32_MAX) {
+        emitted[best] = true;
+        const uint32_t* triangle = &indices[best * 3];
+        uint32_t nextCount = 0;
+        for (uint32_t i = 0; i < 3; i++) {
+            uint32_t vertex = triangle[i];
+            optimized.push_back(vertex);
+            uint32_t* triangles = &adjacency[firstTriangle[vertex]];
+            for (uint32_t j = 0; j < remaining[vertex]; j++) {
+                if (triangles[j] == best) {
+                    triangles[j] = triangles[remaining[vertex] - 1];
+                    remaining[vertex]--;
+                    break;
+                }
+            }
+            // Degenerate triangles name a vertex twice, it still only takes one cache entry
+            if (std::find(nextCache.begin(), nextCache.begin() + nextCount, vertex) == nextCache.begin() + nextCount) nextCache[nextCount++] = vertex;
+        }
+
+        // The triangle's vertices go to the front, everything else moves back and the overflow falls out
+        uint32_t emittedCount = nextCount;
+        for (uint32_t i = 0; i < cacheCount; i++) {
+            if (std::find(nextCache.begin(), nextCache.begin() + emittedCount, cache[i]) == nextCache.begin() + emittedCount) nextCache[nextCount++] = cache[i];
+        }
+
+        for (uint32_t i = 0; i < nextCount; i++) {
+            cachePosition[nextCache[i]] = i < cacheSize ? (int32_t)i : -1;
+            vertexScores[nextCache[i]] = scoreVertex(nextCache[i]);
+        }
+
+        // Only the cache's vertices changed score, so the best triangle next to them is almost always the best overall
+        best = UINT32_MAX;
+        bestScore = -1.0f;
+        for (uint32_t i = 0; i < nextCount; i++) {
+            uint32_t vertex = nextCache[i];
+            const uint32_t* triangles = &adjacency[firstTriangle[vertex]];
+            for (uint32_t j = 0; j < remaining[vertex]; j++) {
+                float score = scoreTriangle(triangles[j]);
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = triangles[j];
+                }
+            }
+        }
+        cacheCount = std::min(nextCount, cacheSize);
+        std::copy(nextCache.begin(), nextCache.begin() + cacheCount, cache.begin());
+
+        if (best == UINT32_MAX) {
+            // Nothing left around the cache, carry on from the first triangle that hasn't been emitted
+            while (scanCursor < triangleCount && emitted[scanCursor]) scanCursor++;
+            if (scanCursor < triangleCount) best = scanCursor;
+        }
+    }
+    indices = std::move(optimized);
+}
+
+// Renumbers vertices in the order the triangles first use them, so fetches walk forwards through memory. Vertices
+// nothing references any more are dropped
+static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+    for (auto& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = (uint32_t)reordered.size();
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(reordered);
+}
+
+template <class T> static void AppendBytes(std::vector<char>& bytes, const T* data, size_t count) {
+    bytes.insert(bytes.end(), (const char*)data, (const char*)(data + count));
+}
+
+std::vector<char> CookMesh(const std::filesystem::path& source, FunctionRef<std::string(const std::string& imagePath)> textureReference, MeshCookStats& stats) {
+    PROFILE_FUNCTION();
+    // From the glTF even when an older .fmesh is around
+    Model model(nullptr, source.string(), glm::mat4(1.0f), false);
+    const ModelContext& context = model.context;
+
+    std::vector<const Geometry*> geometries;
+    model.CollectDraws(geometries);
+
+    std::vector<CookedPrimitive> primitives;
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    uint64_t missesBefore = 0, missesAfter = 0, triangles = 0;
+    for (const Geometry* geometry : geometries) {
+        const Mesh& mesh = geometry->mesh;
+        uint32_t vertexCount = (uint32_t)mesh.vertices.size;
+        std::vector<Vertex> primitiveVertices(context.vertices.begin() + mesh.vertices.offset, context.vertices.begin() + mesh.vertices.offset + vertexCount);
+        std::vector<uint32_t> primitiveIndices;
+        if (mesh.indices.buffer) {
+            primitiveIndices.assign(context.indices.begin() + mesh.indices.offset, context.indices.begin() + mesh.indices.offset + mesh.indices.size);
+        } else {
+            // Non indexed primitives get a trivial index buffer so they're merged and reordered like the rest
+            primitiveIndices.resize(vertexCount);
+            std::iota(primitiveIndices.begin(), primitiveIndices.end(), 0);
+        }
+        primitiveIndices.resize(primitiveIndices.size() / 3 * 3);
+        if (primitiveIndices.empty()) continue;
+        for (uint32_t index : primitiveIndices) {
+            if (index >= vertexCount) {
+                CRITICAL("Index {} is past the {} vertices of its primitive in {}", index, vertexCount, source.string());
+            }
+        }
+
+        missesBefore += CountCacheMisses(primitiveIndices, vertexCount);
+        DeduplicateVertices(primitiveVertices, primitiveIndices);
+        OptimizeVertexCache(primitiveIndices, vertexCount);
+        OptimizeVertexFetch(primitiveVertices, primitiveIndices);
+        missesAfter += CountCacheMisses(primitiveIndices, (uint32_t)primitiveVertices.size());
+        triangles += primitiveIndices.size() / 3;
+
+        CookedPrimitive primitive;
+        primitive.vertexOffset = (uint32_t)vertices.size();
+        primitive.vertexCount = (uint32_t)primitiveVertices.size();
+        primitive.indexOffset = (uint32_t)indices.size();
+        primitive.indexCount = (uint32_t)primitiveIndices.size();
+        // Loaded without a render context, so the table index is the glTF material
+        if (geometry->material != context.defaultMaterial.get()) primitive.material = geometry->material->tableIndex;
+        primitives.push_back(primitive);
+        vertices.insert(vertices.end(), primitiveVertices.begin(), primitiveVertices.end());
+        indices.insert(indices.end(), primitiveIndices.begin(), primitiveIndices.end());
+    }
+
+    std::vector<CookedMaterial> materials;
+    std::vector<CookedTextureReference> textures;
+    std::unordered_map<uint32_t, uint32_t> textureSlots;
+    for (const auto& materialSource : context.materialSources) {
+        CookedMaterial material;
+        material.baseColorFactor = materialSource.baseColorFactor;
+        uint32_t texture = materialSource.baseColorTexture;
+        if (texture != MaterialSource::noTexture && !context.texturePaths[texture].empty()) {
+            auto [slot, inserted] = textureSlots.try_emplace(texture, (uint32_t)textures.size());
+            if (inserted) {
+                std::string reference = textureReference(context.texturePaths[texture]);
+                if (reference.size() >= sizeof(CookedTextureReference::path)) {
+                    CRITICAL("Texture path {} is too long to reference from {}", reference, source.string());
+                }
+                CookedTextureReference& cookedReference = textures.emplace_back();
+                memcpy(cookedReference.path, reference.c_str(), reference.size());
+            }
+            material.baseColorTexture = slot->second;
+        }
+        materials.push_back(material);
+    }
+
+    CookedMeshHeader header;
+    header.primitiveCount = (uint32_t)primitives.size();
+    header.materialCount = (uint32_t)materials.size();
+    header.textureCount = (uint32_t)textures.size();
+    header.vertexCount = (uint32_t)vertices.size();
+    header.indexCount = (uint32_t)indices.size();
+    model.GetBounds(header.boundsMin, header.boundsMax);
+
+    std::vector<char> bytes;
+    bytes.reserve(sizeof(header) + primitives.size() * sizeof(CookedPrimitive) + materials.size() * sizeof(CookedMaterial) +
+        textures.size() * sizeof(CookedTextureReference) + vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t));
+    AppendBytes(bytes, &header, 1);
+    AppendBytes(bytes, primitives.data(), primitives.size());
+    AppendBytes(bytes, materials.data(), materials.size());
+    AppendBytes(bytes, textures.data(), textures.size());
+    AppendBytes(bytes, vertices.data(), vertices.size());
+    AppendBytes(bytes, indices.data(), indices.size());
+
+    stats.vertices = header.vertexCount;
+    stats.indices = header.indexCount;
+    stats.acmrBefore = triangles ? (double)missesBefore / triangles : 0.0;
+    stats.acmrAfter = triangles ? (double)missesAfter / triangles : 0.0;
+    return bytes;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "filesystem"
+
+#include "core/core.h"
+#include "core/functionref.h"
+
+struct MeshCookStats {
+    uint32_t vertices = 0;
+    uint32_t indices = 0;
+    // Average post transform cache misses per triangle, with a 16 entry FIFO like most hardware
+    double acmrBefore = 0.0;
+    double acmrAfter = 0.0;
+};
+
+// Everything a cooked mesh is made from: the glTF and its buffers. Its images are cooked on their own
+std::vector<std::string> GetMeshDependencies(const std::filesystem::path& source);
+
+// Loads the glTF on the CPU through Model and packs it into a .fmesh. Every primitive gets its duplicate vertices
+// merged, its triangles reordered for the vertex cache and its vertices reordered for fetch locality.
+// textureReference maps a source image path to the cooked texture the mesh should point at
+std::vector<char> CookMesh(const std::filesystem::path& source, FunctionRef<std::string(const std::string& imagePath)> textureReference, MeshCookStats& stats);
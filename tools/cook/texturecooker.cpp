@@ -0,0 +1,74 @@
+#include "texturecooker.h"
+
+#include "cmath"
+
+#include "graphics/vulkan/image.h"
+#include "graphics/cooked.h"
+#include "core/jobsystem.h"
+
+#define STB_DXT_IMPLEMENTATION
+#include "stb_dxt.h"
+
+static void CompressMip(const Image::Pixels& mip, CookedTextureFormat format, char* output) {
+    uint32_t blocksWide = (mip.width + 3) / 4;
+    uint32_t blocksHigh = (mip.height + 3) / 4;
+    uint32_t blockSize = format == CookedTextureFormat::Bc1 ? 8 : 16;
+    JobSystem::Get().ParallelFor(blocksHigh, [&](uint32_t blockY, uint32_t) {
+        // Blocks hanging over the edge repeat the last row and column, the padding is never sampled
+        uint8_t block[16 * 4];
+        for (uint32_t blockX = 0; blockX < blocksWide; blockX++) {
+            for (uint32_t y = 0; y < 4; y++) {
+                uint32_t sourceY = std::min(blockY * 4 + y, mip.height - 1);
+                for (uint32_t x = 0; x < 4; x++) {
+                    uint32_t sourceX = std::min(blockX * 4 + x, mip.width - 1);
+                    memcpy(&block[(y * 4 + x) * 4], &mip.data[((size_t)sourceY * mip.width + sourceX) * 4], 4);
+                }
+            }
+            unsigned char* destination = (unsigned char*)output + ((size_t)blockY * blocksWide + blockX) * blockSize;
+            stb_compress_dxt_block(destination, block, format == CookedTextureFormat::Bc3, STB_DXT_HIGHQUAL);
+        }
+    }, 8);
+}
+
+std::vector<char> CookTexture(const std::filesystem::path& source, bool compress, TextureCookStats& stats) {
+    PROFILE_FUNCTION();
+    Image::Pixels level = Image::DecodeImage(source.string());
+
+    bool hasAlpha = false;
+    for (size_t i = 3; i < level.data.size() && !hasAlpha; i += 4) hasAlpha = level.data[i] != 255;
+
+    CookedTextureHeader header;
+    header.format = !compress ? CookedTextureFormat::Rgba8 : hasAlpha ? CookedTextureFormat::Bc3 : CookedTextureFormat::Bc1;
+    header.width = level.width;
+    header.height = level.height;
+    header.mipCount = (uint32_t)std::floor(std::log2(std::max(level.width, level.height))) + 1;
+
+    std::vector<CookedMip> mips(header.mipCount);
+    uint64_t offset = sizeof(header) + mips.size() * sizeof(CookedMip);
+    for (uint32_t i = 0; i < header.mipCount; i++) {
+        mips[i].width = std::max(1u, header.width >> i);
+        mips[i].height = std::max(1u, header.height >> i);
+        // 16 byte aligned so every mip can be copied to a staging buffer as is
+        mips[i].offset = (offset + 15) & ~15ull;
+        mips[i].size = GetCookedMipSize(header.format, mips[i].width, mips[i].height);
+        offset = mips[i].offset + mips[i].size;
+    }
+
+    std::vector<char> bytes(offset, 0);
+    memcpy(bytes.data(), &header, sizeof(header));
+    memcpy(bytes.data() + sizeof(header), mips.data(), mips.size() * sizeof(CookedMip));
+    for (uint32_t i = 0; i < header.mipCount; i++) {
+        if (i > 0) level = Image::Downsample(level);
+        if (header.format == CookedTextureFormat::Rgba8) {
+            memcpy(bytes.data() + mips[i].offset, level.data.data(), level.data.size());
+        } else {
+            CompressMip(level, header.format, bytes.data() + mips[i].offset);
+        }
+    }
+
+    stats.width = header.width;
+    stats.height = header.height;
+    stats.mipCount = header.mipCount;
+    stats.hasAlpha = hasAlpha;
+    return bytes;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "filesystem"
+
+#include "core/core.h"
+
+struct TextureCookStats {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipCount = 0;
+    // Opaque images go to BC1, ones with any alpha to BC3
+    bool hasAlpha = false;
+};
+
+// Decodes the image, builds the full mip chain on the CPU the same way the loader's blits do, and packs it into a
+// .ftex. Block compression is split into rows and run on the job system, so one huge texture doesn't hold up the rest
+std::vector<char> CookTexture(const std::filesystem::path& source, bool compress, TextureCookStats& stats);